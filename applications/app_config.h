@@ -6,7 +6,13 @@
 #ifndef MOCK_KEY_VALUE_STORE_APP_CONFIG_H
 #define MOCK_KEY_VALUE_STORE_APP_CONFIG_H
 
-enum consistency {linear, causal, k_causal};
+#include "../kv_store/include/decision_log.h"
+
+#include <cstdint>
+#include <string>
+
+enum consistency {linear, causal, k_causal, read_committed, read_atomic, read_your_writes, monotonic_reads, monotonic_writes,
+                  writes_follow_reads, snapshot_isolation, parallel_snapshot_isolation};
 
 struct app_config {
     char *log_file_name;
@@ -15,6 +21,17 @@ struct app_config {
     bool debug = false;
     bool random_test = false;
     int num_random_test = 1;
+    bool explore = false;       // Explore read choices and interleavings systematically
+    uint64_t seed = 0;          // Iteration j seeds its read response selector and scheduler with seed + j, random if not given
+    int workers = 0;            // Threads running iterations in parallel, 0 for one per core
+    int pct_depth = 0;          // Schedule sessions with PCT of this depth, 0 for uniformly random
+    size_t pct_steps = 32;      // Steps of a run over which PCT draws its change points
+    std::string record_file = "violation.decisions";    // Decision log of the first violating iteration, "" for none
+    bool replay = false;        // Replay replay_log once instead of running iterations
+    mockdb::decision_log replay_log;
+    bool report_divergence = true;  // Print when the replay doesn't follow replay_log
+    bool minimize = false;      // Shrink the first violating iteration to a minimal counterexample
+    std::string trace_file;     // Trace of all iterations, written until exit, "" for none
 
     ~app_config(){
     }
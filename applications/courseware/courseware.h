@@ -65,8 +65,8 @@ public:
     courseware(mockdb::kv_store<std::string, web::json::value> *store,
                consistency consistency_level);
 
-    void tx_start();
-    void tx_end();
+    void tx_start(long session_id);
+    void tx_end(long session_id);
 
     void add_student(student s, long session_id = 0);
     void delete_student(student s, long session_id = 0);
@@ -86,7 +86,6 @@ public:
 private:
     mockdb::kv_store<std::string, web::json::value> *store;
     consistency consistency_level;
-    std::mutex mtx;
 };
 
 courseware::courseware(mockdb::kv_store<std::string, web::json::value> *store,
@@ -95,13 +94,14 @@ courseware::courseware(mockdb::kv_store<std::string, web::json::value> *store,
     this->consistency_level = consistency_level;
 }
 
-void courseware::tx_start() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 4));
-    mtx.lock();
+// Operations of the session up to tx_end form one store transaction. Under a
+// session_scheduler, sessions switch at begin.
+void courseware::tx_start(long session_id) {
+    this->store->begin(session_id);
 }
 
-void courseware::tx_end() {
-    mtx.unlock();
+void courseware::tx_end(long session_id) {
+    this->store->commit(session_id);
 }
 
 void courseware::add_student(student s, long session_id) {
@@ -160,9 +160,11 @@ void courseware::delete_student(student s, long session_id) {
     this->store->put("students", students, session_id);
 
     // Removed enrolled courses
-    students[L"list"] = web::json::value::array();
-    students[L"count"] = web::json::value(0);
-    store->put("enrollment:student:" + std::to_string(s.get_id()), students, session_id);
+    try {
+        store->remove("enrollment:student:" + std::to_string(s.get_id()), session_id);
+    } catch (mockdb::key_not_found_exception &e) {
+        // Pass
+    }
 }
 
 void courseware::add_course(course c, long session_id) {
@@ -222,9 +224,11 @@ void courseware::delete_course(course c, long session_id) {
     this->store->put("courses", courses, session_id);
 
     // Removed enrolled students
-    courses[L"list"] = web::json::value::array();
-    courses[L"count"] = web::json::value(0);
-    store->put("enrollment:course:" + std::to_string(c.get_id()), courses, session_id);
+    try {
+        store->remove("enrollment:course:" + std::to_string(c.get_id()), session_id);
+    } catch (mockdb::key_not_found_exception &e) {
+        // Pass
+    }
 }
 
 void courseware::register_student(int student_id, long session_id) {
@@ -375,9 +379,23 @@ std::map<int, std::vector<int>> courseware::get_enrollments(long session_id) {
         // courses list doesn't exist
         return enrollments;
     }
+    // Read all enrollment lists in one batch
     web::json::array course_list = courses[L"list"].as_array();
+    std::vector<std::string> keys;
     for (web::json::array::iterator it = course_list.begin(); it != course_list.end(); it++) {
-        enrollments[(*it).as_integer()] = get_enrolled_students((*it).as_integer(), session_id);
+        keys.push_back("enrollment:course:" + std::to_string((*it).as_integer()));
+    }
+    std::vector<std::pair<web::json::value, size_t>> course_enrollments = multi_get_each(store, keys, session_id);
+
+    int i = 0;
+    for (web::json::array::iterator it = course_list.begin(); it != course_list.end(); it++, i++) {
+        std::vector<int> &students_enrolled = enrollments[(*it).as_integer()];
+        // Course enrollment list doesn't exist
+        if (course_enrollments[i].second == 0)
+            continue;
+        for (auto &student_id : course_enrollments[i].first[L"list"].as_array()) {
+            students_enrolled.push_back(student_id.as_integer());
+        }
     }
     std::stringstream ss;
     for (auto e : enrollments) {
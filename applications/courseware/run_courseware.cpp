@@ -4,20 +4,20 @@
 //
 
 #include "../utils.h"
+#include "../iteration_runner.h"
 #include "../../kv_store/include/read_response_selector.h"
 #include "courseware.h"
 
-#include <thread>
+#include <random>
+#include <functional>
+#include <numeric>
 
 #define NUM_SESSIONS 2
 #define NUM_OPS 3
 
 app_config *config = nullptr;
-mockdb::kv_store<std::string, web::json::value> *store;
 
 // For fixed run
-std::vector<int> assert_counter(6, 0);
-std::vector<int> results = {0, 0, 0, 0};
 std::vector<std::vector<int>> serial_results = {
         {1, 2, 0, 0},
         {0, 1, 1, 0},
@@ -30,7 +30,7 @@ std::vector<std::vector<int>> operations(NUM_SESSIONS);
 std::vector<course> cr = {cs101, hs201, ph301};
 std::vector<student> st = {DK, JV, RB};
 
-void assert_count(bool result, int assert_index) {
+void assert_count(std::vector<int> &assert_counter, bool result, int assert_index) {
     if (!result)
         assert_counter[assert_index]++;
 }
@@ -60,23 +60,23 @@ void populate_courseware(courseware *courseware_app) {
  * {'CS101': [JV], 'HS201': []}, {'CS101': [JV], 'HS201': []}, {'CS101': [JV]}, {'CS101': [JV]}
  * {'CS101': [JV], 'HS201': []}, {'CS101': [JV]}, {'CS101': [JV]}, {'CS101': [JV]}
  */
-void do_op(courseware *courseware_app, int t_id) {
+void do_op(courseware *courseware_app, std::vector<int> &results, int t_id) {
     if (t_id == 1) {
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         courseware_app->enroll(DK.get_id(), cs101.get_id(), t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         std::map<int, std::vector<int>> courses = courseware_app->get_enrollments(t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         courseware_app->enroll(DK.get_id(), hs201.get_id(), t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         std::map<int, std::vector<int>> courses1 = courseware_app->get_enrollments(t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
         for (auto e : courses) {
             if (e.first == cs101.get_id()) {
@@ -95,21 +95,21 @@ void do_op(courseware *courseware_app, int t_id) {
         }
     }
     else if (t_id == 2) {
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         courseware_app->enroll(JV.get_id(), cs101.get_id(), t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         std::map<int, std::vector<int>> courses = courseware_app->get_enrollments(t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         courseware_app->delete_course(hs201, t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         std::vector<int> students = courseware_app->get_enrolled_students(hs201.get_id(), t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
         for (auto e : courses) {
             if (e.first == cs101.get_id()) {
@@ -130,23 +130,23 @@ void do_op(courseware *courseware_app, int t_id) {
 
 void do_dfs_op(courseware *courseware_app, int t_id) {
     if (t_id == 1) {
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         courseware_app->enroll(DK.get_id(), cs101.get_id(), t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         std::map<int, std::vector<int>> courses = courseware_app->get_enrollments(t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
     }
     else if (t_id == 2) {
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         courseware_app->enroll(JV.get_id(), cs101.get_id(), t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         std::map<int, std::vector<int>> courses = courseware_app->get_enrollments(t_id);
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
 
     }
 }
@@ -154,7 +154,7 @@ void do_dfs_op(courseware *courseware_app, int t_id) {
 void do_random_op(courseware *courseware_app, int t_id) {
     int idx = 0;
     for (int i = 0; i < operations[t_id - 1].size(); i++) {
-        courseware_app->tx_start();
+        courseware_app->tx_start(t_id);
         if (operations[t_id - 1][i] == 0) {
             courseware_app->enroll(st[idx].get_id(), cr[idx].get_id(), t_id);
         }
@@ -164,7 +164,7 @@ void do_random_op(courseware *courseware_app, int t_id) {
         else {
             courseware_app->delete_course(cr[idx], t_id);
         }
-        courseware_app->tx_end();
+        courseware_app->tx_end(t_id);
         idx = (idx + 1) % cr.size();
     }
 }
@@ -182,38 +182,45 @@ void random_fill(long seed) {
     }
 }
 
-
-void run_iteration() {
+// Runs the sessions once recording their choices into log, returns the results of the fixed run
+std::vector<int> run_iteration(uint64_t seed, mockdb::decision_log *log = nullptr) {
     mockdb::read_response_selector<std::string, web::json::value> *get_next_tx;
 
     if (config->consistency_level == consistency::causal)
-        get_next_tx = new mockdb::causal_read_response_selector<std::string, web::json::value>();
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, web::json::value>(seed);
     else if (config->consistency_level == consistency::linear)
-        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, web::json::value>();
+        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, web::json::value>(seed);
     else if (config->consistency_level == consistency::k_causal)
-        get_next_tx = new mockdb::k_causal_read_response_selector<std::string, web::json::value>(2, 12);
+        get_next_tx = new mockdb::k_causal_read_response_selector<std::string, web::json::value>(2, 12, seed);
+    else
+        get_next_tx = new_isolation_selector<std::string, web::json::value>(config->consistency_level, seed);
+
+    get_next_tx = wrap_selector(config, get_next_tx, log);
 
-    store = new mockdb::kv_store<std::string, web::json::value>(get_next_tx);
+    mockdb::kv_store<std::string, web::json::value> *store = new mockdb::kv_store<std::string, web::json::value>(get_next_tx);
     get_next_tx->init_consistency_checker(store);
 
     courseware *courseware_app = new courseware(store, config->consistency_level);
 
     populate_courseware(courseware_app);
-    std::vector<std::thread> threads;
+    std::vector<int> results = {0, 0, 0, 0};
+    mockdb::session_scheduler *scheduler = new_scheduler(config, seed);
+    std::vector<std::function<void()>> sessions;
 
     for (int i = 1; i <= NUM_SESSIONS; i++) {
         if (config->random_test)
-            threads.push_back(std::thread(do_random_op, courseware_app, i));
+            sessions.push_back([courseware_app, i] { do_random_op(courseware_app, i); });
         else
-            threads.push_back(std::thread(do_op, courseware_app, i));
+            sessions.push_back([courseware_app, &results, i] { do_op(courseware_app, results, i); });
     }
-
-    for (auto &t : threads)
-        t.join();
+    scheduler->run(sessions);
+    end_decisions(config, get_next_tx, scheduler, seed, log);
+    delete scheduler;
 
     delete courseware_app;
     delete store;
     delete get_next_tx;
+    return results;
 }
 
 /*
@@ -223,6 +230,8 @@ void run_iteration() {
  */
 int main(int argc, char **argv) {
     config = parse_command_line(argc, argv);
+    iteration_outcome outcome;
+    iteration_runner<iteration_outcome> runner(config->workers);
 
     for (int i = 1; i <= config->num_random_test; i++) {
 
@@ -233,33 +242,36 @@ int main(int argc, char **argv) {
             random_fill(i * 19 + 11);
         }
 
-        for(int j = 0; j < config->iterations; j++) {
+        // Each worker counts the violations of its iterations
+        auto iteration = [](int j, iteration_outcome &worker) {
+            std::vector<int> &worker_counter = worker.assert_counter;
+            int before = std::accumulate(worker_counter.begin(), worker_counter.end(), 0);
             if (config->debug)
-                std::cout << "[MOCKDB::app] Iteration " << j << " start" << std::endl;
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " start");
 
             std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-            run_iteration();
+            mockdb::decision_log log;
+            std::vector<int> results = run_iteration(config->seed + j, &log);
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
             bool register_overflow = results[0] == 1 && results[2] == 1;
-            assert_count(!register_overflow, 0);
+            assert_count(worker_counter, !register_overflow, 0);
             bool removed_register = (results[0] == 0 && results[1] == 1 && results[3] == 1) ||
                                     (results[1] == 2 && results[3] == 1 );
-            assert_count(!removed_register, 1);
+            assert_count(worker_counter, !removed_register, 1);
+            worker.on_iteration(j, std::accumulate(worker_counter.begin(), worker_counter.end(), 0) > before, log);
 
-            results[0] = results[1] = results[2] = results[3] = 0;
             std::stringstream ss;
 
-            for (auto k : assert_counter)
+            for (auto k : worker_counter)
                 ss << k << " ";
 
             if (config->debug) {
-                std::cout << "[MOCKDB::app] " << ss.str() << std::endl;
-                std::cout << "[MOCKDB::app] Iteration " << j << " end "
-                    << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
-                    << std::endl;
+                print_line("[MOCKDB::app] " + ss.str());
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " end " +
+                           std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()));
             }
-
-        }
+        };
+        merge_outcomes(outcome, runner.run(config->iterations, iteration_outcome(), iteration, merge_outcomes));
 
         if (config->random_test && config->debug) {
             std::cout << "[MOCKDB::app] RANDOM " << i - 1 << " end" << std::endl;
@@ -267,10 +279,11 @@ int main(int argc, char **argv) {
     }
 
     int violation_count = 0;
-    for (auto e : assert_counter)   violation_count += e;
+    for (auto e : outcome.assert_counter)   violation_count += e;
 
     std::cout << "Total violations found: " << violation_count
         << " in " << config->iterations << " iterations\n";
+    write_first_violation(config, outcome);
     delete config;
     return 0;
-}
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#ifndef MOCK_KEY_VALUE_STORE_ITERATION_RUNNER_H
+#define MOCK_KEY_VALUE_STORE_ITERATION_RUNNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Runs the iterations of an application on a pool of worker threads. Iterations
+ * must be independent of each other: each one builds its own store, selector and
+ * scheduler and only shares read-only data. Every worker accumulates into its own
+ * state, the states are merged once all iterations are done.
+ */
+template <typename State>
+class iteration_runner {
+public:
+    // 0 workers for one per core
+    iteration_runner(int worker_count = 0) {
+        if (worker_count <= 0)
+            worker_count = (int) std::thread::hardware_concurrency();
+        this->worker_count = worker_count < 1 ? 1 : worker_count;
+    }
+
+    /*
+     * Calls iteration(j, state) for every j in [0, iterations), with the state of the
+     * worker it runs on, initially a copy of initial. Returns the states of the
+     * workers merged into initial, in worker order; initial must be neutral for
+     * merge, e.g. zero counters.
+     * Rethrows the first exception thrown by an iteration, after the workers stop.
+     */
+    State run(int iterations, const State &initial,
+              const std::function<void(int, State &)> &iteration,
+              const std::function<void(State &, const State &)> &merge) {
+        int workers = std::min(this->worker_count, iterations < 1 ? 1 : iterations);
+        std::vector<State> states(workers, initial);
+        std::atomic<int> next(0);
+        std::exception_ptr error;
+        std::mutex error_mtx;
+
+        auto work = [&](int worker) {
+            try {
+                for (int j = next++; j < iterations; j = next++)
+                    iteration(j, states[worker]);
+            } catch (...) {
+                std::lock_guard<std::mutex> lck(error_mtx);
+                if (!error)
+                    error = std::current_exception();
+                next = iterations;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int w = 1; w < workers; w++)
+            threads.push_back(std::thread(work, w));
+        work(0);
+        for (auto &t : threads)
+            t.join();
+
+        if (error)
+            std::rethrow_exception(error);
+
+        State merged = initial;
+        for (auto &state : states)
+            merge(merged, state);
+        return merged;
+    }
+
+    int get_worker_count() const {
+        return this->worker_count;
+    }
+
+private:
+    int worker_count;
+};
+
+// Merge for states which count assertion failures by index
+inline void add_counters(std::vector<int> &total, const std::vector<int> &counters) {
+    for (size_t i = 0; i < total.size() && i < counters.size(); i++)
+        total[i] += counters[i];
+}
+
+#endif //MOCK_KEY_VALUE_STORE_ITERATION_RUNNER_H
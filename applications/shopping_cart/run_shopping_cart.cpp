@@ -3,22 +3,21 @@
 // Licensed under the MIT License.
 //
 
-#include <thread>
+#include <functional>
+#include <random>
 #include "../utils.h"
+#include "../iteration_runner.h"
 #include "../../kv_store/include/read_response_selector.h"
+#include "../../kv_store/include/explorer.h"
 #include "shopping_cart.h"
 
 #define NUM_SESSIONS 2
 #define NUM_OPS 3
 
 app_config *config = nullptr;
-mockdb::kv_store<std::string, web::json::value> *store;
 user u("dip", 1);
 
 // For fixed run
-std::vector<int> assert_counter(6, 0);
-std::vector<int> results = {0, 0, 0, 0};
-
 std::vector<std::vector<int>> serial_results = {
         {0, 0, 0, 0},
         {0, 0, 4, 0},
@@ -38,52 +37,52 @@ std::vector<std::vector<int>> reappear_results = {
 std::vector<std::vector<int>> operations(NUM_SESSIONS);
 std::vector<item> items = {shoes, ball};
 
-void add_item_to_store(item i) {
+void add_item_to_store(mockdb::kv_store<std::string, web::json::value> *store, item i) {
     store->put("item:" + std::to_string(i.id) + ":name", web::json::value(utility::conversions::to_string_t(i.name)));
     store->put("item:" + std::to_string(i.id) + ":price", web::json::value(i.price));
 }
 
-void add_user_to_store(user u) {
+void add_user_to_store(mockdb::kv_store<std::string, web::json::value> *store, user u) {
     store->put("user:" + std::to_string(u.id) + ":name", web::json::value(utility::conversions::to_string_t(u.name)));
 }
 
 /*
  * Insert items and user into store
  */
-void populate_shopping_cart() {
-    add_item_to_store(shoes);
-    add_item_to_store(book);
-    add_item_to_store(umbrella);
-    add_item_to_store(ball);
-    add_item_to_store(bat);
-    add_item_to_store(table);
-
-    add_user_to_store(u);
+void populate_shopping_cart(mockdb::kv_store<std::string, web::json::value> *store) {
+    add_item_to_store(store, shoes);
+    add_item_to_store(store, book);
+    add_item_to_store(store, umbrella);
+    add_item_to_store(store, ball);
+    add_item_to_store(store, bat);
+    add_item_to_store(store, table);
+
+    add_user_to_store(store, u);
 }
 
-void assert_count(bool result, int assert_index) {
+void assert_count(std::vector<int> &assert_counter, bool result, int assert_index) {
     if (result)
         assert_counter[assert_index]++;
 }
 
-void serial_count(std::vector<int> &results) {
+void serial_count(std::vector<int> &assert_counter, std::vector<int> &results) {
     bool serial = false;
     for (auto candidate : serial_results) {
         if (candidate == results) {
             serial = true;
         }
     }
-    assert_count(serial, 0);
+    assert_count(assert_counter, serial, 0);
 }
 
-void reappear_count(std::vector<int> &results) {
+void reappear_count(std::vector<int> &assert_counter, std::vector<int> &results) {
     bool reappear = false;
     for (auto candidate : reappear_results) {
         if (candidate == results) {
             reappear = true;
         }
     }
-    assert_count(reappear, 1);
+    assert_count(assert_counter, reappear, 1);
 }
 
 /*
@@ -99,48 +98,48 @@ void reappear_count(std::vector<int> &results) {
  * A5 C2: if GET(X) == 2: GET(Y) == 2
  * A6 C2: GET(X) == 4 || 0
  */
-void do_operations(shopping_cart *cart, int t_id) {
+void do_operations(shopping_cart *cart, std::vector<int> &assert_counter, int t_id) {
     if (t_id == 1) {
-        cart->tx_start();
-        cart->add_item(shoes, 2);
-        cart->add_item(ball);
-        cart->tx_end();
-
-        cart->tx_start();
-        cart->change_quantity(shoes, 3);
-        cart->remove_item(shoes);
-        int qt_x = cart->get_quantity(shoes);
-        std::vector<std::pair<item, int>> cart_list = cart->get_cart_list();
-        cart->tx_end();
+        cart->tx_start(t_id);
+        cart->add_item(shoes, 2, t_id);
+        cart->add_item(ball, 1, t_id);
+        cart->tx_end(t_id);
+
+        cart->tx_start(t_id);
+        cart->change_quantity(shoes, 3, t_id);
+        cart->remove_item(shoes, t_id);
+        int qt_x = cart->get_quantity(shoes, t_id);
+        std::vector<std::pair<item, int>> cart_list = cart->get_cart_list(t_id);
+        cart->tx_end(t_id);
 
         std::cout << "cart_list " << cart_list.size() << std::endl;
         for (auto i : cart_list)
             std::cout << i.first.name << " " << i.second << std::endl;
 
-        assert_count(qt_x == 0, 0);
-        assert_count(cart_list.size() == 1 && cart_list[0].first == ball &&
+        assert_count(assert_counter, qt_x == 0, 0);
+        assert_count(assert_counter, cart_list.size() == 1 && cart_list[0].first == ball &&
                      cart_list[0].second == 1 || cart_list[0].second == 2, 1);
     }
     else if (t_id == 2) {
-        cart->tx_start();
-        cart->add_item(ball);
-        int qt_x = cart->get_quantity(shoes);
-        int qt_y = cart->get_quantity(ball);
-        cart->tx_end();
+        cart->tx_start(t_id);
+        cart->add_item(ball, 1, t_id);
+        int qt_x = cart->get_quantity(shoes, t_id);
+        int qt_y = cart->get_quantity(ball, t_id);
+        cart->tx_end(t_id);
 
-        cart->tx_start();
-        cart->change_quantity(shoes, 4);
-        int new_qt_x = cart->get_quantity(shoes);
-        cart->tx_end();
+        cart->tx_start(t_id);
+        cart->change_quantity(shoes, 4, t_id);
+        int new_qt_x = cart->get_quantity(shoes, t_id);
+        cart->tx_end(t_id);
 
         std::cout << "qt x y" << qt_x << " " << qt_y << std::endl;
 
-        assert_count(qt_x == 0 || qt_x == 2, 2);
-        assert_count(qt_y == 1 || qt_y == 2, 3);
+        assert_count(assert_counter, qt_x == 0 || qt_x == 2, 2);
+        assert_count(assert_counter, qt_y == 1 || qt_y == 2, 3);
         if (qt_x == 2)
-            assert_count(qt_y == 2, 4);
+            assert_count(assert_counter, qt_y == 2, 4);
 
-        assert_count(new_qt_x == 0 || new_qt_x == 4, 5);
+        assert_count(assert_counter, new_qt_x == 0 || new_qt_x == 4, 5);
     }
 }
 
@@ -148,19 +147,19 @@ void do_operations(shopping_cart *cart, int t_id) {
  * C1: REMOVE_ITEM(X) | GET_CART() | GET_CART()
  * C2: ADD_ITEM(X, 3) | GET_CART() | GET_CART()
  */
-void do_op(shopping_cart *cart, int t_id) {
+void do_op(shopping_cart *cart, std::vector<int> &results, int t_id) {
     if (t_id == 1) {
-        cart->tx_start();
+        cart->tx_start(t_id);
         cart->remove_item(shoes, t_id);
-        cart->tx_end();
+        cart->tx_end(t_id);
 
-        cart->tx_start();
+        cart->tx_start(t_id);
         auto cart_a = cart->get_cart_list(t_id);
-        cart->tx_end();
+        cart->tx_end(t_id);
 
-        cart->tx_start();
+        cart->tx_start(t_id);
         auto cart_b = cart->get_cart_list(t_id);
-        cart->tx_end();
+        cart->tx_end(t_id);
 
         int qt_x = 0;
         if (cart_a.size() != 0)
@@ -174,17 +173,17 @@ void do_op(shopping_cart *cart, int t_id) {
         results[1] = qt_x2;
     }
     else if (t_id == 2) {
-        cart->tx_start();
+        cart->tx_start(t_id);
         cart->add_item(shoes, 3, t_id);
-        cart->tx_end();
+        cart->tx_end(t_id);
 
-        cart->tx_start();
+        cart->tx_start(t_id);
         auto cart_a = cart->get_cart_list(t_id);
-        cart->tx_end();
+        cart->tx_end(t_id);
 
-        cart->tx_start();
+        cart->tx_start(t_id);
         auto cart_b = cart->get_cart_list(t_id);
-        cart->tx_end();
+        cart->tx_end(t_id);
 
         int qt_x = 0;
         if (cart_a.size() != 0)
@@ -223,60 +222,107 @@ void random_fill(long seed) {
 void do_random_op(shopping_cart *cart, int t_id) {
     int idx = 0;
     for (int j = 1; j <= NUM_OPS; j++) {
-        cart->tx_start();
+        cart->tx_start(t_id);
         if (operations[t_id - 1][j - 1] == 0) {
             cart->get_cart_list(t_id);
         }
         else if (operations[t_id - 1][j - 1] == 1) {
-            cart->add_item(items[idx], t_id);
+            cart->add_item(items[idx], 1, t_id);
         }
         else if (operations[t_id - 1][j - 1] == 2) {
             cart->remove_item(items[idx], t_id);
         }
-        cart->tx_end();
+        cart->tx_end(t_id);
         idx = (idx + 1) % items.size();
     }
     // Last operation is fixed - a read operation
-    cart->tx_start();
+    cart->tx_start(t_id);
     cart->get_cart_list(t_id);
-    cart->tx_end();
+    cart->tx_end(t_id);
 }
 
-void run_iteration() {
+/*
+ * Runs the sessions once, filling results of the fixed run and recording the choices
+ * into log. With an explorer the run follows its current choices instead; returns
+ * false if the run repeats one already explored.
+ */
+bool run_iteration(uint64_t seed, std::vector<int> &results, mockdb::decision_log *log,
+                   mockdb::explorer *ex = nullptr) {
     mockdb::read_response_selector<std::string, web::json::value> *get_next_tx;
 
     if (config->consistency_level == consistency::causal)
-        get_next_tx = new mockdb::causal_read_response_selector<std::string, web::json::value>();
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, web::json::value>(seed);
     else if (config->consistency_level == consistency::linear)
-        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, web::json::value>();
+        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, web::json::value>(seed);
     else if (config->consistency_level == consistency::k_causal)
-        get_next_tx = new mockdb::k_causal_read_response_selector<std::string, web::json::value>(2, 12);
+        get_next_tx = new mockdb::k_causal_read_response_selector<std::string, web::json::value>(2, 12, seed);
+    else
+        get_next_tx = new_isolation_selector<std::string, web::json::value>(config->consistency_level, seed);
 
-    store = new mockdb::kv_store<std::string, web::json::value>(get_next_tx);
+    if (ex != nullptr)
+        get_next_tx = new mockdb::exploring_read_response_selector<std::string, web::json::value>(ex, get_next_tx);
+    else
+        get_next_tx = wrap_selector(config, get_next_tx, log);
+
+    mockdb::kv_store<std::string, web::json::value> *store = new mockdb::kv_store<std::string, web::json::value>(get_next_tx);
     get_next_tx->init_consistency_checker(store);
 
     shopping_cart *cart = new shopping_cart(u, store, config->consistency_level);
-    populate_shopping_cart();
+    populate_shopping_cart(store);
     // Required for do_op assertion
     cart->add_item(shoes);
 
-    std::vector<std::thread> threads;
-
-    for (int i = 1; i <= NUM_SESSIONS; i++) {
-        if (config->random_test)
-            threads.push_back(std::thread(do_random_op, cart, i));
-        else
-            threads.push_back(std::thread(do_op, cart, i));
+    bool fresh = true;
+    if (ex != nullptr) {
+        std::vector<std::function<void()>> sessions;
+        for (int i = 1; i <= NUM_SESSIONS; i++) {
+            if (config->random_test)
+                sessions.push_back([cart, i] { do_random_op(cart, i); });
+            else
+                sessions.push_back([cart, &results, i] { do_op(cart, results, i); });
+        }
+        fresh = ex->run(sessions);
+    } else {
+        mockdb::session_scheduler *scheduler = new_scheduler(config, seed);
+        std::vector<std::function<void()>> sessions;
+
+        for (int i = 1; i <= NUM_SESSIONS; i++) {
+            if (config->random_test)
+                sessions.push_back([cart, i] { do_random_op(cart, i); });
+            else
+                sessions.push_back([cart, &results, i] { do_op(cart, results, i); });
+        }
+        scheduler->run(sessions);
+        end_decisions(config, get_next_tx, scheduler, seed, log);
+        delete scheduler;
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-
-    for (auto &t : threads)
-        t.join();
-
     delete cart;
     delete store;
     delete get_next_tx;
+    return fresh;
+}
+
+/*
+ * Runs every distinct combination of read choices and interleavings of the sessions
+ * once, at most config->iterations runs.
+ */
+void explore(std::vector<int> &assert_counter) {
+    mockdb::explorer ex;
+    int distinct = 0;
+    bool complete;
+    do {
+        std::vector<int> results = {0, 0, 0, 0};
+        if (run_iteration(config->seed, results, nullptr, &ex)) {
+            serial_count(assert_counter, results);
+            reappear_count(assert_counter, results);
+            distinct++;
+        }
+        complete = !ex.next();
+    } while (!complete && (int) ex.get_execution_count() < config->iterations);
+
+    std::cout << "Explored " << distinct << " distinct of " << ex.get_execution_count() << " runs"
+              << (complete ? "" : ", stopped before exhausting the state space") << "\n";
 }
 
 /*
@@ -286,6 +332,8 @@ void run_iteration() {
  */
 int main(int argc, char **argv) {
     config = parse_command_line(argc, argv);
+    iteration_outcome outcome;
+    iteration_runner<iteration_outcome> runner(config->workers);
 
     for (int i = 1; i <= config->num_random_test; i++) {
 
@@ -296,40 +344,50 @@ int main(int argc, char **argv) {
             random_fill(i * 19 + 11);
         }
 
-        for (int j = 0; j < config->iterations; j++) {
+        if (config->explore) {
+            explore(outcome.assert_counter);
+            continue;
+        }
 
+        // Each worker counts the violations of its iterations
+        auto iteration = [](int j, iteration_outcome &worker) {
+            std::vector<int> &worker_counter = worker.assert_counter;
+            int before = worker_counter[1];
             if (config->debug)
-                std::cout << "[MOCKDB::app] Iteration " << j << " start" << std::endl;
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " start");
 
             std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-            run_iteration();
+            std::vector<int> results = {0, 0, 0, 0};
+            mockdb::decision_log log;
+            run_iteration(config->seed + j, results, &log);
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
-            serial_count(results);
-            reappear_count(results);
+            serial_count(worker_counter, results);
+            reappear_count(worker_counter, results);
+            worker.on_iteration(j, worker_counter[1] > before, log);
 
-            results[0] = results[1] = results[2] = results[3] = 0;
             std::stringstream ss;
-            for (auto k : assert_counter)
+            for (auto k : worker_counter)
                 ss << k << " ";
 
             if (config->debug) {
-                std::cout << "[MOCKDB::app] " << ss.str() << std::endl;
-                std::cout << "[MOCKDB::app] Iteration " << j << " end "
-                    << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
-                    << std::endl;
+                print_line("[MOCKDB::app] " + ss.str());
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " end " +
+                           std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()));
             }
-        }
+        };
+        merge_outcomes(outcome, runner.run(config->iterations, iteration_outcome(), iteration, merge_outcomes));
 
         if (config->random_test && config->debug) {
             std::cout << "[MOCKDB::app] RANDOM " << i - 1 << " end" << std::endl;
         }
     }
 
-    int violation_count = assert_counter[1];
+    int violation_count = outcome.assert_counter[1];
 
     std::cout << "Total violations found: " << violation_count
         << " in " << config->iterations << " iterations\n";
+    write_first_violation(config, outcome);
 
     delete config;
     return 0;
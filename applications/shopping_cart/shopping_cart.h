@@ -60,20 +60,20 @@ public:
     std::vector<std::pair<item, int>> get_cart_list(long session_id = 1);
     double get_bill(long session_id = 1);
 
-    void tx_start();
-    void tx_end();
+    void tx_start(long session_id);
+    void tx_end(long session_id);
 
 
 private:
     int user_id;
     mockdb::kv_store<std::string, web::json::value> *store;
-    std::mutex mtx;
     consistency consistency_level;
 
     void _add_item(int id, long session_id = 1);
     void _add_quantity(int id, int quantity, long session_id = 1);
     void _change_quantity(int id, int quantity, long session_id = 1);
     int _get_quantity(int id, long session_id = 1);
+    void _remove_quantity(int id, long session_id = 1);
 };
 
 shopping_cart::shopping_cart(user u, mockdb::kv_store<std::string, web::json::value> *store,
@@ -83,13 +83,14 @@ shopping_cart::shopping_cart(user u, mockdb::kv_store<std::string, web::json::va
     this->consistency_level = consistency_level;
 }
 
-void shopping_cart::tx_start() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 4));
-    mtx.lock();
+// Operations of the session up to tx_end form one store transaction. Under a
+// session_scheduler, sessions switch at begin.
+void shopping_cart::tx_start(long session_id) {
+    this->store->begin(session_id);
 }
 
-void shopping_cart::tx_end() {
-    mtx.unlock();
+void shopping_cart::tx_end(long session_id) {
+    this->store->commit(session_id);
 }
 
 void shopping_cart::add_item(item i, long session_id) {
@@ -126,8 +127,8 @@ void shopping_cart::remove_item(item i, long session_id) {
         if (*it != web::json::value(i.id)) {
             new_items.push_back(*it);
         }
-        else {  // Mark quantity as 0
-            _change_quantity(i.id, 0, session_id);
+        else {  // Quantity reads as 0 once removed
+            _remove_quantity(i.id, session_id);
         }
     }
     cart[L"items"] = web::json::value::array(new_items);
@@ -242,4 +243,13 @@ void shopping_cart::_change_quantity(int id, int quantity, long session_id) {
                      ":quantity", val, session_id);
 }
 
+void shopping_cart::_remove_quantity(int id, long session_id) {
+    try {
+        this->store->remove("cart:" + std::to_string(this->user_id) + ":" + std::to_string(id) +
+                            ":quantity", session_id);
+    } catch (mockdb::key_not_found_exception &e) {
+        // Already removed
+    }
+}
+
 #endif //MOCK_KEY_VALUE_STORE_SHOPPING_CART_H
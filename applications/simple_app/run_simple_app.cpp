@@ -5,6 +5,7 @@
 
 #include "../app_config.h"
 #include "../utils.h"
+#include "../iteration_runner.h"
 #include "../../kv_store/include/read_response_selector.h"
 
 #include <iostream>
@@ -43,16 +44,18 @@ void do_operations(mockdb::kv_store<std::string, int> *store, int t_id) {
 }
 /*
  */
-void run_iteration() {
+void run_iteration(uint64_t seed) {
     mockdb::read_response_selector<std::string, int> *get_next_tx;
 
     if (config->consistency_level == consistency::causal)
-        get_next_tx = new mockdb::causal_read_response_selector<std::string, int>();
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, int>(seed);
     else if (config->consistency_level == consistency::linear)
-        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, int>();
+        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, int>(seed);
     else if (config->consistency_level == consistency::k_causal)
         get_next_tx = new mockdb::k_causal_read_response_selector<std::string, int>(2,
-                                                                                    operations.size() * operations[0].size()/2);
+                                                                                    operations.size() * operations[0].size()/2, seed);
+    else
+        get_next_tx = new_isolation_selector<std::string, int>(config->consistency_level, seed);
 
     mockdb::kv_store<std::string, int> *store = new mockdb::kv_store<std::string, int>(get_next_tx);
     get_next_tx->init_consistency_checker(store);
@@ -88,21 +91,22 @@ int main(int argc, char **argv) {
             {{"a", -1}, {"b", -1}, {"b", 32}}
     };
 
-    for(int j = 0; j < config->iterations; j++) {
-
+    // Nothing to aggregate, workers count their iterations
+    iteration_runner<int> runner(config->workers);
+    auto iteration = [](int j, int &count) {
         if (config->debug)
-            std::cout << "[MOCKDB::app] Iteration " << j << " start" << std::endl;
+            print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " start");
 
         std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-        run_iteration();
+        run_iteration(config->seed + j);
         std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        count++;
 
         if (config->debug)
-            std::cout << "[MOCKDB::app] Iteration " << j << " end "
-                     << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
-                     << std::endl;
-
-    }
+            print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " end " +
+                       std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()));
+    };
+    runner.run(config->iterations, 0, iteration, [](int &total, const int &count) { total += count; });
 
     delete config;
     return 0;
@@ -6,30 +6,38 @@
 #include "treiber_stack.h"
 #include "../app_config.h"
 #include "../utils.h"
+#include "../iteration_runner.h"
 #include "../../kv_store/include/read_response_selector.h"
+#include "../../kv_store/include/minimizer.h"
 
+#include <algorithm>
 #include <iostream>
+#include <fstream>
 #include <vector>
-#include <thread>
+#include <random>
+#include <functional>
 #include <assert.h>
 #include <chrono>
 
 #define NUM_SESSIONS 3
 #define NUM_OPS 3
+// Seeds a candidate program is run with while minimizing, it fails if one of them violates
+#define MINIMIZE_SEEDS 64
 
-std::vector<std::vector<bool>> operations(NUM_SESSIONS);
-std::vector<int> results(6, 0);
-std::vector<int> assert_counter(6, 0);
+// Operations of each session, push (1) or pop (0)
+typedef std::vector<std::vector<bool>> stack_program;
+
+stack_program operations(NUM_SESSIONS);
 
 app_config *config;
 
-void assert_count(bool result, int assert_index) {
+void assert_count(std::vector<int> &assert_counter, bool result, int assert_index) {
     if (result)
         assert_counter[assert_index]++;
 }
 
 // Checks if any pop returned a pushed value multiple times
-void check_pop_valid() {
+void check_pop_valid(std::vector<int> &assert_counter, const std::vector<int> &results) {
     std::unordered_set<int> unique_vals;
     bool repeat_value = false;
     for (auto e : results) {
@@ -40,7 +48,7 @@ void check_pop_valid() {
             unique_vals.insert(e);
         }
     }
-    assert_count(repeat_value, 0);
+    assert_count(assert_counter, repeat_value, 0);
 
 }
 
@@ -57,10 +65,43 @@ void random_fill(long seed) {
     }
 }
 
-void do_operations(treiber_stack<int> *stack, int t_id) {
+// Program in one line, e.g. "110 010 00"
+std::string encode_program(const stack_program &ops) {
+    std::string text;
+    for (auto &session : ops) {
+        if (!text.empty())
+            text += " ";
+        for (bool push : session)
+            text += push ? "1" : "0";
+    }
+    return text;
+}
+
+stack_program decode_program(const std::string &text) {
+    stack_program ops;
+    std::stringstream ss(text);
+    std::string session;
+    while (ss >> session) {
+        ops.push_back(std::vector<bool>());
+        for (char c : session)
+            ops.back().push_back(c == '1');
+    }
+    return ops;
+}
+
+size_t count_operations(const stack_program &ops) {
+    size_t count = 0;
+    for (auto &session : ops)
+        count += session.size();
+    return count;
+}
+
+// Session t_id writes the values it pops from results[first] on
+void do_operations(treiber_stack<int> *stack, const stack_program &ops, std::vector<int> &results,
+                   int t_id, size_t first) {
     std::vector<int> pop_values;
-    for (size_t i = 1; i <= operations[t_id - 1].size(); i++) {
-        if (operations[t_id - 1][i - 1]) {
+    for (size_t i = 1; i <= ops[t_id - 1].size(); i++) {
+        if (ops[t_id - 1][i - 1]) {
             stack->push(t_id * 10 + i, t_id);
         }
         else {
@@ -69,39 +110,155 @@ void do_operations(treiber_stack<int> *stack, int t_id) {
     }
     if (!config->random_test) {
         for (size_t i = 0; i < pop_values.size(); i++)
-            results[(t_id - 1) * 2 + i] = pop_values[i];
+            results[first + i] = pop_values[i];
     }
 }
-/*
- */
-void run_iteration() {
+
+// Runs the sessions of ops once recording their choices into log, returns the values popped
+std::vector<int> run_iteration(const stack_program &ops, uint64_t seed, mockdb::decision_log *log = nullptr,
+                               const app_config *settings = config) {
     mockdb::read_response_selector<long, std::pair<int, long>> *get_next_tx;
+    int total_ops = (int) count_operations(ops);
 
-    if (config->consistency_level == consistency::causal)
-        get_next_tx = new mockdb::causal_read_response_selector<long, std::pair<int, long>>();
-    else if (config->consistency_level == consistency::linear)
-        get_next_tx = new mockdb::linearizable_read_response_selector<long, std::pair<int, long>>();
-    else if (config->consistency_level == consistency::k_causal)
+    if (settings->consistency_level == consistency::causal)
+        get_next_tx = new mockdb::causal_read_response_selector<long, std::pair<int, long>>(seed);
+    else if (settings->consistency_level == consistency::linear)
+        get_next_tx = new mockdb::linearizable_read_response_selector<long, std::pair<int, long>>(seed);
+    else if (settings->consistency_level == consistency::k_causal)
         get_next_tx = new mockdb::k_causal_read_response_selector<long, std::pair<int, long>>(2,
-                                                                                              operations.size() * operations[0].size()/2);
+                                                                                              std::max(total_ops / 2, 2), seed);
     else
-        get_next_tx = new mockdb::causal_read_response_selector<long, std::pair<int, long>>();
+        get_next_tx = new_isolation_selector<long, std::pair<int, long>>(settings->consistency_level, seed);
+
+    get_next_tx = wrap_selector(settings, get_next_tx, log);
 
     mockdb::kv_store<long, std::pair<int, long>> *store = new mockdb::kv_store<long, std::pair<int, long>>(get_next_tx);
     get_next_tx->init_consistency_checker(store);
 
     treiber_stack<int> *stack = new treiber_stack<int>(store);
-    std::vector<std::thread> threads;
+    std::vector<int> results(total_ops, 0);
+    mockdb::session_scheduler *scheduler = new_scheduler(settings, seed);
+    std::vector<std::function<void()>> sessions;
 
-    for (int i = 1; i <= NUM_SESSIONS; i++) {
-        threads.push_back(std::thread(do_operations, stack, i));
+    size_t first = 0;
+    for (int i = 1; i <= (int) ops.size(); i++) {
+        sessions.push_back([stack, &ops, &results, i, first] { do_operations(stack, ops, results, i, first); });
+        first += ops[i - 1].size();
     }
+    scheduler->run(sessions);
+    end_decisions(settings, get_next_tx, scheduler, seed, log);
+    if (log != nullptr)
+        log->program = encode_program(ops);
+    delete scheduler;
 
-    for (auto &t : threads)
-        t.join();
-
+    delete stack;
     delete store;
     delete get_next_tx;
+    return results;
+}
+
+bool violates(const std::vector<int> &results) {
+    std::vector<int> counter(1, 0);
+    check_pop_valid(counter, results);
+    return counter[0] > 0;
+}
+
+// Offset of the first seed ops violates with among MINIMIZE_SEEDS from seed, -1 if none
+int violating_seed(const stack_program &ops, uint64_t seed, mockdb::decision_log *log = nullptr) {
+    for (int k = 0; k < MINIMIZE_SEEDS; k++) {
+        if (log != nullptr)
+            *log = mockdb::decision_log();
+        if (violates(run_iteration(ops, seed + k, log)))
+            return k;
+    }
+    return -1;
+}
+
+/*
+ * Shrinks the first violating iteration: removes whole sessions, then single
+ * operations, while the program still violates with one of MINIMIZE_SEEDS seeds,
+ * then turns the reads of that execution into reads of the latest admissible version
+ * while the replay still violates. Writes the decision log of the result to
+ * config->record_file.
+ */
+void minimize_violation(const iteration_outcome &outcome) {
+    mockdb::minimizer shrink(config->workers);
+    uint64_t seed = config->seed + outcome.first_violation;
+    stack_program ops = operations;
+
+    // Sessions
+    std::vector<size_t> kept = shrink.minimize(ops.size(), [&ops, seed](const std::vector<size_t> &sessions) {
+        stack_program candidate;
+        for (size_t s : sessions)
+            candidate.push_back(ops[s]);
+        return violating_seed(candidate, seed) >= 0;
+    });
+    stack_program sessions_only;
+    for (size_t s : kept)
+        sessions_only.push_back(ops[s]);
+    ops = sessions_only;
+
+    // Operations, numbered across sessions, sessions left without any are dropped
+    std::vector<std::pair<size_t, size_t>> positions;
+    for (size_t s = 0; s < ops.size(); s++)
+        for (size_t i = 0; i < ops[s].size(); i++)
+            positions.push_back(std::make_pair(s, i));
+    auto select_operations = [&ops, &positions](const std::vector<size_t> &selected) {
+        stack_program candidate(ops.size());
+        for (size_t p : selected)
+            candidate[positions[p].first].push_back(ops[positions[p].first][positions[p].second]);
+        candidate.erase(std::remove_if(candidate.begin(), candidate.end(),
+                                       [](const std::vector<bool> &session) { return session.empty(); }),
+                        candidate.end());
+        return candidate;
+    };
+    kept = shrink.minimize(positions.size(), [&select_operations, seed](const std::vector<size_t> &selected) {
+        return violating_seed(select_operations(selected), seed) >= 0;
+    });
+    ops = select_operations(kept);
+
+    mockdb::decision_log log;
+    int offset = violating_seed(ops, seed, &log);
+    if (offset < 0) {
+        std::cout << "[MOCKDB::app] The violation didn't reproduce while minimizing\n";
+        return;
+    }
+
+    // Read choices: the reads not kept return the latest admissible version
+    std::vector<size_t> reads;
+    for (size_t r = 0; r < log.reads.size(); r++)
+        if (log.reads[r] != mockdb::decision_log::no_response)
+            reads.push_back(r);
+    auto replay_config = [&log, &reads](const std::vector<size_t> &selected) {
+        app_config replay = *config;
+        replay.replay = true;
+        replay.report_divergence = false;
+        replay.replay_log = log;
+        for (size_t r : reads)
+            replay.replay_log.reads[r] = mockdb::decision_log::latest;
+        for (size_t p : selected)
+            replay.replay_log.reads[reads[p]] = log.reads[reads[p]];
+        return replay;
+    };
+    kept = shrink.minimize(reads.size(), [&ops, &log, &replay_config](const std::vector<size_t> &selected) {
+        app_config replay = replay_config(selected);
+        return violates(run_iteration(ops, log.seed, nullptr, &replay));
+    });
+    app_config replay = replay_config(kept);
+    mockdb::decision_log minimal;
+    run_iteration(ops, log.seed, &minimal, &replay);
+
+    std::cout << "Minimal program: " << minimal.program << ", " << kept.size() << " of " << reads.size()
+              << " reads not returning the latest version, found in " << shrink.get_test_count() << " tests\n";
+    if (config->record_file.empty())
+        return;
+    std::ofstream out(config->record_file);
+    minimal.write(out);
+    if (out)
+        std::cout << "Decision log of the minimal violation written to " << config->record_file
+                  << ", rerun it with replay=" << config->record_file << "\n";
+    else
+        std::cerr << "Can't write " << config->record_file << "\n";
 }
 
 /*
@@ -111,6 +268,8 @@ void run_iteration() {
  */
 int main(int argc, char **argv) {
     config = parse_command_line(argc, argv);
+    iteration_outcome outcome;
+    iteration_runner<iteration_outcome> runner(config->workers);
     std::cout << "Running stack application\n";
 
     if (!config->random_test){
@@ -122,6 +281,9 @@ int main(int argc, char **argv) {
                 {0, 0}
         };
     }
+    // A minimized violation replays its own program
+    if (config->replay && !config->replay_log.program.empty())
+        operations = decode_program(config->replay_log.program);
 
     for (int i = 1; i <= config->num_random_test; i++) {
 
@@ -132,38 +294,45 @@ int main(int argc, char **argv) {
             random_fill(i * 19 + 11);
         }
 
-        for (int j = 0; j < config->iterations; j++) {
+        // Each worker counts the violations of its iterations
+        auto iteration = [](int j, iteration_outcome &worker) {
+            std::vector<int> &worker_counter = worker.assert_counter;
+            int before = worker_counter[0];
             if (config->debug)
-                std::cout << "[MOCKDB::app] Iteration " << j << " start" << std::endl;
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " start");
 
             std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-            run_iteration();
+            mockdb::decision_log log;
+            std::vector<int> results = run_iteration(operations, config->seed + j, &log);
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-            check_pop_valid();
-
-            results[0] = results[1] = results[2] = results[3] = 0;
+            check_pop_valid(worker_counter, results);
+            worker.on_iteration(j, worker_counter[0] > before, log);
 
             std::stringstream ss;
-            for (auto k : assert_counter)
+            for (auto k : worker_counter)
                 ss << k << " ";
 
             if (config->debug) {
-                std::cout << "[MOCKDB::app] " << ss.str() << std::endl;
-                std::cout << "[MOCKDB::app] Iteration " << j << " end "
-                    << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
-                    << std::endl;
+                print_line("[MOCKDB::app] " + ss.str());
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " end " +
+                           std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()));
             }
-        }
+        };
+        merge_outcomes(outcome, runner.run(config->iterations, iteration_outcome(), iteration, merge_outcomes));
 
         if (config->random_test && config->debug) {
             std::cout << "[MOCKDB::app] RANDOM " << i - 1 << " end" << std::endl;
         }
     }
 
-    int violation_count = assert_counter[0];
+    int violation_count = outcome.assert_counter[0];
 
     std::cout << "Total violations found: " << violation_count
         << " in " << config->iterations << " iterations\n";
+    if (config->minimize && outcome.first_violation >= 0)
+        minimize_violation(outcome);
+    else
+        write_first_violation(config, outcome);
 
     delete config;
 
@@ -9,6 +9,7 @@
 #define EMPTY 0
 
 #include "../../kv_store/include/kv_store.h"
+#include "../../kv_store/include/cooperative_runner.h"
 
 #include <assert.h>
 #include <thread>
@@ -27,9 +28,11 @@ public:
      * Does push operation by:
      * 1. Generate unique id for new node and insert with dummy next id.
      * 2. Get the current head and replace it with this node, try until successful.
+     * Under a cooperative_runner, sessions switch at the start of push and pop and
+     * between reading the head and swapping it.
      */
     void push(V val, long session_id = 1) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 4));
+        mockdb::cooperative_runner::yield_current();
         // Insert node with dummy next pointer
         long new_head_id = store->get_size() * 10 + session_id;
         store->put(new_head_id, {val, -1});
@@ -43,6 +46,8 @@ public:
             } catch (std::exception &e) {
                 // Pass
             }
+            // Other sessions may move the head before the compare and swap
+            mockdb::cooperative_runner::yield_current();
             if (update_head(cur_head_id, new_head_id, session_id))
                 break;
         }
@@ -50,7 +55,7 @@ public:
 
 
     V pop(long session_id = 1) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 4));
+        mockdb::cooperative_runner::yield_current();
         while (true) {
             long cur_head_id = store->get(0, session_id).second;
 
@@ -78,6 +83,7 @@ public:
             V val = head.first;
 
             // Optional delete the current head from store
+            mockdb::cooperative_runner::yield_current();
             if (update_head(cur_head_id, head.second, session_id)) {
 
 #ifdef MOCKDB_APP_DEBUG_LOG
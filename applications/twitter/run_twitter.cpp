@@ -4,19 +4,18 @@
 //
 
 #include "../utils.h"
+#include "../iteration_runner.h"
 #include "../../kv_store/include/read_response_selector.h"
 #include "twitter.h"
 
-#include <thread>
+#include <random>
+#include <functional>
 #include <ctime>
 
 #define NUM_SESSIONS 3
 #define NUM_OPS 3
 
 app_config *config = nullptr;
-mockdb::kv_store<std::string, web::json::value> *store;
-std::vector<int> assert_counter(6, 0);
-std::vector<int> results(2, 0);
 
 // For random run
 std::vector<std::vector<int>> operations(NUM_SESSIONS);
@@ -30,7 +29,7 @@ void populate_twitter(twitter *twitter_store) {
     twitter_store->add_user(c);
 }
 
-void assert_count(bool result, int assert_index) {
+void assert_count(std::vector<int> &assert_counter, bool result, int assert_index) {
     if (result)
         assert_counter[assert_index]++;
 }
@@ -44,31 +43,31 @@ void assert_count(bool result, int assert_index) {
  * Tweets of recently followed user not showing up in newsfeed, even after viewing those
  * tweets through another session.
  */
-void do_op(twitter *twitter_store, int t_id) {
+void do_op(twitter *twitter_store, std::vector<int> &results, int t_id) {
     if (t_id == 1) {
-        twitter_store->tx_start();
+        twitter_store->tx_start(t_id);
         twitter_store->publish_tweet(a, tweet(1, "hello", 1));
-        twitter_store->tx_end();
+        twitter_store->tx_end(t_id);
 
-        twitter_store->tx_start();
+        twitter_store->tx_start(t_id);
         twitter_store->publish_tweet(a, tweet(2, "world", 2));
-        twitter_store->tx_end();
+        twitter_store->tx_end(t_id);
     }
     else if (t_id == 2) {
-        twitter_store->tx_start();
+        twitter_store->tx_start(t_id);
         twitter_store->follow(b, a);
-        twitter_store->tx_end();
+        twitter_store->tx_end(t_id);
 
-        twitter_store->tx_start();
+        twitter_store->tx_start(t_id);
         std::vector<tweet> newsfeed = twitter_store->get_newsfeed(b);
-        twitter_store->tx_end();
+        twitter_store->tx_end(t_id);
 
         results[1] = newsfeed.size();
     }
     else if (t_id == 3) {
-        twitter_store->tx_start();
+        twitter_store->tx_start(t_id);
         std::vector<tweet> timeline = twitter_store->get_timeline(a, t_id);
-        twitter_store->tx_end();
+        twitter_store->tx_end(t_id);
 
         results[0] = timeline.size();
     }
@@ -96,7 +95,9 @@ void random_fill(long seed) {
 void do_random_op(twitter *twitter_store, int t_id) {
     int idx = 0;
     for (int j = 1; j <= NUM_OPS; j++) {
-        twitter_store->tx_start();
+        // Operations act in the session of the user
+        long session_id = users[idx].get_id();
+        twitter_store->tx_start(session_id);
         if (operations[t_id - 1][j - 1] == 0) {
             twitter_store->follow(users[idx], users[(idx + 1) % users.size()]);
         }
@@ -109,46 +110,54 @@ void do_random_op(twitter *twitter_store, int t_id) {
                                                            tweet_msg,
                                                            std::time(0)));
         }
-        twitter_store->tx_end();
+        twitter_store->tx_end(session_id);
         idx = (idx + 1) % users.size();
     }
     // Last operation is fixed - a read operation
-    twitter_store->tx_start();
+    twitter_store->tx_start(t_id);
     twitter_store->get_all_timeline(t_id);
-    twitter_store->tx_end();
+    twitter_store->tx_end(t_id);
 }
 
-void run_iteration() {
+// Runs the sessions once recording their choices into log, returns the results of the fixed run
+std::vector<int> run_iteration(uint64_t seed, mockdb::decision_log *log = nullptr) {
     mockdb::read_response_selector<std::string, web::json::value> *get_next_tx;
 
     if (config->consistency_level == consistency::causal)
-        get_next_tx = new mockdb::causal_read_response_selector<std::string, web::json::value>();
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, web::json::value>(seed);
     else if (config->consistency_level == consistency::linear)
-        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, web::json::value>();
+        get_next_tx = new mockdb::linearizable_read_response_selector<std::string, web::json::value>(seed);
     else if (config->consistency_level == consistency::k_causal)
-        get_next_tx = new mockdb::k_causal_read_response_selector<std::string, web::json::value>(2, 12);
+        get_next_tx = new mockdb::k_causal_read_response_selector<std::string, web::json::value>(2, 12, seed);
+    else
+        get_next_tx = new_isolation_selector<std::string, web::json::value>(config->consistency_level, seed);
 
-    store = new mockdb::kv_store<std::string, web::json::value>(get_next_tx);
+    get_next_tx = wrap_selector(config, get_next_tx, log);
+
+    mockdb::kv_store<std::string, web::json::value> *store = new mockdb::kv_store<std::string, web::json::value>(get_next_tx);
     get_next_tx->init_consistency_checker(store);
 
     twitter *twitter_store = new twitter(store, config->consistency_level);
     populate_twitter(twitter_store);
 
-    std::vector<std::thread> threads;
+    std::vector<int> results(2, 0);
+    mockdb::session_scheduler *scheduler = new_scheduler(config, seed);
+    std::vector<std::function<void()>> sessions;
 
     for (int i = 1; i <= NUM_SESSIONS; i++) {
         if (config->random_test)
-            threads.push_back(std::thread(do_random_op, twitter_store, i));
+            sessions.push_back([twitter_store, i] { do_random_op(twitter_store, i); });
         else
-            threads.push_back(std::thread(do_op, twitter_store, i));
+            sessions.push_back([twitter_store, &results, i] { do_op(twitter_store, results, i); });
     }
-
-    for (auto &t : threads)
-        t.join();
+    scheduler->run(sessions);
+    end_decisions(config, get_next_tx, scheduler, seed, log);
+    delete scheduler;
 
     delete twitter_store;
     delete store;
     delete get_next_tx;
+    return results;
 }
 
 /*
@@ -158,6 +167,8 @@ void run_iteration() {
  */
 int main(int argc, char **argv) {
     config = parse_command_line(argc, argv);
+    iteration_outcome outcome;
+    iteration_runner<iteration_outcome> runner(config->workers);
 
     for (int i = 1; i <= config->num_random_test; i++) {
 
@@ -168,28 +179,31 @@ int main(int argc, char **argv) {
             random_fill(i * 19 + 11);
         }
 
-        for(int j = 0; j < config->iterations; j++) {
+        // Each worker counts the violations of its iterations
+        auto iteration = [](int j, iteration_outcome &worker) {
+            std::vector<int> &worker_counter = worker.assert_counter;
+            int before = worker_counter[0];
             if (config->debug)
-                std::cout << "[MOCKDB::app] Iteration " << j << " start" << std::endl;
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " start");
 
             std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-            run_iteration();
+            mockdb::decision_log log;
+            std::vector<int> results = run_iteration(config->seed + j, &log);
             std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-            assert_count(results[0] > results[1], 0);
-
-            results[0] = results[1] = 0;
+            assert_count(worker_counter, results[0] > results[1], 0);
+            worker.on_iteration(j, worker_counter[0] > before, log);
 
             std::stringstream ss;
-            for (auto k : assert_counter)
+            for (auto k : worker_counter)
                 ss << k << " ";
 
             if (config->debug) {
-                std::cout << "[MOCKDB::app] " << ss.str() << std::endl;
-                std::cout << "[MOCKDB::app] Iteration " << j << " end "
-                    << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()
-                    << std::endl;
+                print_line("[MOCKDB::app] " + ss.str());
+                print_line("[MOCKDB::app] Iteration " + std::to_string(j) + " end " +
+                           std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()));
             }
-        }
+        };
+        merge_outcomes(outcome, runner.run(config->iterations, iteration_outcome(), iteration, merge_outcomes));
 
         if (config->random_test && config->debug) {
             std::cout << "[MOCKDB::app] RANDOM " << i - 1 << " end" << std::endl;
@@ -197,10 +211,11 @@ int main(int argc, char **argv) {
     }
 
 
-    int violation_count = assert_counter[0];
+    int violation_count = outcome.assert_counter[0];
 
     std::cout << "Total violations found: " << violation_count
         << " in " << config->iterations << " iterations\n";
+    write_first_violation(config, outcome);
 
     delete config;
     return 0;
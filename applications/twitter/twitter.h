@@ -9,6 +9,7 @@
 #include "user.h"
 #include "../../kv_store/include/kv_store.h"
 #include "../app_config.h"
+#include "../utils.h"
 
 #include <cpprest/json.h>
 #include <thread>
@@ -83,14 +84,14 @@ public:
     long following_count(user u, long session_id = 1);
     long followers_count(user u, long session_id = 1);
 
-    void tx_start();
-    void tx_end();
+    void tx_start(long session_id);
+    void tx_end(long session_id);
 private:
     std::vector<tweet> _get_newsfeed(long user_id);
     std::vector<tweet> _get_timeline(long user_id, long session_id = 1);
+    std::map<long, std::vector<tweet>> _get_timelines(const std::vector<long> &user_ids, long session_id = 1);
 
     mockdb::kv_store<std::string, web::json::value> *store;
-    std::mutex mtx;
 };
 
 twitter::twitter(mockdb::kv_store<std::string, web::json::value> *store,
@@ -125,13 +126,14 @@ void twitter::add_user(user u) {
     store->put("user:" + std::to_string(u.get_id()) + ":tweets", user_json, u.get_id());
 }
 
-void twitter::tx_start() {
-    std::this_thread::sleep_for(std::chrono::milliseconds(rand() % 4));
-    mtx.lock();
+// Operations of the session up to tx_end form one store transaction. Under a
+// session_scheduler, sessions switch at begin.
+void twitter::tx_start(long session_id) {
+    this->store->begin(session_id);
 }
 
-void twitter::tx_end() {
-    mtx.unlock();
+void twitter::tx_end(long session_id) {
+    this->store->commit(session_id);
 }
 
 // user a follows user b
@@ -203,13 +205,18 @@ std::vector<tweet> twitter::get_all_timeline(long session_id) {
     std::vector<tweet> res;
     web::json::value user_list;
     try {
-        user_list = store->get("users");
+        user_list = store->get("users", session_id);
     } catch (std::exception &e) {
         return res;
     }
 
+    std::vector<long> user_ids;
     for (auto &i : user_list[L"list"].as_array()) {
-        std::vector<tweet> tweets = _get_timeline(i.as_integer(), session_id);
+        user_ids.push_back(i.as_integer());
+    }
+    std::map<long, std::vector<tweet>> timelines = _get_timelines(user_ids, session_id);
+    for (long user_id : user_ids) {
+        std::vector<tweet> &tweets = timelines[user_id];
         res.insert(res.end(), tweets.begin(), tweets.end());
     }
     return res;
@@ -229,10 +236,15 @@ std::vector<tweet> twitter::_get_newsfeed(long user_id) {
     }
 
     // Fetch tweets of following users
+    std::vector<long> following_ids;
     for (auto &i : following[L"list"].as_array()) {
-        std::vector<tweet> tweets_by_user = _get_timeline(i.as_integer(), user_id);
+        following_ids.push_back(i.as_integer());
+    }
+    std::map<long, std::vector<tweet>> timelines = _get_timelines(following_ids, user_id);
+    for (long following_id : following_ids) {
+        std::vector<tweet> &tweets_by_user = timelines[following_id];
         for (auto t : tweets_by_user) {
-            state_log[i.as_integer()].push_back(t.get_id());
+            state_log[following_id].push_back(t.get_id());
         }
 
         timeline.insert(timeline.end(), tweets_by_user.begin(), tweets_by_user.end());
@@ -274,55 +286,83 @@ std::vector<tweet> twitter::get_timeline(user u, long session_id) {
 }
 
 std::vector<tweet> twitter::_get_timeline(long user_id, long session_id) {
-    std::vector<tweet> all_tweets;
-    web::json::value tweets;
-    try {
-        tweets = store->get("user:" + std::to_string(user_id) + ":tweets", session_id);
-    } catch (std::exception &e) {
-        std::cout << "tweets doesn't exist\n";
-        return all_tweets;
+    return _get_timelines(std::vector<long>(1, user_id), session_id)[user_id];
+}
+
+/*
+ * Timelines of the given users, each sorted by timestamp. The tweet lists of all
+ * users and then all their tweets are read in one batch each; a list or tweet
+ * which can't be read is skipped.
+ */
+std::map<long, std::vector<tweet>> twitter::_get_timelines(const std::vector<long> &user_ids, long session_id) {
+    std::map<long, std::vector<tweet>> timelines;
+    std::vector<std::string> keys;
+    for (long user_id : user_ids) {
+        timelines[user_id];
+        keys.push_back("user:" + std::to_string(user_id) + ":tweets");
+    }
+
+    std::vector<std::pair<web::json::value, size_t>> tweet_lists = multi_get_each(store, keys, session_id);
+
+    // Ids of the tweets to fetch along with their authors
+    std::vector<std::pair<long, int>> tweet_ids;
+    keys.clear();
+    for (size_t i = 0; i < user_ids.size(); i++) {
+        if (tweet_lists[i].second == 0) {
+            std::cout << "tweets doesn't exist\n";
+            continue;
+        }
+        for (auto &t : tweet_lists[i].first[L"list"].as_array()) {
+            tweet_ids.push_back({user_ids[i], t.as_integer()});
+            keys.push_back("tweet:" + std::to_string(t.as_integer()));
+        }
     }
-    for (auto &t : tweets[L"list"].as_array()) {
-        web::json::value tweet_json;
-        try {
-            tweet_json = store->get("tweet:" + std::to_string(t.as_integer()), session_id);
-        } catch (std::exception &e) {
+
+    std::vector<std::pair<web::json::value, size_t>> tweets = multi_get_each(store, keys, session_id);
+
+    for (size_t i = 0; i < tweet_ids.size(); i++) {
+        if (tweets[i].second == 0) {
             std::cout << "tweet doesn't exist\n";
             continue;
         }
-        tweet tweet_obj(t.as_integer(), utility::conversions::to_utf8string(tweet_json[L"content"].as_string()), tweet_json[L"timestamp"].as_integer());
+        web::json::value &tweet_json = tweets[i].first;
+        tweet tweet_obj(tweet_ids[i].second, utility::conversions::to_utf8string(tweet_json[L"content"].as_string()), tweet_json[L"timestamp"].as_integer());
         tweet_obj.set_likes(tweet_json[L"likes"].as_integer());
         tweet_obj.set_retweets(tweet_json[L"retweets"].as_integer());
-        all_tweets.push_back(tweet_obj);
+        timelines[tweet_ids[i].first].push_back(tweet_obj);
     }
 
-    // Sort tweets based on timestamp
-    std::sort(all_tweets.begin(), all_tweets.end(),
-              [](const tweet &a, const tweet &b) {
-                  return (a.get_timestamp() < b.get_timestamp());
-              });
-
-    // Log tweets
-    std::stringstream ss;
-    ss << "(" << user_id << ": ";
-    for (int i = 0; i < all_tweets.size(); i++) {
-        ss << all_tweets[i].get_id();
-        if (i != all_tweets.size() - 1)
-            ss << " ";
-    }
-    ss << ") ";
+    for (long user_id : user_ids) {
+        std::vector<tweet> &all_tweets = timelines[user_id];
+
+        // Sort tweets based on timestamp
+        std::sort(all_tweets.begin(), all_tweets.end(),
+                  [](const tweet &a, const tweet &b) {
+                      return (a.get_timestamp() < b.get_timestamp());
+                  });
+
+        // Log tweets
+        std::stringstream ss;
+        ss << "(" << user_id << ": ";
+        for (int i = 0; i < all_tweets.size(); i++) {
+            ss << all_tweets[i].get_id();
+            if (i != all_tweets.size() - 1)
+                ss << " ";
+        }
+        ss << ") ";
 
-    std::string val = ss.str();
+        std::string val = ss.str();
 
-    if (val.size() != 0) {
+        if (val.size() != 0) {
 
 #ifdef MOCKDB_APP_DEBUG_LOG
-        std::cout << "[MOCKDB::app] " << val << std::endl;
+            std::cout << "[MOCKDB::app] " << val << std::endl;
 #endif // MOCKDB_APP_DEBUG_LOG
 
+        }
     }
 
-    return all_tweets;
+    return timelines;
 }
 
 std::vector<long> twitter::get_following(user u, long session_id) {
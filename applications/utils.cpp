@@ -5,8 +5,13 @@
 
 #include "utils.h"
 
+#include "iteration_runner.h"
+#include "../kv_store/include/trace_buffer.h"
+
 #include <iostream>
+#include <fstream>
 #include <cstring>
+#include <mutex>
 
 app_config *parse_command_line(int argc, char **argv) {
     app_config *config      = new app_config();
@@ -14,14 +19,74 @@ app_config *parse_command_line(int argc, char **argv) {
     char *consistency_arg   = argv[2];
     config->random_test     = false;
     config->num_random_test = 1;
+    config->seed            = mockdb::random_seed();
+    bool seeded             = false;
 
-    if (argc > 3) {
-        char* debug_arg = argv[3];
-        if (strcmp(debug_arg, "debug") == 0) {
+    // Optional: "debug", "explore", "seed=<n>", "pct", "pct=<depth>", "steps=<n>", "workers=<n>",
+    // "record=<file>", "replay=<file>", "minimize", "trace=<file>"
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "debug") == 0) {
             config->debug = true;
         }
+        else if (strcmp(argv[i], "explore") == 0) {
+            config->explore = true;
+        }
+        else if (strncmp(argv[i], "seed=", 5) == 0) {
+            config->seed = strtoull(argv[i] + 5, nullptr, 10);
+            seeded = true;
+        }
+        else if (strncmp(argv[i], "workers=", 8) == 0) {
+            config->workers = atoi(argv[i] + 8);
+        }
+        else if (strcmp(argv[i], "pct") == 0) {
+            config->pct_depth = 3;
+        }
+        else if (strncmp(argv[i], "pct=", 4) == 0) {
+            config->pct_depth = atoi(argv[i] + 4);
+        }
+        else if (strncmp(argv[i], "steps=", 6) == 0) {
+            config->pct_steps = strtoull(argv[i] + 6, nullptr, 10);
+        }
+        else if (strcmp(argv[i], "minimize") == 0) {
+            config->minimize = true;
+        }
+        else if (strncmp(argv[i], "trace=", 6) == 0) {
+            config->trace_file = argv[i] + 6;
+        }
+        else if (strncmp(argv[i], "record=", 7) == 0) {
+            config->record_file = argv[i] + 7;
+        }
+        else if (strncmp(argv[i], "replay=", 7) == 0) {
+            std::ifstream in(argv[i] + 7);
+            try {
+                config->replay_log = mockdb::decision_log::read(in);
+            } catch (std::exception &e) {
+                std::cerr << "Can't replay " << argv[i] + 7 << ": " << e.what() << "\n";
+                exit(-1);
+            }
+            // The one recorded execution
+            config->replay = true;
+            config->seed = config->replay_log.seed;
+            seeded = true;
+            config->iterations = 1;
+            config->record_file = "";
+        }
     }
 
+    // Printed so that the run can be repeated with seed=<n>
+    if (!seeded)
+        std::cout << "seed=" << config->seed << "\n";
+
+    if (!config->trace_file.empty()) {
+        // Stopped, and the last events written, when the program exits
+        try {
+            mockdb::tracer::instance().start(config->trace_file);
+        } catch (std::exception &e) {
+            std::cerr << e.what() << "\n";
+            exit(-1);
+        }
+        std::cout << "Tracing into " << config->trace_file << "\n";
+    }
 
     if (strcmp(consistency_arg, "linear") == 0) {
         std::cout << "linearizability consistency\n";
@@ -35,6 +100,62 @@ app_config *parse_command_line(int argc, char **argv) {
         std::cout << "k-causal consistency\n";
         config->consistency_level = consistency::k_causal;
     }
+    else {
+        // Weaker isolation levels, see new_isolation_selector
+        static const std::pair<const char *, consistency> levels[] = {
+                {"read-committed", consistency::read_committed},
+                {"read-atomic", consistency::read_atomic},
+                {"read-your-writes", consistency::read_your_writes},
+                {"monotonic-reads", consistency::monotonic_reads},
+                {"monotonic-writes", consistency::monotonic_writes},
+                {"writes-follow-reads", consistency::writes_follow_reads},
+                {"snapshot-isolation", consistency::snapshot_isolation},
+                {"parallel-snapshot-isolation", consistency::parallel_snapshot_isolation}
+        };
+        for (auto &level : levels) {
+            if (strcmp(consistency_arg, level.first) == 0) {
+                std::cout << level.first << " isolation\n";
+                config->consistency_level = level.second;
+            }
+        }
+    }
 
     return config;
 }
+
+mockdb::session_scheduler *new_scheduler(const app_config *config, uint64_t seed) {
+    if (config->replay)
+        return new mockdb::session_scheduler(config->replay_log.schedule);
+    // Draw from a different stream than the read response selector of the same seed
+    uint64_t scheduler_seed = mockdb::random_generator(seed).next();
+    if (config->pct_depth > 0) {
+        // A scheduler only sees one run, its change points are drawn over the configured bound
+        return new mockdb::session_scheduler(scheduler_seed, mockdb::session_scheduler::policy::PCT,
+                                             config->pct_depth, config->pct_steps);
+    }
+    return new mockdb::session_scheduler(scheduler_seed);
+}
+
+void print_line(const std::string &line) {
+    static std::mutex mtx;
+    std::lock_guard<std::mutex> lck(mtx);
+    std::cout << line << std::endl;
+}
+
+void merge_outcomes(iteration_outcome &total, const iteration_outcome &worker) {
+    add_counters(total.assert_counter, worker.assert_counter);
+    if (worker.first_violation >= 0)
+        total.on_iteration(worker.first_violation, true, worker.first_log);
+}
+
+void write_first_violation(const app_config *config, const iteration_outcome &outcome) {
+    if (outcome.first_violation < 0 || config->record_file.empty())
+        return;
+    std::ofstream out(config->record_file);
+    outcome.first_log.write(out);
+    if (out)
+        std::cout << "Decision log of iteration " << outcome.first_violation << " written to "
+                  << config->record_file << ", rerun it with replay=" << config->record_file << "\n";
+    else
+        std::cerr << "Can't write " << config->record_file << "\n";
+}
@@ -7,9 +7,118 @@
 #define MOCK_KEY_VALUE_STORE_APP_UTILS_H
 
 #include "app_config.h"
+#include "../kv_store/include/decision_log.h"
+#include "../kv_store/include/read_response_selector.h"
+#include "../kv_store/include/session_scheduler.h"
 
 #include <string>
+#include <vector>
 
 app_config *parse_command_line(int argc, char **argv);
 
+// Writes a whole line to stdout, lines of concurrent iterations don't interleave
+void print_line(const std::string &line);
+
+/*
+ * Scheduler of the sessions of the iteration with the given seed, or of the replay.
+ * Under PCT its change points are drawn over config->pct_steps steps, so the
+ * schedule only depends on the seed and the configuration.
+ */
+mockdb::session_scheduler *new_scheduler(const app_config *config, uint64_t seed);
+
+/*
+ * Reads keys in one batch in which a key without a consistent version only fails
+ * itself. Keys which don't exist or can't be read come back with version number 0;
+ * every key is read, and recorded in the history, once.
+ */
+template <typename K, typename V>
+std::vector<std::pair<V, size_t>> multi_get_each(mockdb::kv_store<K, V> *store, const std::vector<K> &keys,
+                                                 long session_id) {
+    std::vector<bool> inconsistent;
+    return store->multi_get(keys, session_id, &inconsistent);
+}
+
+/*
+ * Read response selector of the isolation levels other than linear, causal and
+ * k-causal, whose selectors the applications size themselves; nullptr for those.
+ */
+template <typename K, typename V>
+mockdb::read_response_selector<K, V> *new_isolation_selector(consistency level, uint64_t seed) {
+    switch (level) {
+        case consistency::read_committed:
+            return new mockdb::read_committed_read_response_selector<K, V>(seed);
+        case consistency::read_atomic:
+            return new mockdb::read_atomic_read_response_selector<K, V>(seed);
+        case consistency::read_your_writes:
+            return new mockdb::read_your_writes_read_response_selector<K, V>(seed);
+        case consistency::monotonic_reads:
+            return new mockdb::monotonic_reads_read_response_selector<K, V>(seed);
+        case consistency::monotonic_writes:
+            return new mockdb::monotonic_writes_read_response_selector<K, V>(seed);
+        case consistency::writes_follow_reads:
+            return new mockdb::writes_follow_reads_read_response_selector<K, V>(seed);
+        case consistency::snapshot_isolation:
+            return new mockdb::snapshot_isolation_read_response_selector<K, V>(seed);
+        case consistency::parallel_snapshot_isolation:
+            return new mockdb::parallel_snapshot_isolation_read_response_selector<K, V>(seed);
+        default:
+            return nullptr;
+    }
+}
+
+/*
+ * Wraps the read response selector of an iteration to replay config->replay_log, and
+ * to record the reads it makes into log. Without a log and replay it is left as is.
+ */
+template <typename K, typename V>
+mockdb::read_response_selector<K, V> *wrap_selector(const app_config *config,
+                                                    mockdb::read_response_selector<K, V> *selector,
+                                                    mockdb::decision_log *log) {
+    if (config->replay)
+        selector = new mockdb::replaying_read_response_selector<K, V>(selector, config->replay_log);
+    if (log != nullptr)
+        selector = new mockdb::recording_read_response_selector<K, V>(selector, log);
+    return selector;
+}
+
+/*
+ * Once the sessions are done: completes log, and reports whether the replay
+ * diverged.
+ */
+template <typename K, typename V>
+void end_decisions(const app_config *config, mockdb::read_response_selector<K, V> *selector,
+                   const mockdb::session_scheduler *scheduler, uint64_t seed, mockdb::decision_log *log) {
+    if (log != nullptr) {
+        log->seed = seed;
+        log->schedule = scheduler->get_schedule();
+        selector = static_cast<mockdb::recording_read_response_selector<K, V> *>(selector)->get_inner();
+    }
+    if (config->replay) {
+        auto *replaying = dynamic_cast<mockdb::replaying_read_response_selector<K, V> *>(selector);
+        if (config->report_divergence &&
+            (scheduler->has_diverged() || (replaying != nullptr && replaying->has_diverged())))
+            print_line("[MOCKDB::app] Replay diverged from the decision log");
+    }
+}
+
+// Violations counted by the iterations of a worker, and the first violating one
+struct iteration_outcome {
+    std::vector<int> assert_counter = std::vector<int>(6, 0);
+    int first_violation = -1;
+    mockdb::decision_log first_log;
+
+    // Keeps the decision log of iteration j if it is the first one found violating
+    void on_iteration(int j, bool violation, const mockdb::decision_log &log) {
+        if (violation && (this->first_violation < 0 || j < this->first_violation)) {
+            this->first_violation = j;
+            this->first_log = log;
+        }
+    }
+};
+
+void merge_outcomes(iteration_outcome &total, const iteration_outcome &worker);
+
+// Writes the decision log of the first violating iteration to config->record_file
+void write_first_violation(const app_config *config, const iteration_outcome &outcome);
+
 #endif //MOCK_KEY_VALUE_STORE_APP_UTILS_H
@@ -0,0 +1,70 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Heap allocations per GET and PUT, counted through the global operator new.
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+std::atomic_long allocation_count(0);
+
+void *operator new(size_t size) {
+    allocation_count++;
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void count(const std::string &name, mockdb::read_response_selector<std::string, int> *read_selector, int num_ops) {
+    mockdb::kv_store<std::string, int> *store = new mockdb::kv_store<std::string, int>(read_selector);
+    read_selector->init_consistency_checker(store);
+
+    // Warm up, so that every key and session already exists
+    for (int i = 0; i < 64; i++)
+        store->put("key:" + std::to_string(i % 8), i, i % 4);
+
+    long before = allocation_count;
+    for (int i = 0; i < num_ops; i++)
+        store->put("key:" + std::to_string(i % 8), i, i % 4);
+    long put_allocations = allocation_count - before;
+
+    before = allocation_count;
+    for (int i = 0; i < num_ops; i++)
+        store->get("key:" + std::to_string(i % 8), i % 4);
+    long get_allocations = allocation_count - before;
+
+    std::cout << name << "\t" << (double) put_allocations / num_ops << "\t"
+              << (double) get_allocations / num_ops << std::endl;
+
+    delete store;
+    delete read_selector;
+}
+
+/*
+ * Args:
+ * num of operations (default 100000)
+ */
+int main(int argc, char **argv) {
+    int num_ops = argc > 1 ? atoi(argv[1]) : 100000;
+
+    std::cout << "selector\tallocations/PUT\tallocations/GET" << std::endl;
+    count("linearizable", new mockdb::linearizable_read_response_selector<std::string, int>(), num_ops);
+    count("causal", new mockdb::causal_read_response_selector<std::string, int>(), num_ops);
+    return 0;
+}
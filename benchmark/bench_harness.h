@@ -0,0 +1,267 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Minimal microbenchmark runner in the style of Google Benchmark.
+
+#ifndef MOCK_KEY_VALUE_STORE_BENCH_HARNESS_H
+#define MOCK_KEY_VALUE_STORE_BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace mockdb {
+    namespace bench {
+        // Keeps the compiler from dropping a computation whose result isn't used
+        template <typename T>
+        inline void do_not_optimize(const T &value) {
+#ifdef _MSC_VER
+            static volatile const void *sink;
+            sink = &value;
+            _ReadWriteBarrier();
+#else
+            asm volatile("" : : "r,m"(value) : "memory");
+#endif
+        }
+
+        /*
+         * Handed to a benchmark function, which sets up its data and then loops
+         *   while (state.keep_running()) { ... }
+         * Only the loop is timed, minus the time between pause and resume inside it.
+         */
+        class state {
+        public:
+            state(size_t iterations, const std::vector<long> &args) : iterations(iterations), args(args) {
+            }
+
+            bool keep_running() {
+                if (this->done == 0)
+                    this->start = std::chrono::steady_clock::now();
+                if (this->done++ < this->iterations)
+                    return true;
+                this->elapsed += std::chrono::steady_clock::now() - this->start;
+                return false;
+            }
+
+            void pause() {
+                this->elapsed += std::chrono::steady_clock::now() - this->start;
+            }
+
+            void resume() {
+                this->start = std::chrono::steady_clock::now();
+            }
+
+            size_t get_iterations() const {
+                return this->iterations;
+            }
+
+            long arg(size_t i) const {
+                return this->args.at(i);
+            }
+
+            // Items per iteration default to 1
+            void set_items_processed(size_t items) {
+                this->items = items;
+            }
+
+            // Reported next to the timings, e.g. a quantity the benchmark measured besides time
+            void set_counter(const std::string &name, double value) {
+                this->counters[name] = value;
+            }
+
+            double get_seconds() const {
+                return std::chrono::duration<double>(this->elapsed).count();
+            }
+
+            size_t get_items_processed() const {
+                return this->items == (size_t) -1 ? this->iterations : this->items;
+            }
+
+            const std::map<std::string, double> &get_counters() const {
+                return this->counters;
+            }
+
+        private:
+            size_t iterations;
+            std::vector<long> args;
+            size_t done = 0;
+            size_t items = (size_t) -1;
+            std::map<std::string, double> counters;
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::duration::zero();
+        };
+
+        typedef std::function<void(state &)> function;
+
+        /*
+         * Registered benchmarks, each run once per argument list. A run starts with
+         * one iteration and grows the count until the loop takes min_time seconds.
+         *
+         * Command line:
+         *   --filter=<text>       only benchmarks whose name contains text
+         *   --min_time=<seconds>  default 0.5
+         *   --format=json         JSON on standard output instead of a table
+         *   --out=<path>          also write the JSON to path
+         * The JSON follows Google Benchmark's layout: a context object and a list of
+         * benchmarks with name, iterations, real_time and time_unit (ns per
+         * iteration), items_per_second and the counters.
+         */
+        class registry {
+        public:
+            void add(const std::string &name, const function &run,
+                     const std::vector<std::vector<long>> &arg_lists = {{}}) {
+                for (const auto &args : arg_lists)
+                    this->benchmarks.push_back({name, run, args});
+            }
+
+            int run(int argc, char **argv) {
+                std::string filter, format = "console", out;
+                double min_time = 0.5;
+                for (int i = 1; i < argc; i++) {
+                    std::string arg = argv[i];
+                    if (arg.compare(0, 9, "--filter=") == 0)
+                        filter = arg.substr(9);
+                    else if (arg.compare(0, 11, "--min_time=") == 0)
+                        min_time = std::stod(arg.substr(11));
+                    else if (arg.compare(0, 9, "--format=") == 0)
+                        format = arg.substr(9);
+                    else if (arg.compare(0, 6, "--out=") == 0)
+                        out = arg.substr(6);
+                    else {
+                        std::cerr << "Unknown argument " << arg << "\n";
+                        return 1;
+                    }
+                }
+
+                bool console = format != "json";
+                if (console)
+                    std::cout << std::left << std::setw(48) << "Benchmark" << std::right << std::setw(14) << "Time"
+                              << std::setw(14) << "Iterations" << "  Counters\n";
+                std::vector<result> results;
+                for (const auto &b : this->benchmarks) {
+                    std::string name = full_name(b);
+                    if (name.find(filter) == std::string::npos)
+                        continue;
+                    result r = measure(b, name, min_time);
+                    if (console)
+                        print(r);
+                    results.push_back(r);
+                }
+
+                if (!console)
+                    write_json(std::cout, results);
+                if (!out.empty()) {
+                    std::ofstream file(out);
+                    write_json(file, results);
+                }
+                return 0;
+            }
+
+        private:
+            struct benchmark {
+                std::string name;
+                function run;
+                std::vector<long> args;
+            };
+
+            struct result {
+                std::string name;
+                size_t iterations;
+                double ns_per_iteration;
+                double items_per_second;
+                std::map<std::string, double> counters;
+            };
+
+            std::vector<benchmark> benchmarks;
+
+            static std::string full_name(const benchmark &b) {
+                std::string name = b.name;
+                for (long arg : b.args)
+                    name += "/" + std::to_string(arg);
+                return name;
+            }
+
+            static result measure(const benchmark &b, const std::string &name, double min_time) {
+                size_t iterations = 1;
+                while (true) {
+                    state s(iterations, b.args);
+                    b.run(s);
+                    double seconds = s.get_seconds();
+                    if (seconds >= min_time || iterations >= 1000000000) {
+                        return {name, iterations, seconds * 1e9 / iterations,
+                                seconds > 0 ? s.get_items_processed() / seconds : 0, s.get_counters()};
+                    }
+                    // Aim a little past min_time, growing at most tenfold
+                    double factor = seconds > 0 ? min_time * 1.4 / seconds : 10;
+                    iterations = (size_t) (iterations * std::min(std::max(factor, 2.0), 10.0));
+                }
+            }
+
+            static void print(const result &r) {
+                std::cout << std::left << std::setw(48) << r.name << std::right << std::setw(11) << std::fixed
+                          << std::setprecision(1) << r.ns_per_iteration << " ns" << std::setw(14) << r.iterations;
+                std::cout << "  items/s=" << std::setprecision(0) << r.items_per_second;
+                for (const auto &c : r.counters)
+                    std::cout << " " << c.first << "=" << std::setprecision(2) << c.second;
+                std::cout << std::endl;
+            }
+
+            static std::string quoted(const std::string &text) {
+                std::string q = "\"";
+                for (char c : text) {
+                    if (c == '"' || c == '\\')
+                        q += '\\';
+                    q += c;
+                }
+                return q + "\"";
+            }
+
+            static void write_json(std::ostream &out, const std::vector<result> &results) {
+                char date[32];
+                std::time_t now = std::time(nullptr);
+                std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+                out << std::setprecision(10);
+                out << "{\n  \"context\": {\n";
+                out << "    \"date\": " << quoted(date) << ",\n";
+                out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+                out << "    \"library_build_type\": \"release\"\n";
+#else
+                out << "    \"library_build_type\": \"debug\"\n";
+#endif
+                out << "  },\n  \"benchmarks\": [";
+                for (size_t i = 0; i < results.size(); i++) {
+                    const result &r = results[i];
+                    out << (i == 0 ? "\n" : ",\n") << "    {\n";
+                    out << "      \"name\": " << quoted(r.name) << ",\n";
+                    out << "      \"iterations\": " << r.iterations << ",\n";
+                    out << "      \"real_time\": " << r.ns_per_iteration << ",\n";
+                    out << "      \"time_unit\": \"ns\",\n";
+                    out << "      \"items_per_second\": " << r.items_per_second;
+                    for (const auto &c : r.counters)
+                        out << ",\n      " << quoted(c.first) << ": " << c.second;
+                    out << "\n    }";
+                }
+                out << "\n  ]\n}\n";
+            }
+        };
+    }
+}
+
+#endif //MOCK_KEY_VALUE_STORE_BENCH_HARNESS_H
@@ -0,0 +1,128 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Causal read selection: rejection sampling over all candidates vs. sampling
+// directly from the admissible suffix.
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef mockdb::transaction<std::string, int> tx_t;
+
+mockdb::tx_id_allocator tx_ids;
+
+tx_t *make_put(long session_id, const std::string &key, size_t version_number) {
+    mockdb::PUT_operation<std::string, int> *op =
+            new mockdb::PUT_operation<std::string, int>(new mockdb::PUT_param<std::string, int>(key, 0));
+    mockdb::PUT_response<std::string, int> *response = new mockdb::PUT_response<std::string, int>(true);
+    response->set_version_number(version_number);
+    op->set_response(response);
+    tx_t *tx = new tx_t(tx_ids.next(), op);
+    tx->set_session_id(session_id);
+    return tx;
+}
+
+// Operations don't own their parameters and responses
+void delete_tx(tx_t *tx) {
+    const mockdb::operation<std::string, int> *op = tx->get_operation();
+    delete op->get_response();
+    delete op->get_params();
+    delete op;
+    delete tx;
+}
+
+// The previous algorithm: draw candidates at random until the checker accepts one
+size_t rejection_sample(mockdb::causal_consistency_checker<std::string, int> *checker, tx_t *tx,
+                        const mockdb::candidate_view<std::string, int> &candidates,
+                        std::mt19937 &gen, long &checks) {
+    std::vector<size_t> indices(candidates.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    size_t limit = candidates.size();
+    while (limit > 0) {
+        std::uniform_int_distribution<size_t> dist(0, limit - 1);
+        std::swap(indices[dist(gen)], indices[limit - 1]);
+        size_t candidate = indices[--limit];
+        checks++;
+        if (checker->is_consistent(tx, candidates.get_tx_id(candidate)))
+            return candidate;
+    }
+    return candidates.size();
+}
+
+/*
+ * Session 1 writes all versions except the second to last, which session 2 writes,
+ * so session 2 may only read the last two versions.
+ */
+void run(size_t num_versions, int reads) {
+    mockdb::causal_read_response_selector<std::string, int> *selector =
+            new mockdb::causal_read_response_selector<std::string, int>();
+    mockdb::kv_store<std::string, int> *store = new mockdb::kv_store<std::string, int>(selector);
+    selector->init_consistency_checker(store);
+    mockdb::causal_consistency_checker<std::string, int> *checker =
+            new mockdb::causal_consistency_checker<std::string, int>(store);
+
+    mockdb::arena memory;
+    mockdb::version_chain<int> chain(&memory);
+    std::vector<tx_t *> txs;
+    for (size_t v = 1; v <= num_versions; v++) {
+        long session_id = v == num_versions - 1 ? 2 : 1;
+        tx_t *tx = make_put(session_id, "x", v);
+        chain.append(0, tx->get_tx_id());
+        selector->on_commit(tx);
+        checker->on_commit(tx);
+        txs.push_back(tx);
+    }
+
+    std::string key = "x";
+    mockdb::candidate_view<std::string, int> candidates(key, chain);
+    mockdb::GET_operation<std::string, int> *op =
+            new mockdb::GET_operation<std::string, int>(new mockdb::GET_param<std::string, int>(key));
+    tx_t *reader = new tx_t(tx_ids.next(), op);
+    reader->set_session_id(2);
+
+    std::mt19937 gen(42);
+    long checks = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++)
+        rejection_sample(checker, reader, candidates, gen, checks);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double rejection_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / (double) reads;
+
+    size_t last_two = 0;
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++)
+        last_two += selector->select_read_response(reader, op, candidates) >= num_versions - 2;
+    end = std::chrono::steady_clock::now();
+    double range_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / (double) reads;
+
+    std::cout << num_versions << "\t" << (double) checks / reads << "\t" << rejection_ns << "\t"
+              << range_ns << "\t" << (last_two == (size_t) reads ? "yes" : "NO") << std::endl;
+
+    delete_tx(reader);
+    for (auto tx : txs)
+        delete_tx(tx);
+    delete checker;
+    delete store;
+    delete selector;
+}
+
+/*
+ * Args:
+ * num of reads per configuration (default 2000)
+ */
+int main(int argc, char **argv) {
+    int reads = argc > 1 ? atoi(argv[1]) : 2000;
+
+    std::cout << "versions\tchecks/read (rejection)\trejection ns/read\trange ns/read\tonly last two" << std::endl;
+    for (size_t n = 10; n <= 100000; n *= 10)
+        run(n, reads);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Throughput of the causal consistency checker over a long history.
+
+#include "kv_store.h"
+#include "consistency_checker.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef mockdb::transaction<std::string, int> tx_t;
+
+mockdb::tx_id_allocator tx_ids;
+
+// Operations don't own their parameters and responses
+void delete_tx(tx_t *tx) {
+    const mockdb::operation<std::string, int> *op = tx->get_operation();
+    delete op->get_response();
+    delete op->get_params();
+    delete op;
+    delete tx;
+}
+
+/*
+ * Every fourth entry is a PUT, the rest are GETs reading one of the last versions
+ * of the key. Entries are created and committed in batches, only on_commit and
+ * is_consistent are timed.
+ */
+void run(size_t num_entries, size_t num_keys, long num_sessions) {
+    mockdb::causal_consistency_checker<std::string, int> checker(nullptr);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < num_keys; i++)
+        keys.push_back("key" + std::to_string(i));
+    std::vector<std::vector<long>> writers(num_keys);   // key -> tx id per version
+
+    std::mt19937 gen(42);
+    const size_t batch_size = 64 * 1024;
+    std::vector<tx_t *> batch;
+    std::vector<long> reads_from;
+    double commit_ns = 0, check_ns = 0;
+    size_t checks = 0, consistent = 0;
+
+    for (size_t done = 0; done < num_entries; done += batch.size()) {
+        batch.clear();
+        reads_from.clear();
+        for (size_t i = 0; i < batch_size && done + i < num_entries; i++) {
+            size_t key = gen() % num_keys;
+            long session_id = 1 + (long) (gen() % num_sessions);
+            tx_t *tx;
+            if ((done + i) % 4 == 0 || writers[key].empty()) {
+                mockdb::PUT_operation<std::string, int> *op = new mockdb::PUT_operation<std::string, int>(
+                        new mockdb::PUT_param<std::string, int>(keys[key], 0));
+                tx = new tx_t(tx_ids.next(), op);
+                writers[key].push_back(tx->get_tx_id());
+                mockdb::PUT_response<std::string, int> *response = new mockdb::PUT_response<std::string, int>(true);
+                response->set_version_number(writers[key].size());
+                op->set_response(response);
+                reads_from.push_back(0);
+            } else {
+                mockdb::GET_operation<std::string, int> *op = new mockdb::GET_operation<std::string, int>(
+                        new mockdb::GET_param<std::string, int>(keys[key]));
+                tx = new tx_t(tx_ids.next(), op);
+                size_t back = std::min<size_t>(gen() % 3, writers[key].size() - 1);
+                size_t version_number = writers[key].size() - back;
+                mockdb::GET_response<std::string, int> *response = new mockdb::GET_response<std::string, int>(keys[key], 0);
+                response->set_written_by_tx_id(writers[key][version_number - 1]);
+                response->set_version_number(version_number);
+                op->set_response(response);
+                reads_from.push_back(writers[key][version_number - 1]);
+            }
+            tx->set_session_id(session_id);
+            batch.push_back(tx);
+        }
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (reads_from[i] != 0) {
+                consistent += checker.is_consistent(batch[i], reads_from[i]);
+                checks++;
+            }
+        }
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+        for (auto tx : batch)
+            checker.on_commit(tx);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        check_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(middle - begin).count();
+        commit_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count();
+
+        for (auto tx : batch)
+            delete_tx(tx);
+    }
+
+    std::cout << num_entries << "\t" << num_keys << "\t" << num_sessions << "\t"
+              << num_entries / (commit_ns / 1e9) << "\t" << checks / (check_ns / 1e9) << "\t"
+              << (double) consistent / checks << std::endl;
+}
+
+/*
+ * Args:
+ * num of history entries (default 1000000)
+ */
+int main(int argc, char **argv) {
+    size_t entries = argc > 1 ? atol(argv[1]) : 1000000;
+
+    std::cout << "entries\tkeys\tsessions\ton_commit/s\tis_consistent/s\tconsistent" << std::endl;
+    run(entries, 100, 4);
+    run(entries, 10000, 4);
+    run(entries, 10000, 64);
+    return 0;
+}
@@ -0,0 +1,77 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Throughput of concurrent sessions with a store-wide lock vs. striped locks.
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NUM_KEYS 1024
+
+/*
+ * Each session alternates PUT and GET on keys drawn uniformly from the key space.
+ */
+void do_operations(mockdb::kv_store<std::string, int> *store, long session_id, int num_ops) {
+    std::mt19937 generator(session_id);
+    for (int i = 0; i < num_ops; i++) {
+        std::string key = "key:" + std::to_string(generator() % NUM_KEYS);
+        if (i % 2 == 0) {
+            store->put(key, i, session_id);
+        }
+        else {
+            try {
+                store->get(key, session_id);
+            } catch (std::exception &e) {
+                // Pass
+            }
+        }
+    }
+}
+
+// Returns operations per second
+double run(int num_sessions, size_t lock_stripes, int num_ops) {
+    mockdb::read_response_selector<std::string, int> *read_selector =
+            new mockdb::linearizable_read_response_selector<std::string, int>();
+    mockdb::kv_store<std::string, int> *store = new mockdb::kv_store<std::string, int>(read_selector, lock_stripes);
+    read_selector->init_consistency_checker(store);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 1; i <= num_sessions; i++)
+        threads.push_back(std::thread(do_operations, store, i, num_ops));
+    for (auto &t : threads)
+        t.join();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    delete store;
+    delete read_selector;
+
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1e6;
+    return num_sessions * num_ops / seconds;
+}
+
+/*
+ * Args:
+ * num of operations per session (default 20000)
+ * num of lock stripes (default 64)
+ */
+int main(int argc, char **argv) {
+    int num_ops = argc > 1 ? atoi(argv[1]) : 20000;
+    size_t lock_stripes = argc > 2 ? atoi(argv[2]) : 64;
+
+    std::cout << "sessions\tstore-wide ops/s\tstriped(" << lock_stripes << ") ops/s" << std::endl;
+    for (int sessions = 1; sessions <= 64; sessions *= 2) {
+        double single = run(sessions, 1, num_ops);
+        double striped = run(sessions, lock_stripes, num_ops);
+        std::cout << sessions << "\t" << (long) single << "\t" << (long) striped << std::endl;
+    }
+    return 0;
+}
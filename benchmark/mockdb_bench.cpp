@@ -0,0 +1,401 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Microbenchmarks of the store, the read response selectors and the causal
+// checker, for tracking regressions. See bench_harness.h for the options, e.g.
+//   ./mockdb_bench --format=json --out=results.json
+
+#include "bench_harness.h"
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "consistency_checker.h"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef mockdb::kv_store<std::string, int> store_t;
+typedef mockdb::read_response_selector<std::string, int> selector_t;
+typedef mockdb::transaction<std::string, int> tx_t;
+
+using mockdb::bench::state;
+
+mockdb::tx_id_allocator tx_ids;
+
+// Store and selector, deleted together
+struct fixture {
+    selector_t *selector;
+    store_t *store;
+
+    fixture(selector_t *selector) : selector(selector) {
+        this->store = new store_t(selector);
+        selector->init_consistency_checker(this->store);
+    }
+
+    ~fixture() {
+        delete this->store;
+        delete this->selector;
+    }
+};
+
+std::vector<std::string> make_keys(long count) {
+    std::vector<std::string> keys;
+    for (long i = 0; i < count; i++)
+        keys.push_back("key" + std::to_string(i));
+    return keys;
+}
+
+tx_t *make_put(long session_id, const std::string &key, size_t version_number) {
+    mockdb::PUT_operation<std::string, int> *op =
+            new mockdb::PUT_operation<std::string, int>(new mockdb::PUT_param<std::string, int>(key, 0));
+    mockdb::PUT_response<std::string, int> *response = new mockdb::PUT_response<std::string, int>(true);
+    response->set_version_number(version_number);
+    op->set_response(response);
+    tx_t *tx = new tx_t(tx_ids.next(), op);
+    tx->set_session_id(session_id);
+    return tx;
+}
+
+tx_t *make_get(long session_id, const std::string &key) {
+    tx_t *tx = new tx_t(tx_ids.next(), new mockdb::GET_operation<std::string, int>(
+            new mockdb::GET_param<std::string, int>(key)));
+    tx->set_session_id(session_id);
+    return tx;
+}
+
+// Operations don't own their parameters and responses
+void delete_tx(tx_t *tx) {
+    const mockdb::operation<std::string, int> *op = tx->get_operation();
+    delete op->get_response();
+    delete op->get_params();
+    delete op;
+    delete tx;
+}
+
+// PUT to one of arg(0) keys
+void bm_put(state &s) {
+    fixture f(new mockdb::linearizable_read_response_selector<std::string, int>());
+    std::vector<std::string> keys = make_keys(s.arg(0));
+    size_t i = 0;
+    while (s.keep_running()) {
+        f.store->put(keys[i], (int) i, 1);
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+}
+
+// Causal GET of a key with arg(0) versions, by a session which wrote none of them
+void bm_get_versions(state &s) {
+    fixture f(new mockdb::causal_read_response_selector<std::string, int>());
+    for (long v = 0; v < s.arg(0); v++)
+        f.store->put("x", (int) v, 1);
+    while (s.keep_running())
+        mockdb::bench::do_not_optimize(f.store->get("x", 2));
+}
+
+void bm_get_with_version_versions(state &s) {
+    fixture f(new mockdb::causal_read_response_selector<std::string, int>());
+    for (long v = 0; v < s.arg(0); v++)
+        f.store->put("x", (int) v, 1);
+    while (s.keep_running())
+        mockdb::bench::do_not_optimize(f.store->get_with_version("x", 2));
+}
+
+// Causal GETs by arg(0) sessions in turn, each of which wrote every one of 16 keys
+void bm_get_sessions(state &s) {
+    fixture f(new mockdb::causal_read_response_selector<std::string, int>());
+    std::vector<std::string> keys = make_keys(16);
+    long sessions = s.arg(0);
+    for (long session_id = 1; session_id <= sessions; session_id++) {
+        for (const std::string &key : keys)
+            f.store->put(key, (int) session_id, session_id);
+    }
+    size_t i = 0;
+    while (s.keep_running()) {
+        mockdb::bench::do_not_optimize(f.store->get(keys[i % keys.size()], 1 + (long) (i % sessions)));
+        i++;
+    }
+}
+
+// Causal GET once the history holds arg(0) rows, over 1024 keys
+void bm_get_history(state &s) {
+    fixture f(new mockdb::causal_read_response_selector<std::string, int>());
+    std::vector<std::string> keys = make_keys(1024);
+    for (long i = 0; i < s.arg(0); i++)
+        f.store->put(keys[i % keys.size()], (int) i, 1 + i % 4);
+    size_t i = 0;
+    while (s.keep_running()) {
+        mockdb::bench::do_not_optimize(f.store->get(keys[i % keys.size()], 1 + (long) (i % 4)));
+        i++;
+    }
+    s.set_counter("history_rows", (double) f.store->get_history().size());
+}
+
+/*
+ * GET of a key with arg(0) versions by a store whose selector type is Selector, a
+ * Concrete selector. With Selector = selector_t the store calls it virtually, with
+ * Selector = Concrete directly.
+ */
+template <typename Selector, typename Concrete>
+void bm_get_dispatch(state &s) {
+    Concrete selector;
+    mockdb::kv_store<std::string, int, Selector> store(&selector);
+    selector.init_consistency_checker(&store);
+    for (long v = 0; v < s.arg(0); v++)
+        store.put("x", (int) v, 1);
+    while (s.keep_running())
+        mockdb::bench::do_not_optimize(store.get("x", 2));
+}
+
+// PUT to one of arg(0) keys, dispatched like bm_get_dispatch
+template <typename Selector, typename Concrete>
+void bm_put_dispatch(state &s) {
+    Concrete selector;
+    mockdb::kv_store<std::string, int, Selector> store(&selector);
+    selector.init_consistency_checker(&store);
+    std::vector<std::string> keys = make_keys(s.arg(0));
+    size_t i = 0;
+    while (s.keep_running()) {
+        store.put(keys[i], (int) i, 1);
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+}
+
+/*
+ * Causal reads of arg(0) keys over 4 stripes, in one multi_get if Batched, else one
+ * get per key. Items are keys read.
+ */
+template <bool Batched>
+void bm_get_keys(state &s) {
+    mockdb::causal_read_response_selector<std::string, int> selector;
+    store_t store(&selector, 4);
+    selector.init_consistency_checker(&store);
+    std::vector<std::string> keys = make_keys(s.arg(0));
+    for (const std::string &key : keys)
+        store.put(key, 0, 1);
+    while (s.keep_running()) {
+        if (Batched) {
+            mockdb::bench::do_not_optimize(store.multi_get(keys, 2));
+        } else {
+            for (const std::string &key : keys)
+                mockdb::bench::do_not_optimize(store.get(key, 2));
+        }
+    }
+    s.set_items_processed(s.get_iterations() * keys.size());
+}
+
+// Writes of arg(0) keys over 4 stripes, batched like bm_get_keys
+template <bool Batched>
+void bm_put_keys(state &s) {
+    mockdb::causal_read_response_selector<std::string, int> selector;
+    store_t store(&selector, 4);
+    selector.init_consistency_checker(&store);
+    std::vector<std::pair<std::string, int>> pairs;
+    for (const std::string &key : make_keys(s.arg(0)))
+        pairs.push_back({key, 0});
+    while (s.keep_running()) {
+        if (Batched) {
+            store.multi_put(pairs, 1);
+        } else {
+            for (const auto &pair : pairs)
+                store.put(pair.first, pair.second, 1);
+        }
+    }
+    s.set_items_processed(s.get_iterations() * pairs.size());
+}
+
+/*
+ * arg(1) threads, each its own session, alternate PUT and GET of keys drawn from
+ * 1024 over arg(0) stripes; the iterations are split between the threads. Commits
+ * still go through the store's history lock, so the sweep over stripes and threads
+ * shows what striping gains on top of it.
+ */
+void bm_striped_sessions(state &s) {
+    mockdb::linearizable_read_response_selector<std::string, int> selector;
+    store_t store(&selector, (size_t) s.arg(0));
+    selector.init_consistency_checker(&store);
+    std::vector<std::string> keys = make_keys(1024);
+    for (const std::string &key : keys)
+        store.put(key, 0, 1);
+
+    long thread_count = s.arg(1);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (long t = 0; t < thread_count; t++) {
+        size_t ops = s.get_iterations() / thread_count + (t < (long) (s.get_iterations() % thread_count) ? 1 : 0);
+        threads.push_back(std::thread([&store, &keys, &go, t, ops] {
+            mockdb::random_generator random((uint64_t) t);
+            while (!go.load())
+                std::this_thread::yield();
+            for (size_t i = 0; i < ops; i++) {
+                const std::string &key = keys[random.uniform(keys.size())];
+                if (i % 2 == 0)
+                    store.put(key, (int) i, t + 1);
+                else
+                    mockdb::bench::do_not_optimize(store.get(key, t + 1));
+            }
+        }));
+    }
+
+    // All the operations run in the first iteration, the others only count
+    while (s.keep_running()) {
+        if (!go.load()) {
+            go.store(true);
+            for (auto &thread : threads)
+                thread.join();
+        }
+    }
+}
+
+/*
+ * select_read_response of a selector for a reader of session 2 over arg(0)
+ * versions, written by session 1 except the second to last one, which session 2
+ * wrote. The selector learns of the writes through on_commit, as from the store.
+ */
+void bm_select(state &s, const std::function<selector_t *()> &create) {
+    fixture f(create());
+    size_t num_versions = (size_t) s.arg(0);
+    mockdb::arena memory;
+    mockdb::version_chain<int> chain(&memory);
+    std::vector<tx_t *> txs;
+    for (size_t v = 1; v <= num_versions; v++) {
+        tx_t *tx = make_put(v == num_versions - 1 ? 2 : 1, "x", v);
+        chain.append(0, tx->get_tx_id());
+        f.selector->on_commit(tx);
+        txs.push_back(tx);
+    }
+
+    std::string key = "x";
+    mockdb::candidate_view<std::string, int> candidates(key, chain);
+    tx_t *reader = make_get(2, key);
+    const mockdb::operation<std::string, int> *op = reader->get_operation();
+    while (s.keep_running())
+        mockdb::bench::do_not_optimize(f.selector->select_read_response(reader, op, candidates));
+
+    delete_tx(reader);
+    for (auto tx : txs)
+        delete_tx(tx);
+}
+
+/*
+ * Causal checker fed alternating PUTs and GETs of the latest version of 1024 keys
+ * by arg(0) sessions in turn, so causal pasts keep growing. Times on_commit of
+ * the PUTs and on_read of the GETs, created beforehand.
+ */
+void bm_causal_checker_commit(state &s) {
+    mockdb::causal_consistency_checker<std::string, int> checker(nullptr);
+    std::vector<std::string> keys = make_keys(1024);
+    long sessions = s.arg(0);
+    std::vector<size_t> versions(keys.size(), 0);
+    std::vector<long> writers(keys.size(), 0);
+    std::vector<tx_t *> txs;
+
+    for (size_t i = 0; i < s.get_iterations(); i++) {
+        size_t key = (i * 7919) % keys.size();
+        long session_id = 1 + (long) (i % sessions);
+        if (i % 2 == 0 || writers[key] == 0) {
+            txs.push_back(make_put(session_id, keys[key], ++versions[key]));
+            writers[key] = txs.back()->get_tx_id();
+        } else {
+            mockdb::GET_operation<std::string, int> *op = new mockdb::GET_operation<std::string, int>(
+                    new mockdb::GET_param<std::string, int>(keys[key]));
+            mockdb::GET_response<std::string, int> *response = new mockdb::GET_response<std::string, int>(keys[key], 0);
+            response->set_written_by_tx_id(writers[key]);
+            response->set_version_number(versions[key]);
+            op->set_response(response);
+            txs.push_back(new tx_t(tx_ids.next(), op));
+            txs.back()->set_session_id(session_id);
+        }
+    }
+
+    size_t i = 0;
+    while (s.keep_running()) {
+        tx_t *tx = txs[i++];
+        if (tx->get_operation()->get_kind() == mockdb::op_kind::GET)
+            checker.on_read(tx);
+        else
+            checker.on_commit(tx);
+    }
+    for (auto tx : txs)
+        delete_tx(tx);
+}
+
+// is_consistent of a read by a session whose causal past holds arg(0) versions of the key
+void bm_causal_checker_is_consistent(state &s) {
+    mockdb::causal_consistency_checker<std::string, int> checker(nullptr);
+    std::vector<tx_t *> txs;
+    for (long v = 1; v <= s.arg(0); v++) {
+        txs.push_back(make_put(1, "x", (size_t) v));
+        checker.on_commit(txs.back());
+    }
+    tx_t *reader = make_get(1, "x");
+    long oldest = txs.front()->get_tx_id(), newest = txs.back()->get_tx_id();
+    size_t i = 0;
+    while (s.keep_running())
+        mockdb::bench::do_not_optimize(checker.is_consistent(reader, (i++ % 2) ? oldest : newest));
+
+    delete_tx(reader);
+    for (auto tx : txs)
+        delete_tx(tx);
+}
+
+/*
+ * Args: see bench_harness.h
+ */
+int main(int argc, char **argv) {
+    mockdb::bench::registry benchmarks;
+    benchmarks.add("put", bm_put, {{1}, {1024}, {65536}});
+    benchmarks.add("get/versions", bm_get_versions, {{1}, {16}, {256}, {4096}});
+    benchmarks.add("get_with_version/versions", bm_get_with_version_versions, {{1}, {16}, {256}, {4096}});
+    benchmarks.add("get/sessions", bm_get_sessions, {{1}, {16}, {256}});
+    benchmarks.add("get/history", bm_get_history, {{1024}, {65536}, {262144}});
+
+    typedef mockdb::linearizable_read_response_selector<std::string, int> linearizable_t;
+    typedef mockdb::causal_read_response_selector<std::string, int> causal_t;
+    benchmarks.add("get/linearizable/virtual", bm_get_dispatch<selector_t, linearizable_t>, {{1}, {16}});
+    benchmarks.add("get/linearizable/static", bm_get_dispatch<linearizable_t, linearizable_t>, {{1}, {16}});
+    benchmarks.add("get/causal/virtual", bm_get_dispatch<selector_t, causal_t>, {{1}, {16}});
+    benchmarks.add("get/causal/static", bm_get_dispatch<causal_t, causal_t>, {{1}, {16}});
+    benchmarks.add("put/linearizable/virtual", bm_put_dispatch<selector_t, linearizable_t>, {{1024}});
+    benchmarks.add("put/linearizable/static", bm_put_dispatch<linearizable_t, linearizable_t>, {{1024}});
+    benchmarks.add("put/causal/virtual", bm_put_dispatch<selector_t, causal_t>, {{1024}});
+    benchmarks.add("put/causal/static", bm_put_dispatch<causal_t, causal_t>, {{1024}});
+    benchmarks.add("get/keys/single", bm_get_keys<false>, {{4}, {64}});
+    benchmarks.add("get/keys/multi_get", bm_get_keys<true>, {{4}, {64}});
+    benchmarks.add("put/keys/single", bm_put_keys<false>, {{4}, {64}});
+    benchmarks.add("put/keys/multi_put", bm_put_keys<true>, {{4}, {64}});
+
+    // Stripes, threads
+    std::vector<std::vector<long>> striping;
+    for (long stripes : {1, 16, 64}) {
+        for (long threads : {1, 2, 4, 8})
+            striping.push_back({stripes, threads});
+    }
+    benchmarks.add("put_get/stripes/threads", bm_striped_sessions, striping);
+
+    std::vector<std::pair<std::string, std::function<selector_t *()>>> selectors = {
+            {"linearizable", [] { return new mockdb::linearizable_read_response_selector<std::string, int>(); }},
+            {"causal", [] { return new mockdb::causal_read_response_selector<std::string, int>(); }},
+            {"k_causal", [] { return new mockdb::k_causal_read_response_selector<std::string, int>(2, 1000); }},
+            {"read_committed", [] { return new mockdb::read_committed_read_response_selector<std::string, int>(); }},
+            {"read_atomic", [] { return new mockdb::read_atomic_read_response_selector<std::string, int>(); }},
+            {"read_your_writes", [] { return new mockdb::read_your_writes_read_response_selector<std::string, int>(); }},
+            {"monotonic_reads", [] { return new mockdb::monotonic_reads_read_response_selector<std::string, int>(); }},
+            {"monotonic_writes", [] { return new mockdb::monotonic_writes_read_response_selector<std::string, int>(); }},
+            {"writes_follow_reads", [] { return new mockdb::writes_follow_reads_read_response_selector<std::string, int>(); }},
+            {"snapshot_isolation", [] { return new mockdb::snapshot_isolation_read_response_selector<std::string, int>(); }},
+            {"parallel_snapshot_isolation",
+             [] { return new mockdb::parallel_snapshot_isolation_read_response_selector<std::string, int>(); }},
+    };
+    for (const auto &selector : selectors) {
+        auto create = selector.second;
+        benchmarks.add("select/" + selector.first, [create](state &s) { bm_select(s, create); }, {{16}, {1024}});
+    }
+
+    benchmarks.add("causal_checker/commit/sessions", bm_causal_checker_commit, {{1}, {16}, {256}});
+    benchmarks.add("causal_checker/is_consistent/versions", bm_causal_checker_is_consistent, {{16}, {4096}});
+    return benchmarks.run(argc, argv);
+}
@@ -0,0 +1,121 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Memory per version and lookup cost of arena-backed version chains compared to
+// the std::list representation they replace.
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <string>
+
+size_t list_bytes = 0;
+
+// Counts bytes requested by std::list, plus the usual malloc header per node
+template <typename T>
+struct counting_allocator {
+    typedef T value_type;
+
+    counting_allocator() {}
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U> &) {}
+
+    T *allocate(size_t n) {
+        list_bytes += n * sizeof(T) + 16;
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        list_bytes -= n * sizeof(T) + 16;
+        ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const counting_allocator<T> &, const counting_allocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const counting_allocator<T> &, const counting_allocator<U> &) { return false; }
+
+typedef std::list<std::pair<std::string, long>, counting_allocator<std::pair<std::string, long>>> version_list;
+
+long elapsed_ns(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void compare_representations(size_t num_versions, int lookups) {
+    mockdb::arena memory;
+    mockdb::version_chain<std::string> chain(&memory);
+    version_list l;
+    for (size_t i = 0; i < num_versions; i++) {
+        chain.append("v", i + 1);
+        l.push_back({"v", i + 1});
+    }
+
+    // Find the tx id of a version by its number, as GET does for the chosen candidate
+    volatile long sink = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++) {
+        size_t version_number = i % num_versions + 1;
+        size_t n = 1;
+        for (auto &v : l) {
+            if (n++ == version_number) {
+                sink = sink + v.second;
+                break;
+            }
+        }
+    }
+    long list_ns = elapsed_ns(begin);
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+        sink = sink + chain.get_version(i % num_versions + 1).tx_id;
+    long chain_ns = elapsed_ns(begin);
+
+    std::cout << num_versions << "\t"
+              << (double) list_bytes / num_versions << "\t"
+              << (double) memory.get_allocated_bytes() / num_versions << "\t"
+              << (double) list_ns / lookups << "\t"
+              << (double) chain_ns / lookups << std::endl;
+}
+
+void store_get_latency(size_t num_versions, int reads) {
+    mockdb::read_response_selector<std::string, std::string> *read_selector =
+            new mockdb::linearizable_read_response_selector<std::string, std::string>();
+    mockdb::kv_store<std::string, std::string> *store = new mockdb::kv_store<std::string, std::string>(read_selector);
+    read_selector->init_consistency_checker(store);
+
+    for (size_t i = 0; i < num_versions; i++)
+        store->put("key", "v");
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++)
+        store->get_with_version("key");
+    long ns = elapsed_ns(begin);
+
+    std::cout << num_versions << "\t" << (double) ns / reads / 1000.0 << std::endl;
+
+    delete store;
+    delete read_selector;
+}
+
+/*
+ * Args:
+ * num of lookups (default 2000)
+ */
+int main(int argc, char **argv) {
+    int lookups = argc > 1 ? atoi(argv[1]) : 2000;
+
+    std::cout << "versions\tlist bytes/version\tchain bytes/version\tlist lookup ns\tchain lookup ns" << std::endl;
+    for (size_t n = 1000; n <= 64000; n *= 4)
+        compare_representations(n, lookups);
+
+    std::cout << std::endl << "versions\tkv_store GET us" << std::endl;
+    for (size_t n = 1000; n <= 64000; n *= 4)
+        store_get_latency(n, lookups / 10);
+    return 0;
+}
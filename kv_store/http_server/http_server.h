@@ -30,6 +30,11 @@ namespace mockdb {
         void handle_post(web::http::http_request message);
         void handle_delete(web::http::http_request message);
 
+        // Writes the history of the store, call once the listener is closed
+        void write_history(std::ostream &out) const {
+            store->get_history().write(out);
+        }
+
     private:
         web::http::experimental::listener::http_listener m_listener;
         kv_store<K, V> *store;
@@ -78,18 +83,12 @@ long mockdb::http_server<K, V>::get_session_id(web::http::http_headers headers)
  */
 template <typename K, typename V>
 void mockdb::http_server<K, V>::handle_get(web::http::http_request message) {
-#ifdef MOCKDB_DEBUG_LOG
-    std::cout << "[MOCKDB::kvstore] GET Request received from "
-                << message.remote_address() << std::endl;
-    std::cout << message.to_string() << std::endl;
-    for (auto header : message.headers()) {
-        std::cout << header.first << ": " << header.second << std::endl;
-    }
-#endif // MOCKDB_DEBUG_LOG
-
     long session_id = get_session_id(message.headers());
     auto paths = web::http::uri::split_path(web::http::uri::decode(message.relative_uri().path()));
     web::json::value response;
+    if (tracer::enabled())
+        tracer::record(trace_kind::HTTP_GET, store->get_trace_id(), 0, session_id,
+                       paths.size() == 4 ? std::hash<K>()(paths[3]) : 0);
 
     if (paths.size() != 4) {
         response["error"] = web::json::value("Bad request");
@@ -123,20 +122,13 @@ void mockdb::http_server<K, V>::handle_get(web::http::http_request message) {
 template <typename K, typename V>
 void mockdb::http_server<K, V>::handle_post(web::http::http_request message) {
     std::lock_guard<std::mutex> lck (mtx);
-#ifdef MOCKDB_DEBUG_LOG
-    std::cout << "[MOCKDB::kvstore] PUT Request received from "
-                << message.remote_address() << std::endl;
-    std::cout << message.to_string() << std::endl;
-    for (auto header : message.headers()) {
-        std::cout << header.first << ": " << header.second << std::endl;
-    }
-#endif // MOCKDB_DEBUG_LOG
-
     long session_id = get_session_id(message.headers());
     web::json::value payload = message.extract_json().get();
     K key = payload.at(U("key")).as_string();
     V value = payload.at(U("value"));
     web::json::value response;
+    if (tracer::enabled())
+        tracer::record(trace_kind::HTTP_POST, store->get_trace_id(), 0, session_id, std::hash<K>()(key));
 
     if (payload.has_field(U("etag"))) {
         std::string etag = payload.at(U("etag")).as_string();
@@ -149,9 +141,9 @@ void mockdb::http_server<K, V>::handle_post(web::http::http_request message) {
         }
 
         if (std::to_string(version) != etag) {
-#ifdef MOCKDB_DEBUG_LOG
-            std::cout << "[MOCKDB::kvstore] [error] ETag mismatch" << std::endl;
-#endif // MOCKDB_DEBUG_LOG
+            if (tracer::enabled())
+                tracer::record(trace_kind::ETAG_MISMATCH, store->get_trace_id(), 0, session_id, std::hash<K>()(key),
+                               0, version);
             response["success"] = web::json::value("false");
             response["description"] = web::json::value("ETag mismatch");
             message.reply(web::http::status_codes::BadRequest, response);
@@ -165,11 +157,37 @@ void mockdb::http_server<K, V>::handle_post(web::http::http_request message) {
 }
 
 /*
- *
+ * Handle delete requests.
+ * Required format: http://localhost:${port}/v1.0/state/${stateStoreName}/${key}
  */
 template <typename K, typename V>
 void mockdb::http_server<K, V>::handle_delete(web::http::http_request message) {
-    // TODO
+    std::lock_guard<std::mutex> lck (mtx);
+    long session_id = get_session_id(message.headers());
+    auto paths = web::http::uri::split_path(web::http::uri::decode(message.relative_uri().path()));
+    web::json::value response;
+    if (tracer::enabled())
+        tracer::record(trace_kind::HTTP_DELETE, store->get_trace_id(), 0, session_id,
+                       paths.size() == 4 ? std::hash<K>()(paths[3]) : 0);
+
+    if (paths.size() != 4) {
+        response["error"] = web::json::value("Bad request");
+        message.reply(web::http::status_codes::BadRequest, response);
+        return;
+    }
+
+    try {
+        store->remove(paths[3], session_id);
+    } catch (key_not_found_exception &e) {
+        message.reply(web::http::status_codes::NotFound);
+        return;
+    } catch (consistency_exception &e) {
+        response["error"] = web::json::value("No consistent response possible");
+        message.reply(web::http::status_codes::OK, response);
+        return;
+    }
+    response["success"] = web::json::value("true");
+    message.reply(web::http::status_codes::OK, response);
 }
 
 #endif //MOCK_KEY_VALUE_STORE_HTTP_SERVER_H
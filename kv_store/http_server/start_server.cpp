@@ -5,6 +5,7 @@
 
 #include "http_server.h"
 
+#include <fstream>
 #include <iostream>
 #include <cpprest/http_listener.h>
 
@@ -34,12 +35,17 @@ void close_server(std::unique_ptr<mockdb::http_server<std::string, web::json::va
  * Starts HTTP server.
  * Arguments:
  * Port number
- * Log file path
+ * Log file path, optional: the history of the store is written there on exit,
+ *                for check_history
+ * Trace file path, optional: events of the server and the store are traced
+ *                there while it runs, for decode_trace
  */
 int main(int argc, char* argv[]) {
     utility::string_t port = U(argv[1]);
     utility::string_t address = U("http://127.0.0.1:");
     address.append(port);
+    if (argc > 3)
+        mockdb::tracer::instance().start(argv[3]);
     std::unique_ptr<mockdb::http_server<std::string, web::json::value>> server = init_server(address);
 
     while (true) {
@@ -49,6 +55,16 @@ int main(int argc, char* argv[]) {
         std::getline(std::cin, line);
         if (line.compare("exit") == 0) {
             close_server(server);
+            if (argc > 3) {
+                mockdb::tracer::instance().stop();
+                std::cout << "[MOCKDB::kvstore] Trace written to " << argv[3] << ", "
+                          << mockdb::tracer::instance().get_dropped() << " events dropped" << std::endl;
+            }
+            if (argc > 2) {
+                std::ofstream log(argv[2]);
+                server->write_history(log);
+                std::cout << "[MOCKDB::kvstore] History written to " << argv[2] << std::endl;
+            }
             return 0;
         }
     }
@@ -0,0 +1,165 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Memory arena owned by a store, released wholesale on destruction.
+
+#ifndef MOCK_KEY_VALUE_STORE_ARENA_H
+#define MOCK_KEY_VALUE_STORE_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Carves allocations out of large blocks. Freed memory is kept in size classes
+     * (four per power of two) and handed out again, so growing containers reuse their
+     * old buffers. Not thread safe, the owner is expected to serialize access.
+     */
+    class arena {
+    public:
+        arena(size_t block_size = 64 * 1024) {
+            this->block_size = block_size;
+            this->cursor = this->block_end = nullptr;
+            this->allocated_bytes = this->reserved_bytes = 0;
+            for (auto &head : this->free_lists)
+                head = nullptr;
+        }
+
+        ~arena() {
+            for (auto block : this->blocks)
+                ::operator delete(block);
+        }
+
+        arena(const arena &) = delete;
+        arena &operator=(const arena &) = delete;
+
+        void *allocate(size_t bytes) {
+            size_t size;
+            size_t cls = size_class(bytes, size);
+            this->allocated_bytes += size;
+
+            // Reuse a freed chunk of the same class
+            if (this->free_lists[cls] != nullptr) {
+                free_chunk *chunk = this->free_lists[cls];
+                this->free_lists[cls] = chunk->next;
+                return chunk;
+            }
+
+            // Large allocations get a dedicated block
+            if (size > this->block_size)
+                return new_block(size);
+
+            if (this->cursor == nullptr || this->cursor + size > this->block_end) {
+                this->cursor = static_cast<char *>(new_block(this->block_size));
+                this->block_end = this->cursor + this->block_size;
+            }
+            void *p = this->cursor;
+            this->cursor += size;
+            return p;
+        }
+
+        void deallocate(void *p, size_t bytes) {
+            if (p == nullptr)
+                return;
+            size_t size;
+            size_t cls = size_class(bytes, size);
+            this->allocated_bytes -= size;
+            free_chunk *chunk = static_cast<free_chunk *>(p);
+            chunk->next = this->free_lists[cls];
+            this->free_lists[cls] = chunk;
+        }
+
+        // Bytes currently handed out (rounded up to size classes)
+        size_t get_allocated_bytes() const {
+            return this->allocated_bytes;
+        }
+
+        // Bytes obtained from the system
+        size_t get_reserved_bytes() const {
+            return this->reserved_bytes;
+        }
+
+    private:
+        struct free_chunk {
+            free_chunk *next;
+        };
+
+        static const size_t NUM_CLASSES = 4 * 8 * sizeof(size_t);
+
+        /*
+         * Up to 64 bytes classes are multiples of 16, above that each power of two
+         * range is split into four steps. Every class size is a multiple of 16, which
+         * keeps all chunks max-aligned.
+         */
+        static size_t size_class(size_t bytes, size_t &size) {
+            if (bytes <= 64) {
+                size = bytes <= 16 ? 16 : (bytes + 15) & ~size_t(15);
+                return size / 16 - 1;
+            }
+            size_t exp = 6;     // 2^exp < bytes <= 2^(exp + 1)
+            while ((size_t(1) << (exp + 1)) < bytes)
+                exp++;
+            size_t step = size_t(1) << (exp - 2);
+            size_t steps = (bytes - 1) / step + 1;
+            size = steps * step;
+            return 4 + (exp - 6) * 4 + (steps - 5);
+        }
+
+        void *new_block(size_t size) {
+            void *block = ::operator new(size);
+            this->blocks.push_back(block);
+            this->reserved_bytes += size;
+            return block;
+        }
+
+        size_t block_size;
+        char *cursor, *block_end;
+        size_t allocated_bytes, reserved_bytes;
+        free_chunk *free_lists[NUM_CLASSES];
+        std::vector<void *> blocks;
+    };
+
+    /*
+     * Standard allocator adaptor so that containers can be backed by an arena.
+     */
+    template <typename T>
+    class arena_allocator {
+    public:
+        typedef T value_type;
+
+        arena_allocator(arena *a) : memory(a) {
+        }
+
+        template <typename U>
+        arena_allocator(const arena_allocator<U> &other) : memory(other.get_arena()) {
+        }
+
+        T *allocate(size_t n) {
+            return static_cast<T *>(this->memory->allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, size_t n) {
+            this->memory->deallocate(p, n * sizeof(T));
+        }
+
+        arena *get_arena() const {
+            return this->memory;
+        }
+
+    private:
+        arena *memory;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const arena_allocator<T> &a, const arena_allocator<U> &b) {
+        return a.get_arena() == b.get_arena();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const arena_allocator<T> &a, const arena_allocator<U> &b) {
+        return a.get_arena() != b.get_arena();
+    }
+}
+#endif //MOCK_KEY_VALUE_STORE_ARENA_H
@@ -0,0 +1,61 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Read-only view over the versions a GET may return.
+
+#ifndef MOCK_KEY_VALUE_STORE_CANDIDATE_VIEW_H
+#define MOCK_KEY_VALUE_STORE_CANDIDATE_VIEW_H
+
+#include "version_chain.h"
+
+#include <cstddef>
+
+namespace mockdb {
+    /*
+     * Non-owning view over the version chain of a key. Candidates are addressed by
+     * index (oldest first), the selector returns the index it picks and only that
+     * version is turned into a GET_response. Valid while the key's lock is held.
+     */
+    template <typename K, typename V>
+    class candidate_view {
+    public:
+        candidate_view(const K &key, const version_chain<V> &chain) : key(key), chain(chain) {
+        }
+
+        const K &get_key() const {
+            return key;
+        }
+
+        size_t size() const {
+            return chain.size();
+        }
+
+        bool empty() const {
+            return chain.empty();
+        }
+
+        long get_tx_id(size_t index) const {
+            return chain[index].tx_id;
+        }
+
+        size_t get_version_number(size_t index) const {
+            return chain.get_version_number(index);
+        }
+
+        // Index of the given version, see version_chain::get_index
+        size_t get_index(size_t version_number) const {
+            return chain.get_index(version_number);
+        }
+
+        // Written by REMOVE, a GET returning it reports the key as not found
+        bool is_tombstone(size_t index) const {
+            return chain[index].tombstone;
+        }
+
+    private:
+        const K &key;
+        const version_chain<V> &chain;
+    };
+}
+#endif //MOCK_KEY_VALUE_STORE_CANDIDATE_VIEW_H
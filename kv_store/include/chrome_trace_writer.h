@@ -0,0 +1,313 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Converts trace events into Chrome Trace Event JSON, as read by Perfetto and
+// chrome://tracing.
+
+#ifndef MOCK_KEY_VALUE_STORE_CHROME_TRACE_WRITER_H
+#define MOCK_KEY_VALUE_STORE_CHROME_TRACE_WRITER_H
+
+#include "trace_buffer.h"
+
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Writes trace events as they come as a Chrome trace: every store is a process
+     * with one track per session, holding a slice per operation and per
+     * transaction from BEGIN to COMMIT, and HTTP requests as instants. A flow arrow
+     * leads from each write to the reads of it. Contended lock acquisitions are
+     * slices on the tracks of their threads, in a process of their own.
+     *
+     * Besides the names of stores, sessions and threads and the BEGIN of open
+     * transactions, only what arrows still need is kept: writes, and reads whose
+     * write hasn't come yet, as events are only ordered per thread in a trace.
+     * Both are dropped once window ns older than the latest event, or a second
+     * after their store is closed, so memory is bounded by the events of a window.
+     * A read whose write was dropped or never came gets no arrow and counts as
+     * unresolved.
+     */
+    class chrome_trace_writer {
+    public:
+        chrome_trace_writer(std::ostream &out, uint64_t window = 10000000000) : out(out), window(window) {
+            this->out << "{\"traceEvents\":[";
+            this->out << std::fixed << std::setprecision(3);
+        }
+
+        void add(const trace_event &event) {
+            while (!this->closing.empty() && this->closing.front().first + close_delay < event.timestamp) {
+                this->close_store(this->closing.front().second);
+                this->closing.pop_front();
+            }
+            if (event.timestamp > this->latest) {
+                this->latest = event.timestamp;
+                this->expire();
+            }
+            switch (event.kind) {
+                case trace_kind::GET:
+                case trace_kind::PUT:
+                case trace_kind::REMOVE:
+                case trace_kind::NOT_FOUND:
+                case trace_kind::INCONSISTENT:
+                    this->add_operation(event);
+                    break;
+                case trace_kind::BEGIN:
+                    this->stores[event.store].begins[event.tx_id] = event.timestamp;
+                    break;
+                case trace_kind::COMMIT:
+                    this->add_commit(event);
+                    break;
+                case trace_kind::HTTP_GET:
+                case trace_kind::HTTP_POST:
+                case trace_kind::HTTP_DELETE:
+                case trace_kind::ETAG_MISMATCH:
+                    this->name_session(event.store, event.session_id);
+                    this->begin_event(trace_kind_name(event.kind), "i", event.store, event.session_id,
+                                      event.timestamp);
+                    this->out << ",\"s\":\"t\",\"args\":{\"key\":\"" << std::hex << event.key_hash << std::dec
+                              << "\"}}";
+                    break;
+                case trace_kind::LOCK_WAIT:
+                    this->name_thread(event.thread);
+                    this->begin_event("lock wait", "X", threads_pid, event.thread, event.timestamp - event.duration);
+                    this->out << ",\"dur\":" << micros(event.duration) << ",\"args\":{\"store\":" << event.store
+                              << "}}";
+                    break;
+                case trace_kind::STORE_CLOSED:
+                    this->closing.push_back({event.timestamp, event.store});
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Ends the JSON, reads whose write never came get no arrow
+        void finish() {
+            for (auto &entry : this->stores)
+                this->close_store_state(entry.second);
+            this->stores.clear();
+            this->out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+            this->out.flush();
+        }
+
+        size_t get_flow_count() const {
+            return this->flows;
+        }
+
+        // Reads of a write not in the trace, e.g. made before it started, or dropped as too old
+        size_t get_unresolved_count() const {
+            return this->unresolved;
+        }
+
+        // Writes and reads held for arrows still to come
+        size_t get_held_count() const {
+            return this->expiring.size();
+        }
+
+    private:
+        // Slice an arrow starts or ends at
+        struct slice {
+            long session_id;
+            uint64_t start;
+        };
+
+        // A write or a pending read held for arrows, in order of time added
+        struct held {
+            uint64_t added;
+            uint16_t store;
+            long tx_id;         // Writing transaction, of the read for pending reads
+            bool write;
+        };
+
+        // Latest event when the write, or the first of the reads, was added
+        struct held_write {
+            slice write;
+            uint64_t added;
+        };
+
+        struct pending_reads {
+            std::vector<slice> reads;
+            uint64_t added;
+        };
+
+        struct store_state {
+            std::unordered_map<long, held_write> writes;            // By writing transaction
+            std::unordered_map<long, pending_reads> pending;        // Reads by the transaction they read from
+            std::unordered_map<long, uint64_t> begins;              // BEGIN of open transactions
+            std::unordered_set<long> sessions;                      // Named tracks
+        };
+
+        // Process of the lock wait tracks, apart from the store ids
+        static const uint32_t threads_pid = 1 << 16;
+        // Width of operations without a duration, so arrows have a slice to bind to
+        static const uint64_t min_duration = 1;
+        // Events of other threads may still come this long after a store is closed, in ns
+        static const uint64_t close_delay = 1000000000;
+
+        std::ostream &out;
+        const uint64_t window;
+        uint64_t latest = 0;
+        std::deque<held> expiring;
+        bool first = true;
+        std::unordered_map<uint16_t, store_state> stores;
+        std::unordered_set<uint32_t> threads;
+        std::deque<std::pair<uint64_t, uint16_t>> closing;     // Closed stores by time of closing
+        size_t flows = 0;
+        size_t unresolved = 0;
+
+        static double micros(uint64_t ns) {
+            return ns / 1000.0;
+        }
+
+        // Writes the fields shared by all events, leaving the object open
+        void begin_event(const char *name, const char *phase, uint32_t pid, long tid, uint64_t ts) {
+            this->out << (this->first ? "\n" : ",\n");
+            this->first = false;
+            this->out << "{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\",\"pid\":" << pid
+                      << ",\"tid\":" << tid << ",\"ts\":" << micros(ts);
+        }
+
+        void name_session(uint16_t store, long session_id) {
+            store_state &state = this->stores[store];
+            if (state.sessions.empty()) {
+                this->begin_event("process_name", "M", store, 0, 0);
+                this->out << ",\"args\":{\"name\":\"store " << store << "\"}}";
+            }
+            if (state.sessions.insert(session_id).second) {
+                this->begin_event("thread_name", "M", store, session_id, 0);
+                this->out << ",\"args\":{\"name\":\"session " << session_id << "\"}}";
+            }
+        }
+
+        void name_thread(uint32_t thread) {
+            if (this->threads.empty()) {
+                this->begin_event("process_name", "M", threads_pid, 0, 0);
+                this->out << ",\"args\":{\"name\":\"threads\"}}";
+            }
+            if (this->threads.insert(thread).second) {
+                this->begin_event("thread_name", "M", threads_pid, thread, 0);
+                this->out << ",\"args\":{\"name\":\"thread " << thread << "\"}}";
+            }
+        }
+
+        void add_operation(const trace_event &event) {
+            this->name_session(event.store, event.session_id);
+            uint64_t start = event.timestamp - event.duration;
+            this->begin_event(trace_kind_name(event.kind), "X", event.store, event.session_id, start);
+            this->out << ",\"dur\":" << micros(event.duration > min_duration ? event.duration : min_duration)
+                      << ",\"args\":{\"tx\":" << event.tx_id << ",\"key\":\"" << std::hex << event.key_hash
+                      << std::dec << "\",\"version\":" << event.version_number
+                      << ",\"reads_from\":" << event.reads_from << "}}";
+
+            slice s = {event.session_id, start};
+            // A transaction reading its own write needs no arrow
+            if (event.reads_from != 0 && event.reads_from != event.tx_id)
+                this->add_read(event.store, event.reads_from, s);
+            // A REMOVE outside of a transaction writes its tombstone at once
+            if (event.kind == trace_kind::PUT || (event.kind == trace_kind::REMOVE && event.version_number != 0))
+                this->add_write(event.store, event.tx_id, s);
+        }
+
+        // A transaction is one slice, its writes are made by the COMMIT at its end
+        void add_commit(const trace_event &event) {
+            this->name_session(event.store, event.session_id);
+            store_state &state = this->stores[event.store];
+            auto it = state.begins.find(event.tx_id);
+            uint64_t begin = it == state.begins.end() ? event.timestamp : it->second;
+            if (it != state.begins.end())
+                state.begins.erase(it);
+
+            this->begin_event("transaction", "X", event.store, event.session_id, begin);
+            this->out << ",\"dur\":" << micros(event.timestamp - begin + min_duration)
+                      << ",\"args\":{\"tx\":" << event.tx_id << ",\"operations\":" << event.version_number << "}}";
+            this->begin_event("COMMIT", "X", event.store, event.session_id, event.timestamp);
+            this->out << ",\"dur\":" << micros(min_duration) << ",\"args\":{\"tx\":" << event.tx_id << "}}";
+            this->add_write(event.store, event.tx_id, {event.session_id, event.timestamp});
+        }
+
+        void add_write(uint16_t store, long tx_id, const slice &write) {
+            store_state &state = this->stores[store];
+            state.writes[tx_id] = {write, this->latest};
+            this->expiring.push_back({this->latest, store, tx_id, true});
+            auto it = state.pending.find(tx_id);
+            if (it == state.pending.end())
+                return;
+            for (const slice &read : it->second.reads)
+                this->add_flow(store, write, read);
+            state.pending.erase(it);
+        }
+
+        void add_read(uint16_t store, long reads_from, const slice &read) {
+            store_state &state = this->stores[store];
+            auto it = state.writes.find(reads_from);
+            if (it == state.writes.end()) {
+                pending_reads &pending = state.pending[reads_from];
+                if (pending.reads.empty()) {
+                    pending.added = this->latest;
+                    this->expiring.push_back({this->latest, store, reads_from, false});
+                }
+                pending.reads.push_back(read);
+            } else {
+                this->add_flow(store, it->second.write, read);
+            }
+        }
+
+        void add_flow(uint16_t store, const slice &write, const slice &read) {
+            this->flows++;
+            this->begin_event("reads-from", "s", store, write.session_id, write.start);
+            this->out << ",\"cat\":\"rf\",\"id\":" << this->flows << "}";
+            this->begin_event("reads-from", "f", store, read.session_id, read.start);
+            this->out << ",\"cat\":\"rf\",\"id\":" << this->flows << ",\"bp\":\"e\"}";
+        }
+
+        void close_store_state(const store_state &state) {
+            for (const auto &entry : state.pending)
+                this->unresolved += entry.second.reads.size();
+        }
+
+        /*
+         * Drops the writes and pending reads added more than window before the latest
+         * event. Entries of closed stores, and those whose write or reads were added
+         * again since, e.g. by the COMMIT of a transaction, are skipped.
+         */
+        void expire() {
+            while (!this->expiring.empty() && this->expiring.front().added + this->window < this->latest) {
+                const held &h = this->expiring.front();
+                auto store = this->stores.find(h.store);
+                if (store != this->stores.end()) {
+                    if (h.write) {
+                        auto it = store->second.writes.find(h.tx_id);
+                        if (it != store->second.writes.end() && it->second.added == h.added)
+                            store->second.writes.erase(it);
+                    } else {
+                        auto it = store->second.pending.find(h.tx_id);
+                        if (it != store->second.pending.end() && it->second.added == h.added) {
+                            this->unresolved += it->second.reads.size();
+                            store->second.pending.erase(it);
+                        }
+                    }
+                }
+                this->expiring.pop_front();
+            }
+        }
+
+        // Its transaction ids may be reused by a later store of the same trace id
+        void close_store(uint16_t store) {
+            auto it = this->stores.find(store);
+            if (it == this->stores.end())
+                return;
+            this->close_store_state(it->second);
+            this->stores.erase(it);
+        }
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_CHROME_TRACE_WRITER_H
@@ -8,9 +8,14 @@
 
 
 #include "kv_store.h"
+#include "random_generator.h"
 
+#include <algorithm>
 #include <list>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace mockdb {
     /*
@@ -20,7 +25,7 @@ namespace mockdb {
     template <typename K, typename V>
     class consistency_checker {
     public:
-        consistency_checker(const kv_store<K, V> *store) {
+        consistency_checker(const kv_store_base<K, V> *store) {
             this->store = store;
         }
 
@@ -28,57 +33,760 @@ namespace mockdb {
             // Pass
         }
 
-        virtual bool is_consistent(const transaction<K, V> *new_tx) = 0;
+        // Checks if new_tx may read the version written by written_by_tx_id
+        virtual bool is_consistent(const transaction<K, V> *new_tx, long written_by_tx_id) = 0;
+
+        // Called for every read as it is made, with the read as the current operation of the transaction
+        virtual void on_read(const transaction<K, V> *) {
+        }
+
+        // Called for every committed transaction, in commit order
+        virtual void on_commit(const transaction<K, V> *) {
+        }
+
+        /*
+         * Version numbers [first, last] the current read of new_tx may return among the
+         * candidates, first > last if there are none. Answered from state kept up to
+         * date by on_read and on_commit, without going through the history.
+         * By default every version is admissible.
+         */
+        virtual std::pair<size_t, size_t> admissible_versions(const transaction<K, V> *,
+                                                              const candidate_view<K, V> &candidates) {
+            return std::pair<size_t, size_t>(1, latest_of(candidates));
+        }
+
+        // True if no read of key may return a version older than version_number any more
+        virtual bool is_superseded(const K &, size_t) {
+            return false;
+        }
+
+        /*
+         * Declares every session which will read from the store. Checkers whose
+         * reads depend on what each session has seen can only tell a version is
+         * superseded for sessions they know of, so without it they report none is.
+         */
+        virtual void register_sessions(const std::vector<long> &) {
+        }
+
     protected:
-        const kv_store<K, V> *store;
+        const kv_store_base<K, V> *store;
+
+        struct key_version {
+            K key;
+            size_t version_number;
+        };
+
+        /*
+         * The version read by the current operation of tx and the transaction which
+         * wrote it. False if the operation didn't read a committed version.
+         */
+        static bool read_of(const transaction<K, V> *tx, key_version &read, long &written_by_tx_id) {
+            const operation<K, V> *op = tx->get_operation();
+            switch (op->get_kind()) {
+                case op_kind::GET: {
+                    const GET_response<K, V> *response = static_cast<const GET_operation<K, V>*>(op)->get_response();
+                    if (response == nullptr)
+                        return false;
+                    read = {op->get_params()->get_key(), response->get_version_number()};
+                    written_by_tx_id = response->get_written_by_tx_id();
+                    return true;
+                }
+                case op_kind::REMOVE: {
+                    const REMOVE_response<K, V> *response = static_cast<const REMOVE_operation<K, V>*>(op)->get_response();
+                    if (response == nullptr)
+                        return false;
+                    read = {op->get_params()->get_key(), response->get_read_version_number()};
+                    written_by_tx_id = response->get_written_by_tx_id();
+                    return true;
+                }
+                case op_kind::PUT:
+                    break;
+            }
+            return false;
+        }
+
+        // Versions written by a committed transaction
+        static std::vector<key_version> writes_of(const transaction<K, V> *tx) {
+            std::vector<key_version> written;
+            for (size_t i = 0; i < tx->get_operation_count(); i++) {
+                const operation<K, V> *op = tx->get_operation(i);
+                switch (op->get_kind()) {
+                    case op_kind::PUT: {
+                        const PUT_operation<K, V> *PUT_op = static_cast<const PUT_operation<K, V>*>(op);
+                        // Writes superseded within the transaction have no response
+                        if (PUT_op->get_response() != nullptr)
+                            written.push_back({PUT_op->get_params()->get_key(),
+                                               PUT_op->get_response()->get_version_number()});
+                        break;
+                    }
+                    case op_kind::REMOVE: {
+                        const REMOVE_operation<K, V> *REMOVE_op = static_cast<const REMOVE_operation<K, V>*>(op);
+                        const REMOVE_response<K, V> *response = REMOVE_op->get_response();
+                        if (response != nullptr && response->get_version_number() != 0)
+                            written.push_back({REMOVE_op->get_params()->get_key(), response->get_version_number()});
+                        break;
+                    }
+                    case op_kind::GET:
+                        break;
+                }
+            }
+            return written;
+        }
+
+        static size_t latest_of(const candidate_view<K, V> &candidates) {
+            return candidates.empty() ? 0 : candidates.get_version_number(candidates.size() - 1);
+        }
+
+        // Version of key written by the transaction among written, 0 if it didn't write key
+        static size_t version_written(const std::vector<key_version> &written, const K &key) {
+            for (auto &entry : written) {
+                if (entry.key == key)
+                    return entry.version_number;
+            }
+            return 0;
+        }
+
+        static void advance(std::unordered_map<K, size_t> &frontier, const K &key, size_t version_number) {
+            size_t &f = frontier[key];
+            if (f < version_number)
+                f = version_number;
+        }
+
+        /*
+         * True if the frontier of each of the registered sessions, and of every other
+         * session seen, has reached version_number of key. False if none is registered.
+         */
+        template <typename Session>
+        static bool all_past(const std::unordered_map<long, Session> &sessions, const std::vector<long> &registered,
+                             const K &key, size_t version_number) {
+            if (registered.empty())
+                return false;
+            for (long session_id : registered) {
+                if (sessions.find(session_id) == sessions.end())
+                    return false;
+            }
+            for (auto &session : sessions) {
+                auto f = session.second.frontier.find(key);
+                if (f == session.second.frontier.end() || f->second < version_number)
+                    return false;
+            }
+            return true;
+        }
     };
 
+    /*
+     * Incremental causal checker. Every session keeps a vector clock of its causal
+     * past ((wr U so)+) and, derived from it, the highest version number of each key
+     * in that past (its frontier). Both are updated in on_read and on_commit; a candidate is
+     * admissible iff its version number is not below the session's frontier for
+     * the key, which is a single lookup.
+     */
     template <typename K, typename V>
     class causal_consistency_checker : public consistency_checker<K, V>{
     public:
-        causal_consistency_checker(const kv_store<K, V> *store) : consistency_checker<K, V>(store){
+        causal_consistency_checker(const kv_store_base<K, V> *store) : consistency_checker<K, V>(store){
         }
 
-        bool is_consistent(const transaction<K, V> *new_tx) {
-            // Find tx from which new_tx reads
-            const GET_operation<K, V> *op = dynamic_cast<const GET_operation<K, V>*>(new_tx->get_operation());
-            long tx_id = op->get_response()->get_written_by_tx_id();
-            K key = op->get_response()->get_key();
-            long session_id = new_tx->get_session_id();
+        bool is_consistent(const transaction<K, V> *new_tx, long tx_id) {
+            // tx_id is the tx from which new_tx reads
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+
+            std::lock_guard<std::mutex> lck(this->mtx);
+            auto w = this->writes.find(tx_id);
+            if (w == this->writes.end())
+                return true;
+            size_t version_number = this->version_written(w->second.written, key);
+            return version_number == 0 || version_number >= frontier_of(new_tx->get_session_id(), key);
+        }
 
-            // Find (wr U so)+
-            // Since only one operation is allowed per transaction, we just need to find
-            // set of transactions which write the given key and are reachable from so
-            std::unordered_set<long> dependent_txs;
+        /*
+         * Admissible versions of a key always form a suffix of its chain, this returns
+         * the first version number of that suffix.
+         */
+        size_t lowest_admissible_version(const transaction<K, V> *new_tx) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            size_t frontier = frontier_of(new_tx->get_session_id(), key);
+            return frontier == 0 ? 1 : frontier;
+        }
 
-            for (auto tx : this->store->get_session_history(session_id)) {
-                const PUT_operation<K, V> *PUT_op =  dynamic_cast<const PUT_operation<K, V>*>(tx->get_operation());
-                if (PUT_op && PUT_op->get_params()->get_key() == key) {
-                    dependent_txs.insert(tx->get_tx_id());
-                }
-                else {
-                    const GET_operation<K, V> *GET_op = dynamic_cast<const GET_operation<K, V>*>(tx->get_operation());
-                    if (GET_op && GET_op->get_params()->get_key() == key) {
-                        dependent_txs.insert(GET_op->get_response()->get_written_by_tx_id());
-                    }
+        std::pair<size_t, size_t> admissible_versions(const transaction<K, V> *new_tx,
+                                                      const candidate_view<K, V> &candidates) {
+            return std::pair<size_t, size_t>(this->lowest_admissible_version(new_tx), this->latest_of(candidates));
+        }
+
+        /*
+         * True if every registered session already has version_number of the key in
+         * its causal past, so none of them may read an older version any more. A
+         * session which hasn't read yet may read any version, so nothing is
+         * superseded until all sessions are registered.
+         */
+        bool is_superseded(const K &key, size_t version_number) {
+            std::lock_guard<std::mutex> lck(this->mtx);
+            return this->all_past(this->sessions, this->registered, key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            std::lock_guard<std::mutex> lck(this->mtx);
+            this->registered.insert(this->registered.end(), session_ids.begin(), session_ids.end());
+        }
+
+        // The read of the current operation of tx enters the causal past of its session
+        void on_read(const transaction<K, V> *tx) {
+            key_version read;
+            long written_by_tx_id;
+            if (!this->read_of(tx, read, written_by_tx_id))
+                return;
+            std::lock_guard<std::mutex> lck(this->mtx);
+            record_read(this->sessions[tx->get_session_id()], read.key, written_by_tx_id, read.version_number);
+        }
+
+        /*
+         * Writes of a transaction become visible together: they all carry the clock
+         * of the session after the last of them, so reading any one brings all of
+         * them into the causal past of the reader.
+         */
+        void on_commit(const transaction<K, V> *tx) {
+            std::vector<key_version> written = this->writes_of(tx);
+            if (written.empty())
+                return;
+
+            std::lock_guard<std::mutex> lck(this->mtx);
+            long session_id = tx->get_session_id();
+            session_state &session = this->sessions[session_id];
+            for (auto &entry : written)
+                record_write(session, entry.key, entry.version_number);
+            session.clock[session_id] = session.writes.size();
+            session.committed.push_back(tx->get_tx_id());
+            this->writes[tx->get_tx_id()] = {std::move(written), session.clock};
+        }
+
+    protected:
+        typedef typename consistency_checker<K, V>::key_version key_version;
+
+        // session id -> number of writes of that session in the causal past
+        typedef std::unordered_map<long, size_t> vector_clock;
+
+        struct session_state {
+            vector_clock clock;
+            std::unordered_map<K, size_t> frontier;
+            std::vector<key_version> writes;    // Writes of this session in session order
+            std::vector<long> committed;        // Transactions of this session which wrote, in order
+        };
+
+        struct write_record {
+            std::vector<key_version> written;   // Keys written by the transaction
+            vector_clock clock;     // Causal past of the writing session at the commit
+        };
+
+        void record_write(session_state &session, const K &key, size_t version_number) {
+            session.writes.push_back({key, version_number});
+            this->advance(session.frontier, key, version_number);
+        }
+
+        // Everything in the causal past of the write is now in the causal past of the session
+        void record_read(session_state &session, const K &key, long written_by_tx_id, size_t version_number) {
+            auto w = this->writes.find(written_by_tx_id);
+            if (w != this->writes.end())
+                merge(session, w->second.clock);
+            this->advance(session.frontier, key, version_number);
+        }
+
+        // Each write enters the frontier of a session at most once
+        void merge(session_state &session, const vector_clock &clock) {
+            for (auto &entry : clock) {
+                size_t &seen = session.clock[entry.first];
+                if (entry.second <= seen)
+                    continue;
+                const std::vector<key_version> &other = this->sessions[entry.first].writes;
+                for (size_t i = seen; i < entry.second; i++)
+                    this->advance(session.frontier, other[i].key, other[i].version_number);
+                seen = entry.second;
+            }
+        }
+
+        size_t frontier_of(long session_id, const K &key) const {
+            auto session = this->sessions.find(session_id);
+            if (session == this->sessions.end())
+                return 0;
+            auto f = session->second.frontier.find(key);
+            return f == session->second.frontier.end() ? 0 : f->second;
+        }
+
+        std::mutex mtx;
+        std::unordered_map<long, session_state> sessions;
+        std::unordered_map<long, write_record> writes;  // tx id -> write
+        std::vector<long> registered;                   // Every session which reads, if known
+    };
+
+    /*
+     * Read committed: a read may return any committed version. The store only offers
+     * committed versions, the buffered writes of open transactions are never
+     * candidates, so every candidate is admissible and reads of one transaction may
+     * see another transaction's writes only in part.
+     */
+    template <typename K, typename V>
+    class read_committed_checker : public consistency_checker<K, V> {
+    public:
+        read_committed_checker(const kv_store_base<K, V> *store) : consistency_checker<K, V>(store) {
+        }
+
+        bool is_consistent(const transaction<K, V> *, long) {
+            return true;
+        }
+    };
+
+    /*
+     * Read atomic: once a transaction has read from another one, its later reads of
+     * the keys that one wrote return the same version or a newer one, so it never
+     * sees the writes of a transaction in part (no fractured reads). Reads of
+     * different transactions don't constrain each other. Each open transaction keeps
+     * the highest version of each key written by the transactions it read from, a
+     * transaction's writes enter it once.
+     */
+    template <typename K, typename V>
+    class read_atomic_checker : public consistency_checker<K, V> {
+    public:
+        read_atomic_checker(const kv_store_base<K, V> *store) : consistency_checker<K, V>(store) {
+        }
+
+        bool is_consistent(const transaction<K, V> *new_tx, long tx_id) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            auto w = this->writes.find(tx_id);
+            if (w == this->writes.end())
+                return true;
+            size_t version_number = this->version_written(w->second, key);
+            return version_number == 0 || version_number >= frontier_of(new_tx->get_tx_id(), key);
+        }
+
+        std::pair<size_t, size_t> admissible_versions(const transaction<K, V> *new_tx,
+                                                      const candidate_view<K, V> &candidates) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            size_t frontier = frontier_of(new_tx->get_tx_id(), key);
+            return std::pair<size_t, size_t>(frontier == 0 ? 1 : frontier, this->latest_of(candidates));
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            key_version read;
+            long written_by_tx_id;
+            if (!this->read_of(tx, read, written_by_tx_id))
+                return;
+            std::lock_guard<std::mutex> lck(this->mtx);
+            open_state &open = this->open[tx->get_tx_id()];
+            auto w = this->writes.find(written_by_tx_id);
+            if (w != this->writes.end() && open.read_from.insert(written_by_tx_id).second) {
+                for (auto &entry : w->second)
+                    this->advance(open.frontier, entry.key, entry.version_number);
+            }
+            this->advance(open.frontier, read.key, read.version_number);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            std::vector<key_version> written = this->writes_of(tx);
+            std::lock_guard<std::mutex> lck(this->mtx);
+            this->open.erase(tx->get_tx_id());
+            if (!written.empty())
+                this->writes[tx->get_tx_id()] = std::move(written);
+        }
+
+    private:
+        typedef typename consistency_checker<K, V>::key_version key_version;
+
+        struct open_state {
+            std::unordered_map<K, size_t> frontier;
+            std::unordered_set<long> read_from;
+        };
+
+        size_t frontier_of(long tx_id, const K &key) const {
+            auto open = this->open.find(tx_id);
+            if (open == this->open.end())
+                return 0;
+            auto f = open->second.frontier.find(key);
+            return f == open->second.frontier.end() ? 0 : f->second;
+        }
+
+        std::mutex mtx;
+        std::unordered_map<long, open_state> open;                      // tx id -> reads so far
+        std::unordered_map<long, std::vector<key_version>> writes;      // tx id -> versions written
+    };
+
+    // Session guarantees (Terry et al.), combined with |
+    enum session_guarantee : unsigned {
+        READ_YOUR_WRITES = 1,       // A session reads its own writes or newer versions
+        MONOTONIC_READS = 2,        // A session doesn't read older versions than the transactions it read from wrote
+        MONOTONIC_WRITES = 4,       // Reading a transaction shows the earlier writes of its session
+        WRITES_FOLLOW_READS = 8     // Reading a transaction shows the writes its session had read before it
+    };
+
+    /*
+     * Checks a combination of session guarantees, without the transitivity that
+     * makes all four together causal. Each session keeps a frontier, the highest
+     * version of each key it must not read below; the guarantees decide which writes
+     * enter it. Every write enters the frontier of a session at most once per
+     * guarantee, sessions remember how much of another session's writes and reads
+     * they have taken in, so a read costs amortized constant time per key written.
+     */
+    template <typename K, typename V>
+    class session_guarantee_checker : public consistency_checker<K, V> {
+    public:
+        session_guarantee_checker(const kv_store_base<K, V> *store, unsigned guarantees) : consistency_checker<K, V>(store) {
+            this->guarantees = guarantees;
+        }
+
+        bool is_consistent(const transaction<K, V> *new_tx, long tx_id) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            auto w = this->writes.find(tx_id);
+            if (w == this->writes.end())
+                return true;
+            size_t version_number = this->version_written(w->second.written, key);
+            return version_number == 0 || version_number >= frontier_of(new_tx->get_session_id(), key);
+        }
+
+        std::pair<size_t, size_t> admissible_versions(const transaction<K, V> *new_tx,
+                                                      const candidate_view<K, V> &candidates) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            size_t frontier = frontier_of(new_tx->get_session_id(), key);
+            return std::pair<size_t, size_t>(frontier == 0 ? 1 : frontier, this->latest_of(candidates));
+        }
+
+        // Like causal consistency, only once every session is registered
+        bool is_superseded(const K &key, size_t version_number) {
+            std::lock_guard<std::mutex> lck(this->mtx);
+            return this->all_past(this->sessions, this->registered, key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            std::lock_guard<std::mutex> lck(this->mtx);
+            this->registered.insert(this->registered.end(), session_ids.begin(), session_ids.end());
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            key_version read;
+            long written_by_tx_id;
+            if (!this->read_of(tx, read, written_by_tx_id))
+                return;
+
+            std::lock_guard<std::mutex> lck(this->mtx);
+            session_state &session = this->sessions[tx->get_session_id()];
+            if (this->guarantees & MONOTONIC_READS)
+                this->advance(session.frontier, read.key, read.version_number);
+
+            auto w = this->writes.find(written_by_tx_id);
+            if (w == this->writes.end())
+                return;
+            const write_record &record = w->second;
+            if ((this->guarantees & MONOTONIC_READS) && session.read_from.insert(written_by_tx_id).second) {
+                for (auto &entry : record.written)
+                    this->advance(session.frontier, entry.key, entry.version_number);
+            }
+
+            session_state &writer = this->sessions[record.session_id];
+            if (this->guarantees & MONOTONIC_WRITES) {
+                size_t &seen = session.writes_seen[record.session_id];
+                for (; seen < record.writes_end; seen++)
+                    this->advance(session.frontier, writer.writes[seen].key, writer.writes[seen].version_number);
+            }
+            if (this->guarantees & WRITES_FOLLOW_READS) {
+                size_t &seen = session.reads_seen[record.session_id];
+                for (; seen < record.reads_end; seen++) {
+                    for (auto &entry : this->writes[writer.reads[seen]].written)
+                        this->advance(session.frontier, entry.key, entry.version_number);
                 }
+                // Readers of this session's later writes must see it
+                session.reads.push_back(written_by_tx_id);
+            }
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            std::vector<key_version> written = this->writes_of(tx);
+            if (written.empty())
+                return;
+
+            std::lock_guard<std::mutex> lck(this->mtx);
+            long session_id = tx->get_session_id();
+            session_state &session = this->sessions[session_id];
+            for (auto &entry : written) {
+                session.writes.push_back(entry);
+                if (this->guarantees & READ_YOUR_WRITES)
+                    this->advance(session.frontier, entry.key, entry.version_number);
             }
-            if (dependent_txs.size() == 0)
+            this->writes[tx->get_tx_id()] = {session_id, std::move(written), session.writes.size(), session.reads.size()};
+        }
+
+        unsigned get_guarantees() const {
+            return this->guarantees;
+        }
+
+    private:
+        typedef typename consistency_checker<K, V>::key_version key_version;
+
+        struct session_state {
+            std::unordered_map<K, size_t> frontier;
+            std::vector<key_version> writes;                // Writes of this session in session order
+            std::vector<long> reads;                        // Transactions this session read from, in order
+            std::unordered_set<long> read_from;             // Transactions whose writes are in the frontier
+            std::unordered_map<long, size_t> writes_seen;   // Session id -> prefix of its writes in the frontier
+            std::unordered_map<long, size_t> reads_seen;    // Session id -> prefix of its reads in the frontier
+        };
+
+        struct write_record {
+            long session_id;
+            std::vector<key_version> written;
+            size_t writes_end;      // Writes of the session up to and including this transaction
+            size_t reads_end;       // Reads of the session before this transaction committed
+        };
+
+        size_t frontier_of(long session_id, const K &key) const {
+            auto session = this->sessions.find(session_id);
+            if (session == this->sessions.end())
+                return 0;
+            auto f = session->second.frontier.find(key);
+            return f == session->second.frontier.end() ? 0 : f->second;
+        }
+
+        unsigned guarantees;
+        std::mutex mtx;
+        std::unordered_map<long, session_state> sessions;
+        std::unordered_map<long, write_record> writes;  // tx id -> write
+        std::vector<long> registered;                   // Every session which reads, if known
+    };
+
+    /*
+     * Snapshot isolation: every transaction reads from one snapshot, a prefix of the
+     * commit order which contains the earlier transactions of its session. The
+     * snapshot is chosen lazily: a transaction keeps the interval of commit points
+     * consistent with its reads so far, starting from its session's last commit up
+     * to the last commit at its first read, and every read narrows it to the points
+     * at which the version read was the latest one. Admissible versions are the ones
+     * latest at some point of the interval, found by binary search over the commit
+     * points of the key's versions.
+     * Write-write conflicts aren't prevented, the store has no aborts.
+     */
+    template <typename K, typename V>
+    class snapshot_isolation_checker : public consistency_checker<K, V> {
+    public:
+        snapshot_isolation_checker(const kv_store_base<K, V> *store) : consistency_checker<K, V>(store) {
+        }
+
+        bool is_consistent(const transaction<K, V> *new_tx, long tx_id) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            auto w = this->writes.find(tx_id);
+            if (w == this->writes.end())
+                return true;
+            size_t version_number = this->version_written(w->second, key);
+            if (version_number == 0)
                 return true;
+            std::pair<size_t, size_t> range = versions_locked(new_tx, version_number);
+            return range.first <= version_number && version_number <= range.second;
+        }
 
-            // Check if all dependent_txs are committed before tx_id
-            size_t committed_count = 0;
-            for (auto tx : this->store->get_history()) {
-                if (dependent_txs.find(tx->get_tx_id()) != dependent_txs.end())
-                    committed_count++;
-                if (tx->get_tx_id() == tx_id) {
-                    if (committed_count == dependent_txs.size())
-                        return true;
-                    return false;
+        std::pair<size_t, size_t> admissible_versions(const transaction<K, V> *new_tx,
+                                                      const candidate_view<K, V> &candidates) {
+            std::lock_guard<std::mutex> lck(this->mtx);
+            return versions_locked(new_tx, this->latest_of(candidates));
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            key_version read;
+            long written_by_tx_id;
+            if (!this->read_of(tx, read, written_by_tx_id))
+                return;
+            std::lock_guard<std::mutex> lck(this->mtx);
+            snapshot &snap = snapshot_of(tx);
+            auto c = this->committed_at.find(read.key);
+            if (c == this->committed_at.end() || read.version_number == 0 || read.version_number > c->second.size())
+                return;
+            const std::vector<size_t> &at = c->second;
+            snap.first = std::max(snap.first, at[read.version_number - 1]);
+            if (read.version_number < at.size())
+                snap.last = std::min(snap.last, at[read.version_number] - 1);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            std::vector<key_version> written = this->writes_of(tx);
+            std::lock_guard<std::mutex> lck(this->mtx);
+            size_t point = ++(this->commits);
+            for (auto &entry : written) {
+                std::vector<size_t> &at = this->committed_at[entry.key];
+                if (at.size() < entry.version_number)
+                    at.resize(entry.version_number, point);
+                at[entry.version_number - 1] = point;
+            }
+            this->last_commit[tx->get_session_id()] = point;
+            this->snapshots.erase(tx->get_tx_id());
+            if (!written.empty())
+                this->writes[tx->get_tx_id()] = std::move(written);
+        }
+
+    private:
+        typedef typename consistency_checker<K, V>::key_version key_version;
+
+        // Commit points [first, last] the snapshot of a transaction may end at
+        struct snapshot {
+            size_t first;
+            size_t last;
+        };
+
+        snapshot &snapshot_of(const transaction<K, V> *tx) {
+            auto s = this->snapshots.find(tx->get_tx_id());
+            if (s != this->snapshots.end())
+                return s->second;
+            auto l = this->last_commit.find(tx->get_session_id());
+            snapshot snap = {l == this->last_commit.end() ? 0 : l->second, this->commits};
+            return this->snapshots.emplace(tx->get_tx_id(), snap).first->second;
+        }
+
+        std::pair<size_t, size_t> versions_locked(const transaction<K, V> *new_tx, size_t latest) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            const snapshot &snap = snapshot_of(new_tx);
+            auto c = this->committed_at.find(key);
+            if (c == this->committed_at.end())
+                return std::pair<size_t, size_t>(1, latest);
+            auto end = c->second.begin() + std::min(latest, c->second.size());
+            // Versions committed up to a point, the last of them is the one latest there
+            size_t last = std::upper_bound(c->second.begin(), end, snap.last) - c->second.begin();
+            size_t first = std::upper_bound(c->second.begin(), end, snap.first) - c->second.begin();
+            return std::pair<size_t, size_t>(first == 0 ? 1 : first, last);
+        }
+
+        std::mutex mtx;
+        size_t commits = 0;                                         // Commit points so far
+        std::unordered_map<K, std::vector<size_t>> committed_at;    // Commit point of each version, by number
+        std::unordered_map<long, size_t> last_commit;               // Session id -> its last commit point
+        std::unordered_map<long, snapshot> snapshots;               // Open tx id -> its snapshot
+        std::unordered_map<long, std::vector<key_version>> writes;  // tx id -> versions written
+    };
+
+    /*
+     * Parallel snapshot isolation: every transaction reads from one snapshot which
+     * is closed under causality and contains the causal past of its session, but
+     * sessions may see concurrent transactions in different orders (long fork). At
+     * the first read of a transaction the causal past of its session is extended
+     * with a prefix, chosen at random, of the writing transactions of every other
+     * session; the transaction then reads the latest version of each key in it,
+     * which is its frontier. A key without versions in the snapshot brings in the
+     * oldest one and its causal past, unless that would change a read already made.
+     * Taking a snapshot costs a binary search per session plus the writes merged,
+     * each of which enters a session once.
+     * Write-write conflicts aren't prevented, the store has no aborts.
+     */
+    template <typename K, typename V>
+    class parallel_snapshot_isolation_checker : public causal_consistency_checker<K, V> {
+    public:
+        parallel_snapshot_isolation_checker(const kv_store_base<K, V> *store, uint64_t seed = random_seed())
+                : causal_consistency_checker<K, V>(store), random(seed) {
+        }
+
+        bool is_consistent(const transaction<K, V> *new_tx, long tx_id) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            take_snapshot(new_tx);
+            auto w = this->writes.find(tx_id);
+            if (w == this->writes.end())
+                return false;
+            size_t version_number = this->version_written(w->second.written, key);
+            return version_number != 0 && version_number == this->frontier_of(new_tx->get_session_id(), key);
+        }
+
+        std::pair<size_t, size_t> admissible_versions(const transaction<K, V> *new_tx,
+                                                      const candidate_view<K, V> &candidates) {
+            const K &key = new_tx->get_operation()->get_params()->get_key();
+            std::lock_guard<std::mutex> lck(this->mtx);
+            take_snapshot(new_tx);
+            long session_id = new_tx->get_session_id();
+            size_t frontier = this->frontier_of(session_id, key);
+            if (frontier == 0 && !candidates.empty())
+                frontier = extend(new_tx, candidates.get_tx_id(0)) ? this->frontier_of(session_id, key) : 0;
+            if (frontier == 0 || frontier > this->latest_of(candidates))
+                return std::pair<size_t, size_t>(1, 0);
+            return std::pair<size_t, size_t>(frontier, frontier);
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            key_version read;
+            long written_by_tx_id;
+            if (!this->read_of(tx, read, written_by_tx_id))
+                return;
+            {
+                std::lock_guard<std::mutex> lck(this->mtx);
+                this->snapshots[tx->get_tx_id()].insert(read.key);
+            }
+            causal_consistency_checker<K, V>::on_read(tx);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            {
+                std::lock_guard<std::mutex> lck(this->mtx);
+                this->snapshots.erase(tx->get_tx_id());
+            }
+            causal_consistency_checker<K, V>::on_commit(tx);
+        }
+
+    private:
+        typedef typename causal_consistency_checker<K, V>::key_version key_version;
+        typedef typename causal_consistency_checker<K, V>::session_state session_state;
+        typedef typename causal_consistency_checker<K, V>::vector_clock vector_clock;
+
+        // Extends the causal past of the session of tx once per transaction, mtx must be held
+        void take_snapshot(const transaction<K, V> *tx) {
+            if (this->snapshots.find(tx->get_tx_id()) != this->snapshots.end())
+                return;
+            this->snapshots[tx->get_tx_id()];
+            long session_id = tx->get_session_id();
+            session_state &session = this->sessions[session_id];
+
+            // Sessions in a fixed order, so the same seed takes the same snapshots
+            std::vector<long> others;
+            for (auto &entry : this->sessions) {
+                if (entry.first != session_id)
+                    others.push_back(entry.first);
+            }
+            std::sort(others.begin(), others.end());
+
+            for (long other_id : others) {
+                const std::vector<long> &committed = this->sessions[other_id].committed;
+                size_t seen = session.clock[other_id];
+                // First transaction of the other session not yet in the causal past
+                auto unseen = std::upper_bound(committed.begin(), committed.end(), seen,
+                                               [this, other_id](size_t count, long tx_id) {
+                                                   return count < this->writes[tx_id].clock[other_id];
+                                               });
+                size_t taken = this->random.uniform((size_t) (committed.end() - unseen) + 1);
+                if (taken > 0)
+                    this->merge(session, this->writes[*(unseen + taken - 1)].clock);
+            }
+        }
+
+        /*
+         * Adds the write of tx_id and its causal past to the snapshot of tx, unless it
+         * holds newer versions of keys tx already read. mtx must be held.
+         */
+        bool extend(const transaction<K, V> *tx, long tx_id) {
+            auto w = this->writes.find(tx_id);
+            if (w == this->writes.end())
+                return false;
+            const std::unordered_set<K> &read = this->snapshots[tx->get_tx_id()];
+            session_state &session = this->sessions[tx->get_session_id()];
+            const vector_clock &clock = w->second.clock;
+            for (auto &entry : clock) {
+                const std::vector<key_version> &other = this->sessions[entry.first].writes;
+                for (size_t i = session.clock[entry.first]; i < entry.second; i++) {
+                    if (read.find(other[i].key) != read.end() &&
+                        other[i].version_number > this->frontier_of(tx->get_session_id(), other[i].key))
+                        return false;
                 }
             }
-            return false;
+            this->merge(session, clock);
+            return true;
         }
+
+        random_generator random;
+        std::unordered_map<long, std::unordered_set<K>> snapshots;  // Tx id -> keys read from its snapshot
     };
 
 }
@@ -0,0 +1,158 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Runs sessions one at a time, switching only at their scheduling points.
+
+#ifndef MOCK_KEY_VALUE_STORE_COOPERATIVE_RUNNER_H
+#define MOCK_KEY_VALUE_STORE_COOPERATIVE_RUNNER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Each session runs in its own thread, but only the one holding the turn makes
+     * progress. A session gives the turn back at a scheduling point (yield_current,
+     * called by kv_store::begin) or when it finishes; pick then chooses the next one.
+     * A step is everything a session does between two scheduling points.
+     *
+     * Time is virtual: it advances by one per step, and a session may delay itself by
+     * a number of steps instead of sleeping. When every unfinished session is
+     * delayed, time jumps to the earliest wake-up.
+     *
+     * Sessions must not hold locks other sessions wait for across scheduling points.
+     */
+    class cooperative_runner {
+    public:
+        virtual ~cooperative_runner() {
+        }
+
+        // Scheduling point of the calling session, no-op outside the sessions of a runner
+        static void yield_current() {
+            delay_current(0);
+        }
+
+        // Scheduling point after which the calling session sits out the next ticks steps
+        static void delay_current(uint64_t ticks) {
+            cooperative_runner *runner = current_runner();
+            if (runner != nullptr)
+                runner->switch_out(ticks);
+        }
+
+        uint64_t get_time() const {
+            return this->time;
+        }
+
+    protected:
+        static const size_t scheduler_turn = (size_t) -1;
+
+        // Runs the sessions to completion
+        void run_sessions(const std::vector<std::function<void()>> &sessions) {
+            this->finished.assign(sessions.size(), false);
+            this->wake.assign(sessions.size(), 0);
+            this->time = 0;
+            this->turn = scheduler_turn;
+
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < sessions.size(); i++)
+                threads.push_back(std::thread(&cooperative_runner::run_session, this, i, std::cref(sessions[i])));
+
+            while (true) {
+                std::vector<size_t> enabled;
+                uint64_t next_wake = UINT64_MAX;
+                for (size_t i = 0; i < sessions.size(); i++) {
+                    if (this->finished[i])
+                        continue;
+                    if (this->wake[i] <= this->time)
+                        enabled.push_back(i);
+                    else if (this->wake[i] < next_wake)
+                        next_wake = this->wake[i];
+                }
+                if (enabled.empty()) {
+                    if (next_wake == UINT64_MAX)
+                        break;
+                    this->time = next_wake;
+                    continue;
+                }
+
+                size_t session = this->pick(enabled);
+                this->hand_over(session);
+                this->time++;
+                this->after_step(session);
+            }
+
+            for (auto &t : threads)
+                t.join();
+        }
+
+        // Chooses the session of the next step among the enabled ones
+        virtual size_t pick(const std::vector<size_t> &enabled) = 0;
+
+        // Called once the step of session has ended
+        virtual void after_step(size_t) {
+        }
+
+        // True if the calling thread runs a session of this runner
+        bool in_session() const {
+            return current_runner() == this;
+        }
+
+    private:
+        void run_session(size_t session, const std::function<void()> &program) {
+            current_runner() = this;
+            current_session() = session;
+            {
+                std::unique_lock<std::mutex> lck(this->mtx);
+                this->cv.wait(lck, [this, session] { return this->turn == session; });
+            }
+            program();
+
+            std::lock_guard<std::mutex> lck(this->mtx);
+            this->finished[session] = true;
+            this->turn = scheduler_turn;
+            current_runner() = nullptr;
+            this->cv.notify_all();
+        }
+
+        void switch_out(uint64_t ticks) {
+            std::unique_lock<std::mutex> lck(this->mtx);
+            size_t session = current_session();
+            this->wake[session] = this->time + 1 + ticks;
+            this->turn = scheduler_turn;
+            this->cv.notify_all();
+            this->cv.wait(lck, [this, session] { return this->turn == session; });
+        }
+
+        // Lets session run until it reaches a scheduling point or finishes
+        void hand_over(size_t session) {
+            std::unique_lock<std::mutex> lck(this->mtx);
+            this->turn = session;
+            this->cv.notify_all();
+            this->cv.wait(lck, [this] { return this->turn == scheduler_turn; });
+        }
+
+        static cooperative_runner *&current_runner() {
+            static thread_local cooperative_runner *current = nullptr;
+            return current;
+        }
+
+        static size_t &current_session() {
+            static thread_local size_t session = 0;
+            return session;
+        }
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        size_t turn = scheduler_turn;   // Session allowed to run, or the scheduler
+        std::vector<bool> finished;
+        std::vector<uint64_t> wake;     // Time from which each session may run again
+        uint64_t time = 0;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_COOPERATIVE_RUNNER_H
@@ -0,0 +1,286 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Records the choices of an execution and replays them.
+
+#ifndef MOCK_KEY_VALUE_STORE_DECISION_LOG_H
+#define MOCK_KEY_VALUE_STORE_DECISION_LOG_H
+
+#include "read_response_selector.h"
+
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Choices of one execution: the session of every scheduling step and the index of
+     * the candidate returned by every read, in the order they were made. Reads are in
+     * a well-defined order only if sessions run one at a time, under a
+     * session_scheduler, so only those executions replay exactly.
+     *
+     * Text format, one line each:
+     *   mockdb-decisions 1
+     *   seed <seed>
+     *   program <text>
+     *   schedule <count> <session>...
+     *   reads <count> <index, x or l>...
+     * where x is a read for which no version was admissible, and l one which returns
+     * the latest admissible version, whatever its index.
+     */
+    class decision_log {
+    public:
+        static const size_t no_response = (size_t) -1;
+        static const size_t latest = (size_t) -2;
+
+        uint64_t seed = 0;                  // Seed the execution was run with, informative
+        std::string program;                // Operations of the sessions if the application varies them, one line
+        std::vector<size_t> schedule;
+        std::vector<size_t> reads;
+
+        void write(std::ostream &out) const {
+            out << "mockdb-decisions 1\n";
+            out << "seed " << this->seed << "\n";
+            out << "program " << this->program << "\n";
+            out << "schedule " << this->schedule.size();
+            for (size_t session : this->schedule)
+                out << " " << session;
+            out << "\nreads " << this->reads.size();
+            for (size_t index : this->reads) {
+                if (index == no_response)
+                    out << " x";
+                else if (index == latest)
+                    out << " l";
+                else
+                    out << " " << index;
+            }
+            out << "\n";
+        }
+
+        // Throws std::runtime_error if in doesn't hold a decision log
+        static decision_log read(std::istream &in) {
+            decision_log log;
+            std::string word;
+            int format = 0;
+            if (!(in >> word >> format) || word != "mockdb-decisions" || format != 1)
+                throw std::runtime_error("Not a decision log");
+            if (!(in >> word >> log.seed) || word != "seed")
+                throw std::runtime_error("Decision log: missing seed");
+            if (!(in >> word) || word != "program")
+                throw std::runtime_error("Decision log: missing program");
+            std::getline(in, log.program);
+            if (!log.program.empty() && log.program[0] == ' ')
+                log.program.erase(0, 1);
+            read_choices(in, "schedule", log.schedule);
+            read_choices(in, "reads", log.reads);
+            return log;
+        }
+
+        bool operator==(const decision_log &other) const {
+            return this->program == other.program && this->schedule == other.schedule &&
+                   this->reads == other.reads;
+        }
+
+    private:
+        static void read_choices(std::istream &in, const std::string &name, std::vector<size_t> &choices) {
+            std::string word;
+            size_t count = 0;
+            if (!(in >> word >> count) || word != name)
+                throw std::runtime_error("Decision log: missing " + name);
+            choices.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                if (!(in >> word))
+                    throw std::runtime_error("Decision log: truncated " + name);
+                if (word == "x")
+                    choices[i] = no_response;
+                else if (word == "l")
+                    choices[i] = latest;
+                else
+                    choices[i] = std::stoull(word);
+            }
+        }
+    };
+
+    /*
+     * Appends the choice of every read of an inner selector to a decision log.
+     * Takes ownership of the inner selector.
+     */
+    template<typename K, typename V>
+    class recording_read_response_selector : public read_response_selector<K, V> {
+    public:
+        recording_read_response_selector(read_response_selector<K, V> *inner, decision_log *log) {
+            this->inner = inner;
+            this->log = log;
+        }
+
+        ~recording_read_response_selector() {
+            delete this->inner;
+        }
+
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
+            this->store = store;
+            this->inner->init_consistency_checker(store);
+        }
+
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *op,
+                                    const candidate_view<K, V> &candidates) {
+            size_t index = decision_log::no_response;
+            try {
+                index = this->inner->select_read_response(tx, op, candidates);
+            } catch (consistency_exception &e) {
+                std::lock_guard<std::mutex> lck(this->mtx);
+                this->log->reads.push_back(index);
+                throw;
+            }
+            std::lock_guard<std::mutex> lck(this->mtx);
+            this->log->reads.push_back(index);
+            return index;
+        }
+
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *tx,
+                                                   const operation<K, V> *op,
+                                                   const candidate_view<K, V> &candidates) {
+            return this->inner->admissible_range(tx, op, candidates);
+        }
+
+        void before_read(const transaction<K, V> *tx, const K &key) {
+            this->inner->before_read(tx, key);
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            this->inner->on_read(tx);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            this->inner->on_commit(tx);
+        }
+
+        bool is_superseded(const K &key, size_t version_number) {
+            return this->inner->is_superseded(key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            this->inner->register_sessions(session_ids);
+        }
+
+        bool serializes_transactions() const {
+            return this->inner->serializes_transactions();
+        }
+
+        void set_instrumentation(instrumentation *metrics) {
+            this->metrics = metrics;
+            this->inner->set_instrumentation(metrics);
+        }
+
+        read_response_selector<K, V> *get_inner() const {
+            return this->inner;
+        }
+
+    private:
+        read_response_selector<K, V> *inner;
+        decision_log *log;
+        std::mutex mtx;     // Reads of sessions not run one at a time may be concurrent
+    };
+
+    /*
+     * Returns the reads of a decision log in order, keeping the checker of the inner
+     * selector up to date. Once a recorded choice isn't admissible any more, or the
+     * log runs out, the execution has diverged from the recorded one: the inner
+     * selector chooses from the next read on and has_diverged is true.
+     * Takes ownership of the inner selector.
+     */
+    template<typename K, typename V>
+    class replaying_read_response_selector : public read_response_selector<K, V> {
+    public:
+        replaying_read_response_selector(read_response_selector<K, V> *inner, const decision_log &log) {
+            this->inner = inner;
+            this->reads = log.reads;
+        }
+
+        ~replaying_read_response_selector() {
+            delete this->inner;
+        }
+
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
+            this->store = store;
+            this->inner->init_consistency_checker(store);
+        }
+
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *op,
+                                    const candidate_view<K, V> &candidates) {
+            if (this->diverged || this->next == this->reads.size()) {
+                this->diverged = true;
+                return this->inner->select_read_response(tx, op, candidates);
+            }
+
+            size_t index = this->reads[this->next++];
+            std::pair<size_t, size_t> range = this->inner->admissible_range(tx, op, candidates);
+            if (range.first > range.second || range.second >= candidates.size()) {
+                this->diverged = this->diverged || index != decision_log::no_response;
+                throw consistency_exception("GET", tx->get_tx_id());
+            }
+            if (index == decision_log::latest)
+                return range.second;
+            if (range.first <= index && index <= range.second)
+                return index;
+            // The range was taken for this read already, settle for the latest version
+            this->diverged = true;
+            return range.second;
+        }
+
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *tx,
+                                                   const operation<K, V> *op,
+                                                   const candidate_view<K, V> &candidates) {
+            return this->inner->admissible_range(tx, op, candidates);
+        }
+
+        void before_read(const transaction<K, V> *tx, const K &key) {
+            this->inner->before_read(tx, key);
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            this->inner->on_read(tx);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            this->inner->on_commit(tx);
+        }
+
+        bool is_superseded(const K &key, size_t version_number) {
+            return this->inner->is_superseded(key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            this->inner->register_sessions(session_ids);
+        }
+
+        bool serializes_transactions() const {
+            return this->inner->serializes_transactions();
+        }
+
+        void set_instrumentation(instrumentation *metrics) {
+            this->metrics = metrics;
+            this->inner->set_instrumentation(metrics);
+        }
+
+        // True if the execution didn't follow the log, or didn't use all of it
+        bool has_diverged() const {
+            return this->diverged || this->next < this->reads.size();
+        }
+
+    private:
+        read_response_selector<K, V> *inner;
+        std::vector<size_t> reads;
+        size_t next = 0;
+        bool diverged = false;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_DECISION_LOG_H
@@ -0,0 +1,329 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Systematic exploration of read choices and session interleavings.
+
+#ifndef MOCK_KEY_VALUE_STORE_EXPLORER_H
+#define MOCK_KEY_VALUE_STORE_EXPLORER_H
+
+#include "cooperative_runner.h"
+#include "read_response_selector.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Stateless model checker for a fixed program of sessions. Each call to run
+     * executes the program once; next then backtracks to the deepest choice with an
+     * unexplored alternative, until the whole tree has been covered.
+     *
+     * There are two kinds of choices:
+     *  - schedule: which session runs next at a scheduling point, see
+     *    cooperative_runner.
+     *  - read: which admissible version a read returns, see
+     *    exploring_read_response_selector.
+     *
+     * Interleavings are pruned with sleep sets: once the subtree of session p has
+     * been explored from a state, p is not scheduled again in the subtrees of its
+     * siblings until a step conflicting with p's step (one writing a key the other
+     * reads or writes) has run. An execution in which every enabled session is
+     * asleep repeats an explored one; run reports it as redundant.
+     *
+     * Programs must be deterministic given the choices: same choices, same operations.
+     */
+    class explorer : public cooperative_runner {
+    public:
+        explorer() {
+        }
+
+        /*
+         * Runs the sessions once under the current choices, each in its own thread.
+         * Returns false if the execution was redundant.
+         */
+        bool run(const std::vector<std::function<void()>> &sessions) {
+            this->depth = 0;
+            this->redundant = false;
+            this->previous = -1;
+            this->run_sessions(sessions);
+            this->executions++;
+            return !this->redundant;
+        }
+
+        // Moves to the next execution, false once all of them have been run
+        bool next() {
+            while (!this->stack.empty()) {
+                node &n = this->stack.back();
+                if (n.schedule) {
+                    if (n.next_session())
+                        return true;
+                } else if (!n.blocked && n.choice + 1 < n.count) {
+                    n.choice++;
+                    return true;
+                }
+                this->stack.pop_back();
+            }
+            return false;
+        }
+
+        /*
+         * Read choice among count alternatives, returns the index taken. Reads outside
+         * the sessions of run always take the last alternative.
+         */
+        size_t choose(size_t count) {
+            if (!this->in_session())
+                return count - 1;
+            if (this->depth < this->stack.size() && this->stack[this->depth].schedule)
+                this->stack.resize(this->depth);    // The program diverged from the recorded one
+            if (this->depth == this->stack.size()) {
+                node n;
+                n.schedule = false;
+                n.count = count;
+                n.blocked = this->redundant;
+                this->stack.push_back(n);
+            }
+            node &n = this->stack[this->depth++];
+            n.count = count;
+            return std::min(n.choice, count - 1);
+        }
+
+        // Records an access of the running step, keys are identified by hash
+        void on_access(size_t key_hash, bool write) {
+            if (!this->in_session())
+                return;
+            this->step.add(key_hash, write);
+        }
+
+        size_t get_execution_count() const {
+            return this->executions;
+        }
+
+    protected:
+        size_t pick(const std::vector<size_t> &enabled) {
+            this->current = (long) this->depth;
+            size_t session = this->schedule(enabled);
+            this->step.clear();
+            return session;
+        }
+
+        void after_step(size_t session) {
+            this->stack[this->current].explored_step(session, this->step);
+            this->previous = this->current;
+        }
+
+    private:
+        // Keys read and written by a step
+        struct footprint {
+            std::vector<size_t> reads, writes;
+
+            void add(size_t key_hash, bool write) {
+                std::vector<size_t> &keys = write ? this->writes : this->reads;
+                if (std::find(keys.begin(), keys.end(), key_hash) == keys.end())
+                    keys.push_back(key_hash);
+            }
+
+            void merge(const footprint &other) {
+                for (size_t key : other.reads)
+                    this->add(key, false);
+                for (size_t key : other.writes)
+                    this->add(key, true);
+            }
+
+            void clear() {
+                this->reads.clear();
+                this->writes.clear();
+            }
+
+            bool conflicts(const footprint &other) const {
+                for (size_t key : this->writes) {
+                    if (contains(other.reads, key) || contains(other.writes, key))
+                        return true;
+                }
+                for (size_t key : other.writes) {
+                    if (contains(this->reads, key))
+                        return true;
+                }
+                return false;
+            }
+
+            static bool contains(const std::vector<size_t> &keys, size_t key) {
+                return std::find(keys.begin(), keys.end(), key) != keys.end();
+            }
+        };
+
+        struct node {
+            bool schedule = false;
+            size_t choice = 0, count = 0;
+
+            // Schedule nodes only
+            std::vector<size_t> enabled;
+            std::vector<std::pair<size_t, footprint>> sleep;        // Sessions not to be scheduled
+            std::vector<std::pair<size_t, footprint>> explored;     // Sessions whose subtree is done or running
+
+            bool blocked = false;   // No alternatives: every enabled session was asleep, or
+                                    // the node lies in an execution already known to be redundant
+
+            bool is_asleep(size_t session) const {
+                for (auto &s : this->sleep) {
+                    if (s.first == session)
+                        return true;
+                }
+                for (auto &s : this->explored) {
+                    if (s.first == session)
+                        return true;
+                }
+                return false;
+            }
+
+            // Footprints of a session's first step are merged over all its executions
+            void explored_step(size_t session, const footprint &step) {
+                for (auto &s : this->explored) {
+                    if (s.first == session) {
+                        s.second.merge(step);
+                        return;
+                    }
+                }
+                this->explored.push_back({session, step});
+            }
+
+            bool next_session() {
+                if (this->blocked)
+                    return false;
+                for (size_t session : this->enabled) {
+                    if (!this->is_asleep(session)) {
+                        this->choice = session;
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        /*
+         * Picks the session of the step at the current depth. The sleep set of a new
+         * node is inherited from the previous schedule node: its asleep and explored
+         * sessions stay asleep unless the step just taken conflicts with them.
+         */
+        size_t schedule(const std::vector<size_t> &enabled) {
+            if (this->depth < this->stack.size() && !this->stack[this->depth].schedule)
+                this->stack.resize(this->depth);    // The program diverged from the recorded one
+            if (this->depth == this->stack.size()) {
+                node n;
+                n.schedule = true;
+                n.enabled = enabled;
+                if (this->previous >= 0) {
+                    const node &p = this->stack[this->previous];
+                    for (auto *set : {&p.sleep, &p.explored}) {
+                        for (auto &s : *set) {
+                            if (s.first != p.choice && !s.second.conflicts(this->step))
+                                n.sleep.push_back(s);
+                        }
+                    }
+                }
+                if (!n.next_session()) {
+                    // Every enabled session is asleep, the execution repeats an explored one
+                    n.choice = enabled.front();
+                    n.blocked = true;
+                }
+                n.blocked = n.blocked || this->redundant;
+                this->stack.push_back(n);
+            }
+            node &n = this->stack[this->depth++];
+            if (n.blocked)
+                this->redundant = true;
+            return n.choice;
+        }
+
+        std::vector<node> stack;        // Choices of the current execution
+        size_t depth = 0;               // Choices taken so far in the running execution
+        footprint step;                 // Accesses of the running step
+        bool redundant = false;
+        size_t executions = 0;
+        long current = -1;              // Index of the schedule node of the running step
+        long previous = -1;             // Index of the schedule node of the last step
+    };
+
+    /*
+     * Makes the read choices of an explorer among the versions admissible under an
+     * inner selector, and reports accesses to the explorer.
+     * Takes ownership of the inner selector.
+     */
+    template<typename K, typename V>
+    class exploring_read_response_selector : public read_response_selector<K, V> {
+    public:
+        exploring_read_response_selector(explorer *ex, read_response_selector<K, V> *inner) {
+            this->ex = ex;
+            this->inner = inner;
+        }
+
+        ~exploring_read_response_selector() {
+            delete this->inner;
+        }
+
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
+            this->store = store;
+            this->inner->init_consistency_checker(store);
+        }
+
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *op,
+                                    const candidate_view<K, V> &candidates) {
+            std::pair<size_t, size_t> range = this->inner->admissible_range(tx, op, candidates);
+            if (range.first > range.second || range.second >= candidates.size()) {
+                // No consistent transaction response possible
+                throw consistency_exception("GET", tx->get_tx_id());
+            }
+            return range.first + this->ex->choose(range.second - range.first + 1);
+        }
+
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *tx,
+                                                   const operation<K, V> *op,
+                                                   const candidate_view<K, V> &candidates) {
+            return this->inner->admissible_range(tx, op, candidates);
+        }
+
+        // Reported before the lookup, a read which finds nothing still conflicts with writes of the key
+        void before_read(const transaction<K, V> *tx, const K &key) {
+            this->ex->on_access(std::hash<K>()(key), false);
+            this->inner->before_read(tx, key);
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            this->inner->on_read(tx);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            for (size_t i = 0; i < tx->get_operation_count(); i++) {
+                const operation<K, V> *op = tx->get_operation(i);
+                if (op->get_kind() != op_kind::GET && op->get_response() != nullptr)
+                    this->ex->on_access(std::hash<K>()(op->get_params()->get_key()), true);
+            }
+            this->inner->on_commit(tx);
+        }
+
+        bool is_superseded(const K &key, size_t version_number) {
+            return this->inner->is_superseded(key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            this->inner->register_sessions(session_ids);
+        }
+
+        bool serializes_transactions() const {
+            return this->inner->serializes_transactions();
+        }
+
+        void set_instrumentation(instrumentation *metrics) {
+            this->metrics = metrics;
+            this->inner->set_instrumentation(metrics);
+        }
+
+    private:
+        explorer *ex;
+        read_response_selector<K, V> *inner;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_EXPLORER_H
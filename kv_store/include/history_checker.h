@@ -0,0 +1,609 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Checks recorded histories against isolation levels after the fact.
+
+#ifndef MOCK_KEY_VALUE_STORE_HISTORY_CHECKER_H
+#define MOCK_KEY_VALUE_STORE_HISTORY_CHECKER_H
+
+#include "history_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Verifies a whole history, as recorded by kv_store or read back from a file,
+     * against causal consistency, snapshot isolation and serializability. The
+     * version order of every key is the order of its version numbers, which is the
+     * commit order of the store.
+     *
+     * The history is turned into a dependency graph over transactions:
+     *   so  session order, between consecutive transactions of a session
+     *   wr  from the writer of a version to every transaction which read it
+     *   ww  from the writer of a version to the writer of the next one
+     *   rw  from every reader of a version to the writer of the next one
+     * Rows are partitioned by key and the wr, ww and rw edges of the keys are built
+     * by several threads, so are the summaries of the writes of each key the reads
+     * are checked against. Cycles are searched for in one pass over the whole graph.
+     *
+     * Reads a transaction makes of its own writes aren't in the history and aren't
+     * checked. A read from a transaction which isn't in the history, or of a version
+     * its writer didn't write, is a violation of every level.
+     */
+    template <typename K, typename V>
+    class history_checker {
+    public:
+        enum class dependency : uint8_t { SESSION, WRITE_READ, WRITE_WRITE, READ_WRITE };
+
+        // 0 workers for one per core
+        history_checker(const history_log<K, V> &history, int workers = 0) : history(history) {
+            if (workers <= 0)
+                workers = (int) std::thread::hardware_concurrency();
+            this->workers = workers < 1 ? 1 : workers;
+            this->build();
+        }
+
+        /*
+         * so and wr are acyclic, and no transaction reads a version older than one
+         * written by a transaction in its causal past, (so ∪ wr)+.
+         */
+        bool check_causal() {
+            this->clear_violation();
+            if (!this->malformed.empty())
+                return this->fail(this->malformed, this->malformed_txs);
+            if (!this->find_cycle({dependency::SESSION, dependency::WRITE_READ}, false))
+                return false;
+
+            std::vector<key_writes> keys(this->history.get_key_count());
+            this->parallel_for(keys.size(), [&](size_t key_id) {
+                this->summarize_writes(key_id, keys[key_id]);
+            });
+            return this->check_causal_pasts(keys);
+        }
+
+        /*
+         * No cycle in (so ∪ wr ∪ ww) ; rw? (Cerone and Gotsman), every cycle of the
+         * dependency graph has two rw edges in a row. Write skew passes, lost updates
+         * and non-repeatable reads don't.
+         */
+        bool check_snapshot_isolation() {
+            this->clear_violation();
+            if (!this->malformed.empty())
+                return this->fail(this->malformed, this->malformed_txs);
+            return this->find_cycle({dependency::SESSION, dependency::WRITE_READ, dependency::WRITE_WRITE,
+                                     dependency::READ_WRITE}, true);
+        }
+
+        // No cycle in so ∪ wr ∪ ww ∪ rw
+        bool check_serializability() {
+            this->clear_violation();
+            if (!this->malformed.empty())
+                return this->fail(this->malformed, this->malformed_txs);
+            return this->find_cycle({dependency::SESSION, dependency::WRITE_READ, dependency::WRITE_WRITE,
+                                     dependency::READ_WRITE}, false);
+        }
+
+        // Description of the violation found by the last check, empty if it passed
+        const std::string &get_violation() const {
+            return this->violation;
+        }
+
+        // Transactions of the violation found by the last check, the cycle in order if there is one
+        const std::vector<long> &get_violating_txs() const {
+            return this->violating_txs;
+        }
+
+        size_t get_tx_count() const {
+            return this->tx_ids.size();
+        }
+
+        size_t get_edge_count() const {
+            return this->edges.size();
+        }
+
+    private:
+        struct edge {
+            size_t from;
+            size_t to;
+            dependency kind;
+        };
+
+        // Successors of every node, with the dependency of each edge
+        struct graph {
+            std::vector<size_t> first;      // node -> index of its first successor, one past the end for the last
+            std::vector<size_t> successors;
+            std::vector<dependency> kinds;
+        };
+
+        /*
+         * Vector clock holding only the sessions in the causal past: (dense session
+         * index, number of its transactions in the past), by session index.
+         */
+        typedef std::vector<std::pair<uint32_t, uint32_t>> sparse_clock;
+
+        // Transactions of one session which wrote a key
+        struct session_writes {
+            size_t session;
+            std::vector<size_t> positions;      // Positions in the session, ascending
+            std::vector<size_t> newest;         // Newest version among the first i + 1 of them
+            std::vector<size_t> txs;            // The transactions, by position
+        };
+
+        // Writes of a key, and its sessions which wrote it by session index
+        struct key_writes {
+            std::vector<size_t> writers;
+            std::unordered_map<size_t, size_t> written;
+            std::unordered_map<long, size_t> tx_indices;
+            std::vector<session_writes> sessions;
+        };
+
+        const history_log<K, V> &history;
+        int workers;
+
+        // Transactions, by dense index in order of their first row
+        std::vector<long> tx_ids;
+        std::vector<long> tx_sessions;
+        std::vector<size_t> session_positions;      // Index of the transaction in its session
+        std::vector<size_t> session_indices;        // Dense index of the session of the transaction
+        std::vector<size_t> tx_of_row;
+        std::vector<std::vector<size_t>> sessions;  // Transactions of each session in session order, by session id
+
+        std::vector<std::vector<size_t>> rows_by_key;
+        std::vector<edge> edges;
+
+        std::string malformed;                  // Reads the history can't explain
+        std::vector<size_t> malformed_txs;
+
+        std::string violation;
+        std::vector<long> violating_txs;
+
+        void build() {
+            std::unordered_map<long, size_t> tx_indices;
+            std::map<long, std::vector<size_t>> by_session;
+            this->tx_of_row.resize(this->history.size());
+            this->rows_by_key.resize(this->history.get_key_count());
+            for (auto row : this->history) {
+                auto inserted = tx_indices.emplace(row.get_tx_id(), this->tx_ids.size());
+                if (inserted.second) {
+                    this->tx_ids.push_back(row.get_tx_id());
+                    this->tx_sessions.push_back(row.get_session_id());
+                    by_session[row.get_session_id()].push_back(inserted.first->second);
+                }
+                this->tx_of_row[row.get_index()] = inserted.first->second;
+                this->rows_by_key[row.get_key_id()].push_back(row.get_index());
+            }
+
+            this->session_positions.resize(this->tx_ids.size());
+            this->session_indices.resize(this->tx_ids.size());
+            for (auto &session : by_session) {
+                for (size_t i = 0; i < session.second.size(); i++) {
+                    this->session_positions[session.second[i]] = i;
+                    this->session_indices[session.second[i]] = this->sessions.size();
+                    if (i > 0)
+                        this->edges.push_back({session.second[i - 1], session.second[i], dependency::SESSION});
+                }
+                this->sessions.push_back(std::move(session.second));
+            }
+
+            // Edges of every key, then in key order so the graph doesn't depend on the number of workers
+            std::vector<std::vector<edge>> key_edges(this->rows_by_key.size());
+            std::vector<std::string> errors(this->rows_by_key.size());
+            std::vector<std::vector<size_t>> error_txs(this->rows_by_key.size());
+            this->parallel_for(key_edges.size(), [&](size_t key_id) {
+                this->build_key(key_id, tx_indices, key_edges[key_id], errors[key_id], error_txs[key_id]);
+            });
+            for (size_t key_id = 0; key_id < key_edges.size(); key_id++) {
+                this->edges.insert(this->edges.end(), key_edges[key_id].begin(), key_edges[key_id].end());
+                if (this->malformed.empty() && !errors[key_id].empty()) {
+                    this->malformed = errors[key_id];
+                    this->malformed_txs = error_txs[key_id];
+                }
+            }
+        }
+
+        // Writers of the key's versions, by version number, and the version every transaction wrote
+        void writers_of(size_t key_id, std::vector<size_t> &writers,
+                        std::unordered_map<size_t, size_t> &written) const {
+            const size_t none = (size_t) -1;
+            for (size_t row : this->rows_by_key[key_id]) {
+                auto entry = this->history[row];
+                if (entry.get_kind() == op_kind::GET || entry.get_version_number() == 0)
+                    continue;
+                if (entry.get_version_number() >= writers.size())
+                    writers.resize(entry.get_version_number() + 1, none);
+                writers[entry.get_version_number()] = this->tx_of_row[row];
+                written[this->tx_of_row[row]] = entry.get_version_number();
+            }
+        }
+
+        /*
+         * Version read by a row, 0 for the initial state of the key. A REMOVE records
+         * the version it wrote, the one it read is the version its writer wrote.
+         * Returns false if the history doesn't hold the version.
+         */
+        bool version_read(const typename history_log<K, V>::entry &entry,
+                          const std::unordered_map<long, size_t> &tx_indices,
+                          const std::vector<size_t> &writers,
+                          const std::unordered_map<size_t, size_t> &written,
+                          size_t &version_number) const {
+            if (entry.get_reads_from() == 0 && (entry.get_kind() != op_kind::GET || entry.get_version_number() == 0)) {
+                version_number = 0;
+                return true;
+            }
+            auto writer = tx_indices.find(entry.get_reads_from());
+            if (writer == tx_indices.end())
+                return false;
+            if (entry.get_kind() != op_kind::GET) {
+                auto it = written.find(writer->second);
+                if (it == written.end())
+                    return false;
+                version_number = it->second;
+                return true;
+            }
+            version_number = entry.get_version_number();
+            return version_number < writers.size() && writers[version_number] == writer->second;
+        }
+
+        void build_key(size_t key_id, const std::unordered_map<long, size_t> &tx_indices,
+                       std::vector<edge> &out, std::string &error, std::vector<size_t> &error_txs) const {
+            const size_t none = (size_t) -1;
+            std::vector<size_t> writers(1, none);
+            std::unordered_map<size_t, size_t> written;
+            this->writers_of(key_id, writers, written);
+
+            for (size_t v = 2; v < writers.size(); v++) {
+                if (writers[v - 1] != none && writers[v] != none && writers[v - 1] != writers[v])
+                    out.push_back({writers[v - 1], writers[v], dependency::WRITE_WRITE});
+            }
+
+            for (size_t row : this->rows_by_key[key_id]) {
+                auto entry = this->history[row];
+                size_t reader = this->tx_of_row[row];
+                if (entry.get_reads_from() == this->tx_ids[reader] ||
+                    (entry.get_kind() != op_kind::GET && entry.get_reads_from() == 0))
+                    continue;
+                size_t version_number;
+                if (!this->version_read(entry, tx_indices, writers, written, version_number)) {
+                    if (error.empty()) {
+                        std::stringstream ss;
+                        ss << "transaction " << this->tx_ids[reader] << " reads " << this->history.get_key(key_id)
+                           << " from transaction " << entry.get_reads_from() << " which didn't write it";
+                        error = ss.str();
+                        error_txs = {reader};
+                    }
+                    continue;
+                }
+                if (version_number > 0 && writers[version_number] != reader)
+                    out.push_back({writers[version_number], reader, dependency::WRITE_READ});
+                // The next version overwrites the one read
+                size_t next = version_number + 1;
+                while (next < writers.size() && writers[next] == none)
+                    next++;
+                if (next < writers.size() && writers[next] != reader)
+                    out.push_back({reader, writers[next], dependency::READ_WRITE});
+            }
+        }
+
+        /*
+         * Graph of the edges of the given kinds. With split, every transaction t has
+         * a second node t' = t + n: so, wr and ww edges a -> b give a -> b and
+         * a -> b', rw edges b -> c give b' -> c, so that a cycle is a cycle of the
+         * dependency graph in which no two rw edges are adjacent.
+         */
+        graph make_graph(const std::vector<dependency> &kinds, bool split) const {
+            size_t n = this->tx_ids.size();
+            std::vector<edge> selected;
+            for (const edge &e : this->edges) {
+                if (std::find(kinds.begin(), kinds.end(), e.kind) == kinds.end())
+                    continue;
+                if (!split) {
+                    selected.push_back(e);
+                } else if (e.kind == dependency::READ_WRITE) {
+                    selected.push_back({e.from + n, e.to, e.kind});
+                } else {
+                    selected.push_back(e);
+                    selected.push_back({e.from, e.to + n, e.kind});
+                }
+            }
+
+            graph g;
+            size_t nodes = split ? 2 * n : n;
+            g.first.assign(nodes + 1, 0);
+            for (const edge &e : selected)
+                g.first[e.from + 1]++;
+            for (size_t i = 0; i < nodes; i++)
+                g.first[i + 1] += g.first[i];
+            g.successors.resize(selected.size());
+            g.kinds.resize(selected.size());
+            std::vector<size_t> next(g.first.begin(), g.first.end() - 1);
+            for (const edge &e : selected) {
+                g.successors[next[e.from]] = e.to;
+                g.kinds[next[e.from]++] = e.kind;
+            }
+            return g;
+        }
+
+        // Depth-first search of the graph of the given kinds, returns false and sets the violation on a cycle
+        bool find_cycle(const std::vector<dependency> &kinds, bool split) {
+            graph g = this->make_graph(kinds, split);
+            size_t nodes = g.first.size() - 1;
+            enum : uint8_t { WHITE, GRAY, BLACK };
+            std::vector<uint8_t> color(nodes, WHITE);
+            std::vector<std::pair<size_t, size_t>> stack;     // node, next successor index
+
+            for (size_t root = 0; root < nodes; root++) {
+                if (color[root] != WHITE)
+                    continue;
+                color[root] = GRAY;
+                stack.push_back({root, g.first[root]});
+                while (!stack.empty()) {
+                    size_t node = stack.back().first;
+                    size_t &it = stack.back().second;
+                    if (it == g.first[node + 1]) {
+                        color[node] = BLACK;
+                        stack.pop_back();
+                        continue;
+                    }
+                    size_t edge_index = it++;
+                    size_t successor = g.successors[edge_index];
+                    if (color[successor] == WHITE) {
+                        color[successor] = GRAY;
+                        stack.push_back({successor, g.first[successor]});
+                    } else if (color[successor] == GRAY) {
+                        this->describe_cycle(g, stack, successor, edge_index);
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // The cycle is the part of the stack from node on, closed by the edge at edge_index
+        void describe_cycle(const graph &g, const std::vector<std::pair<size_t, size_t>> &stack,
+                            size_t node, size_t edge_index) {
+            size_t n = this->tx_ids.size();
+            size_t start = 0;
+            while (stack[start].first != node)
+                start++;
+
+            std::stringstream ss;
+            ss << "cycle";
+            std::vector<size_t> txs;
+            for (size_t i = start; i < stack.size(); i++) {
+                // The successor index was moved past the edge taken to the next node
+                size_t taken = i + 1 < stack.size() ? stack[i].second - 1 : edge_index;
+                size_t tx = stack[i].first % n;
+                txs.push_back(tx);
+                ss << " " << this->tx_ids[tx] << " -" << name(g.kinds[taken]) << "->";
+            }
+            ss << " " << this->tx_ids[node % n];
+            this->fail(ss.str(), txs);
+        }
+
+        static const char *name(dependency kind) {
+            switch (kind) {
+                case dependency::SESSION:
+                    return "so";
+                case dependency::WRITE_READ:
+                    return "wr";
+                case dependency::WRITE_WRITE:
+                    return "ww";
+                default:
+                    return "rw";
+            }
+        }
+
+        void summarize_writes(size_t key_id, key_writes &out) const {
+            const size_t none = (size_t) -1;
+            out.writers.assign(1, none);
+            this->writers_of(key_id, out.writers, out.written);
+
+            std::map<size_t, std::vector<size_t>> by_session;
+            for (size_t v = 1; v < out.writers.size(); v++) {
+                if (out.writers[v] == none)
+                    continue;
+                out.tx_indices[this->tx_ids[out.writers[v]]] = out.writers[v];
+                by_session[this->session_indices[out.writers[v]]].push_back(this->session_positions[out.writers[v]]);
+            }
+            for (auto &entry : by_session) {
+                session_writes writes;
+                writes.session = entry.first;
+                writes.positions = std::move(entry.second);
+                // A transaction writes a key once, versions of one session are written in session order
+                std::sort(writes.positions.begin(), writes.positions.end());
+                for (size_t position : writes.positions) {
+                    size_t tx = this->sessions[entry.first][position];
+                    size_t version_number = out.written.at(tx);
+                    writes.newest.push_back(writes.newest.empty() ? version_number
+                                                                  : std::max(writes.newest.back(), version_number));
+                    writes.txs.push_back(tx);
+                }
+                out.sessions.push_back(std::move(writes));
+            }
+        }
+
+        // Transactions of the session in the causal past of a clock
+        static size_t clock_entry(const sparse_clock &clock, size_t session) {
+            auto it = std::lower_bound(clock.begin(), clock.end(), std::pair<uint32_t, uint32_t>((uint32_t) session, 0));
+            return it != clock.end() && it->first == session ? it->second : 0;
+        }
+
+        // into becomes the entrywise maximum of both clocks
+        static void merge_clock(sparse_clock &into, const sparse_clock &from) {
+            sparse_clock merged;
+            merged.reserve(std::max(into.size(), from.size()));
+            auto a = into.cbegin();
+            auto b = from.cbegin();
+            while (a != into.cend() || b != from.cend()) {
+                if (b == from.end() || (a != into.end() && a->first < b->first)) {
+                    merged.push_back(*a++);
+                } else if (a == into.end() || b->first < a->first) {
+                    merged.push_back(*b++);
+                } else {
+                    merged.push_back({a->first, std::max(a->second, b->second)});
+                    a++;
+                    b++;
+                }
+            }
+            into.swap(merged);
+        }
+
+        /*
+         * Visits so ∪ wr in topological order with a sparse vector clock per
+         * transaction, checking the reads of each transaction against the writes of
+         * its causal past once its clock is complete. A clock is freed once merged
+         * into the successors, so only those of transactions with a visited
+         * predecessor but not visited themselves are held. The graph must be acyclic.
+         */
+        bool check_causal_pasts(const std::vector<key_writes> &keys) {
+            size_t n = this->tx_ids.size();
+            graph g = this->make_graph({dependency::SESSION, dependency::WRITE_READ}, false);
+            std::vector<size_t> in_degree(n, 0);
+            for (size_t successor : g.successors)
+                in_degree[successor]++;
+            std::vector<size_t> ready;
+            for (size_t tx = 0; tx < n; tx++) {
+                if (in_degree[tx] == 0)
+                    ready.push_back(tx);
+            }
+
+            // Rows of every transaction
+            std::vector<size_t> first_row(n + 1, 0), rows(this->history.size());
+            for (size_t row = 0; row < rows.size(); row++)
+                first_row[this->tx_of_row[row] + 1]++;
+            for (size_t tx = 0; tx < n; tx++)
+                first_row[tx + 1] += first_row[tx];
+            std::vector<size_t> next_row(first_row.begin(), first_row.end() - 1);
+            for (size_t row = 0; row < rows.size(); row++)
+                rows[next_row[this->tx_of_row[row]]++] = row;
+
+            std::vector<sparse_clock> clocks(n);
+            while (!ready.empty()) {
+                size_t tx = ready.back();
+                ready.pop_back();
+                sparse_clock clock;
+                clock.swap(clocks[tx]);
+                merge_clock(clock, {{(uint32_t) this->session_indices[tx], (uint32_t) this->session_positions[tx] + 1}});
+
+                for (size_t i = first_row[tx]; i < first_row[tx + 1]; i++) {
+                    if (!this->check_causal_read(rows[i], tx, clock, keys[this->history[rows[i]].get_key_id()]))
+                        return false;
+                }
+                for (size_t i = g.first[tx]; i < g.first[tx + 1]; i++) {
+                    size_t successor = g.successors[i];
+                    merge_clock(clocks[successor], clock);
+                    if (--in_degree[successor] == 0)
+                        ready.push_back(successor);
+                }
+            }
+            return true;
+        }
+
+        /*
+         * A read is stale if the newest version of the key written in the causal past
+         * of the reader is newer than the version read. The newest version of each
+         * session which wrote the key is found by the reader's entry for it, among
+         * the positions of its writes.
+         */
+        bool check_causal_read(size_t row, size_t reader, const sparse_clock &clock, const key_writes &key) {
+            auto entry = this->history[row];
+            if (entry.get_reads_from() == this->tx_ids[reader] ||
+                (entry.get_kind() != op_kind::GET && entry.get_reads_from() == 0))
+                return true;
+            size_t version_number = 0;
+            this->version_read(entry, key.tx_indices, key.writers, key.written, version_number);
+
+            // Sessions both in the causal past and among the writers of the key, looked up from the fewer
+            auto check = [&](const session_writes &writes, size_t past) {
+                // The reader itself isn't in its causal past
+                if (writes.session == this->session_indices[reader])
+                    past--;
+                size_t count = std::lower_bound(writes.positions.begin(), writes.positions.end(), past) -
+                               writes.positions.begin();
+                if (count == 0 || writes.newest[count - 1] <= version_number)
+                    return true;
+                size_t overwriter = 0;
+                for (size_t i = 0; i < count; i++) {
+                    if (key.written.at(writes.txs[i]) == writes.newest[count - 1])
+                        overwriter = writes.txs[i];
+                }
+                std::stringstream ss;
+                ss << "transaction " << this->tx_ids[reader] << " reads version " << version_number << " of "
+                   << entry.get_key() << " after version " << writes.newest[count - 1]
+                   << " written by transaction " << this->tx_ids[overwriter] << " in its causal past";
+                return this->fail(ss.str(), {overwriter, reader});
+            };
+            if (key.sessions.size() <= clock.size()) {
+                for (const session_writes &writes : key.sessions) {
+                    size_t past = clock_entry(clock, writes.session);
+                    if (past > 0 && !check(writes, past))
+                        return false;
+                }
+            } else {
+                for (auto &past : clock) {
+                    auto writes = std::lower_bound(key.sessions.begin(), key.sessions.end(), (size_t) past.first,
+                                                   [](const session_writes &w, size_t session) {
+                                                       return w.session < session;
+                                                   });
+                    if (writes != key.sessions.end() && writes->session == past.first && !check(*writes, past.second))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        // Rethrows the first exception of the workers, e.g. std::bad_alloc, once all are done
+        void parallel_for(size_t count, const std::function<void(size_t)> &work) {
+            std::atomic<size_t> next(0);
+            std::mutex error_mtx;
+            std::exception_ptr error;
+            auto run = [&] {
+                try {
+                    for (size_t i = next++; i < count; i = next++)
+                        work(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lck(error_mtx);
+                    if (!error)
+                        error = std::current_exception();
+                    next = count;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (int w = 1; w < this->workers && (size_t) w < count; w++)
+                threads.push_back(std::thread(run));
+            run();
+            for (auto &t : threads)
+                t.join();
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        void clear_violation() {
+            this->violation.clear();
+            this->violating_txs.clear();
+        }
+
+        bool fail(const std::string &description, const std::vector<size_t> &txs) {
+            this->violation = description;
+            this->violating_txs.clear();
+            for (size_t tx : txs)
+                this->violating_txs.push_back(this->tx_ids[tx]);
+            return false;
+        }
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_HISTORY_CHECKER_H
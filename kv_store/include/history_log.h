@@ -0,0 +1,293 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Append-only log of committed operations.
+
+#ifndef MOCK_KEY_VALUE_STORE_HISTORY_LOG_H
+#define MOCK_KEY_VALUE_STORE_HISTORY_LOG_H
+
+#include "operation.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * History stored column by column, one row per committed operation in commit
+     * order. Row indices never change. Keys are interned, values are referenced by
+     * their version number in the key's chain.
+     * Reading while another thread appends is not safe, the store appends under its
+     * history lock.
+     */
+    template <typename K, typename V>
+    class history_log {
+    public:
+        // Read-only view of one row
+        class entry {
+        public:
+            entry(const history_log *log, size_t index) : log(log), index(index) {
+            }
+
+            size_t get_index() const {
+                return index;
+            }
+
+            long get_tx_id() const {
+                return log->tx_ids[index];
+            }
+
+            long get_session_id() const {
+                return log->session_ids[index];
+            }
+
+            op_kind get_kind() const {
+                return log->kinds[index];
+            }
+
+            size_t get_key_id() const {
+                return log->key_ids[index];
+            }
+
+            const K &get_key() const {
+                return log->keys[log->key_ids[index]];
+            }
+
+            // Version written by PUT, or version returned by GET
+            size_t get_version_number() const {
+                return log->version_numbers[index];
+            }
+
+            // Transaction which wrote the version read by GET, 0 for writes
+            long get_reads_from() const {
+                return log->reads_from[index];
+            }
+
+        private:
+            const history_log *log;
+            size_t index;
+        };
+
+        // Iterates over rows given by a sequence of indices
+        template <typename index_iterator>
+        class entry_iterator {
+        public:
+            entry_iterator(const history_log *log, index_iterator it) : log(log), it(it) {
+            }
+
+            entry operator*() const {
+                return entry(log, *it);
+            }
+
+            entry_iterator &operator++() {
+                ++it;
+                return *this;
+            }
+
+            bool operator==(const entry_iterator &other) const {
+                return it == other.it;
+            }
+
+            bool operator!=(const entry_iterator &other) const {
+                return it != other.it;
+            }
+
+        private:
+            const history_log *log;
+            index_iterator it;
+        };
+
+        // Counts up the row indices of the whole log
+        class index_counter {
+        public:
+            index_counter(size_t index) : index(index) {
+            }
+
+            size_t operator*() const {
+                return index;
+            }
+
+            index_counter &operator++() {
+                ++index;
+                return *this;
+            }
+
+            bool operator==(const index_counter &other) const {
+                return index == other.index;
+            }
+
+            bool operator!=(const index_counter &other) const {
+                return index != other.index;
+            }
+
+        private:
+            size_t index;
+        };
+
+        typedef entry_iterator<index_counter> const_iterator;
+        typedef entry_iterator<std::vector<size_t>::const_iterator> session_iterator;
+
+        // Rows of one session in session order
+        class session_view {
+        public:
+            session_view(const history_log *log, const std::vector<size_t> *indices) : log(log), indices(indices) {
+            }
+
+            size_t size() const {
+                return indices == nullptr ? 0 : indices->size();
+            }
+
+            bool empty() const {
+                return size() == 0;
+            }
+
+            entry operator[](size_t i) const {
+                return entry(log, (*indices)[i]);
+            }
+
+            session_iterator begin() const {
+                return indices == nullptr ? session_iterator(log, empty_indices().end())
+                                          : session_iterator(log, indices->begin());
+            }
+
+            session_iterator end() const {
+                return indices == nullptr ? session_iterator(log, empty_indices().end())
+                                          : session_iterator(log, indices->end());
+            }
+
+        private:
+            static const std::vector<size_t> &empty_indices() {
+                static const std::vector<size_t> none;
+                return none;
+            }
+
+            const history_log *log;
+            const std::vector<size_t> *indices;
+        };
+
+        // Appends a row and returns its index
+        size_t append(long tx_id, long session_id, op_kind kind, const K &key,
+                      size_t version_number, long reads_from) {
+            size_t index = this->tx_ids.size();
+            this->tx_ids.push_back(tx_id);
+            this->session_ids.push_back(session_id);
+            this->kinds.push_back(kind);
+            this->key_ids.push_back(intern(key));
+            this->version_numbers.push_back(version_number);
+            this->reads_from.push_back(reads_from);
+            this->sessions[session_id].push_back(index);
+            return index;
+        }
+
+        size_t size() const {
+            return this->tx_ids.size();
+        }
+
+        bool empty() const {
+            return this->tx_ids.empty();
+        }
+
+        entry operator[](size_t index) const {
+            return entry(this, index);
+        }
+
+        const_iterator begin() const {
+            return const_iterator(this, index_counter(0));
+        }
+
+        const_iterator end() const {
+            return const_iterator(this, index_counter(size()));
+        }
+
+        session_view get_session(long session_id) const {
+            auto it = this->sessions.find(session_id);
+            return session_view(this, it == this->sessions.end() ? nullptr : &it->second);
+        }
+
+        size_t get_key_count() const {
+            return this->keys.size();
+        }
+
+        const K &get_key(size_t key_id) const {
+            return this->keys[key_id];
+        }
+
+        /*
+         * Text format, a header line then one line per row in order:
+         *   mockdb-history 1
+         *   <tx id> <session id> <G, P or R> <version number> <reads from> <key>
+         * The key takes the rest of the line, it must not contain a line break.
+         */
+        void write(std::ostream &out) const {
+            out << "mockdb-history 1\n";
+            for (size_t i = 0; i < size(); i++) {
+                char kind = this->kinds[i] == op_kind::GET ? 'G' : this->kinds[i] == op_kind::PUT ? 'P' : 'R';
+                out << this->tx_ids[i] << " " << this->session_ids[i] << " " << kind << " "
+                    << this->version_numbers[i] << " " << this->reads_from[i] << " "
+                    << this->keys[this->key_ids[i]] << "\n";
+            }
+        }
+
+        // Appends the rows written by write. Throws std::runtime_error if in doesn't hold a history.
+        void read(std::istream &in) {
+            std::string line;
+            if (!std::getline(in, line) || line != "mockdb-history 1")
+                throw std::runtime_error("Not a history");
+            size_t row = 0;
+            while (std::getline(in, line)) {
+                row++;
+                if (line.empty())
+                    continue;
+                std::istringstream fields(line);
+                long tx_id, session_id, reads_from;
+                char kind;
+                size_t version_number;
+                if (!(fields >> tx_id >> session_id >> kind >> version_number >> reads_from) ||
+                    (kind != 'G' && kind != 'P' && kind != 'R') || fields.get() != ' ')
+                    throw std::runtime_error("History: bad row " + std::to_string(row));
+                K key;
+                read_key(fields, key);
+                append(tx_id, session_id, kind == 'G' ? op_kind::GET : kind == 'P' ? op_kind::PUT : op_kind::REMOVE,
+                       key, version_number, reads_from);
+            }
+        }
+
+    private:
+        static void read_key(std::istream &in, std::string &key) {
+            std::getline(in, key);
+        }
+
+        template <typename T>
+        static void read_key(std::istream &in, T &key) {
+            in >> key;
+        }
+
+        size_t intern(const K &key) {
+            auto it = this->key_ids_by_key.find(key);
+            if (it != this->key_ids_by_key.end())
+                return it->second;
+            this->keys.push_back(key);
+            this->key_ids_by_key.emplace(key, this->keys.size() - 1);
+            return this->keys.size() - 1;
+        }
+
+        // Columns
+        std::vector<long> tx_ids;
+        std::vector<long> session_ids;
+        std::vector<op_kind> kinds;
+        std::vector<size_t> key_ids;
+        std::vector<size_t> version_numbers;
+        std::vector<long> reads_from;
+
+        std::unordered_map<long, std::vector<size_t>> sessions;    // session id -> row indices
+        std::vector<K> keys;                                        // key id -> key
+        std::unordered_map<K, size_t> key_ids_by_key;
+    };
+}
+#endif //MOCK_KEY_VALUE_STORE_HISTORY_LOG_H
@@ -0,0 +1,277 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Opt-in latency histograms and counters of the store and its selector.
+
+#ifndef MOCK_KEY_VALUE_STORE_INSTRUMENTATION_H
+#define MOCK_KEY_VALUE_STORE_INSTRUMENTATION_H
+
+#include "trace_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace mockdb {
+    // Counts of a latency_histogram at one point in time
+    struct histogram_snapshot {
+        std::vector<uint64_t> counts;   // By bucket
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+
+        double mean() const {
+            return this->count == 0 ? 0 : (double) this->sum / this->count;
+        }
+
+        // Highest value equivalent to the one at percentile p (0 to 100), 0 if empty
+        uint64_t value_at_percentile(double p) const;
+    };
+
+    /*
+     * HDR-style histogram of non-negative values: exact below 32, above that 16
+     * buckets per power of two, so a value is known within 1/16 of itself. Recording
+     * is lock-free and wait-free apart from min and max.
+     */
+    class latency_histogram {
+    public:
+        static const size_t bucket_count = 32 + 59 * 16;
+
+        void record(uint64_t value) {
+            this->counts[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+            this->count.fetch_add(1, std::memory_order_relaxed);
+            this->sum.fetch_add(value, std::memory_order_relaxed);
+            uint64_t current = this->min.load(std::memory_order_relaxed);
+            while (value < current && !this->min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+            }
+            current = this->max.load(std::memory_order_relaxed);
+            while (value > current && !this->max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        // Values recorded concurrently may be partly counted
+        histogram_snapshot get_snapshot() const {
+            histogram_snapshot s;
+            s.counts = std::vector<uint64_t>(bucket_count);
+            for (size_t i = 0; i < bucket_count; i++)
+                s.counts[i] = this->counts[i].load(std::memory_order_relaxed);
+            s.count = this->count.load(std::memory_order_relaxed);
+            s.sum = this->sum.load(std::memory_order_relaxed);
+            s.min = s.count == 0 ? 0 : this->min.load(std::memory_order_relaxed);
+            s.max = this->max.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        static size_t bucket_of(uint64_t value) {
+            if (value < 32)
+                return (size_t) value;
+            unsigned shift = highest_bit(value) - 4;
+            return 32 + (shift - 1) * 16 + (size_t) ((value >> shift) - 16);
+        }
+
+        // Largest value counted in the bucket
+        static uint64_t highest_in_bucket(size_t bucket) {
+            if (bucket < 32)
+                return bucket;
+            unsigned shift = (unsigned) (bucket - 32) / 16 + 1;
+            uint64_t mantissa = (bucket - 32) % 16 + 16;
+            return ((mantissa + 1) << shift) - 1;
+        }
+
+    private:
+        std::atomic<uint64_t> counts[bucket_count] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> min{UINT64_MAX};
+        std::atomic<uint64_t> max{0};
+
+        static unsigned highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+            return 63 - (unsigned) __builtin_clzll(value);
+#else
+            unsigned bit = 0;
+            while (value >>= 1)
+                bit++;
+            return bit;
+#endif
+        }
+    };
+
+    inline uint64_t histogram_snapshot::value_at_percentile(double p) const {
+        if (this->count == 0)
+            return 0;
+        uint64_t rank = (uint64_t) std::ceil(std::min(std::max(p, 0.0), 100.0) / 100 * this->count);
+        rank = std::max(rank, (uint64_t) 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < this->counts.size(); i++) {
+            seen += this->counts[i];
+            if (seen >= rank)
+                return std::min(latency_histogram::highest_in_bucket(i), this->max);
+        }
+        return this->max;
+    }
+
+    // All measurements of a store at one point in time
+    struct instrumentation_snapshot {
+        histogram_snapshot get, put, remove, multi_get, multi_put, begin, commit;
+        histogram_snapshot lock_wait, lock_hold, select, candidates;
+        uint64_t checker_invocations = 0;
+        uint64_t checker_rejections = 0;
+
+        // One line per histogram with count, mean, percentiles and max; latencies in ns
+        void write(std::ostream &out) const {
+            out << std::left << std::setw(12) << "metric" << std::right << std::setw(10) << "count"
+                << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+                << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max" << "\n";
+            const std::pair<const char *, const histogram_snapshot *> rows[] = {
+                    {"get", &get}, {"put", &put}, {"remove", &remove}, {"multi_get", &multi_get},
+                    {"multi_put", &multi_put}, {"begin", &begin}, {"commit", &commit},
+                    {"lock_wait", &lock_wait}, {"lock_hold", &lock_hold}, {"select", &select},
+                    {"candidates", &candidates}};
+            for (const auto &row : rows) {
+                const histogram_snapshot &h = *row.second;
+                if (h.count == 0)
+                    continue;
+                out << std::left << std::setw(12) << row.first << std::right << std::setw(10) << h.count
+                    << std::setw(10) << std::fixed << std::setprecision(0) << h.mean()
+                    << std::setw(10) << h.value_at_percentile(50) << std::setw(10) << h.value_at_percentile(90)
+                    << std::setw(10) << h.value_at_percentile(99) << std::setw(10) << h.value_at_percentile(99.9)
+                    << std::setw(12) << h.max << "\n";
+            }
+            out << "checker invocations " << checker_invocations << ", rejections " << checker_rejections << "\n";
+        }
+    };
+
+    /*
+     * Measurements of a store and its selector, enabled by handing one to
+     * kv_store::set_instrumentation. Without it the store only tests a null pointer
+     * per measurement point and never reads the clock.
+     */
+    class instrumentation {
+    public:
+        // Operations of the store in nanoseconds, from call to return
+        latency_histogram get, put, remove, multi_get, multi_put, begin, commit;
+        // Stripe locks: time waited to acquire, time held
+        latency_histogram lock_wait, lock_hold;
+        // select_read_response of the selector, under the stripe lock
+        latency_histogram select;
+        // Candidate versions per read, a count rather than a latency
+        latency_histogram candidates;
+        // Queries of a consistency checker for the admissible versions of a read, and those admitting none
+        std::atomic<uint64_t> checker_invocations{0};
+        std::atomic<uint64_t> checker_rejections{0};
+
+        instrumentation_snapshot get_snapshot() const {
+            instrumentation_snapshot s;
+            s.get = this->get.get_snapshot();
+            s.put = this->put.get_snapshot();
+            s.remove = this->remove.get_snapshot();
+            s.multi_get = this->multi_get.get_snapshot();
+            s.multi_put = this->multi_put.get_snapshot();
+            s.begin = this->begin.get_snapshot();
+            s.commit = this->commit.get_snapshot();
+            s.lock_wait = this->lock_wait.get_snapshot();
+            s.lock_hold = this->lock_hold.get_snapshot();
+            s.select = this->select.get_snapshot();
+            s.candidates = this->candidates.get_snapshot();
+            s.checker_invocations = this->checker_invocations.load(std::memory_order_relaxed);
+            s.checker_rejections = this->checker_rejections.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        // Same clock as the timestamps of trace events
+        static uint64_t now() {
+            return tracer::now();
+        }
+    };
+
+    // Records the time until it goes out of scope into one histogram of metrics, if there are metrics
+    class scoped_latency {
+    public:
+        scoped_latency(instrumentation *metrics, latency_histogram instrumentation::*histogram) {
+            this->histogram = metrics == nullptr ? nullptr : &(metrics->*histogram);
+            this->start = metrics == nullptr ? 0 : instrumentation::now();
+        }
+
+        ~scoped_latency() {
+            if (this->histogram != nullptr)
+                this->histogram->record(instrumentation::now() - this->start);
+        }
+
+        scoped_latency(const scoped_latency &) = delete;
+        scoped_latency &operator=(const scoped_latency &) = delete;
+
+    private:
+        latency_histogram *histogram;
+        uint64_t start;
+    };
+
+    /*
+     * Mutex which records how long it was waited for and held into lock_wait and
+     * lock_hold of its metrics, if it has any. The metrics must only change while
+     * the mutex is unlocked. While tracing, contended acquisitions are traced as
+     * LOCK_WAIT events.
+     */
+    class instrumented_mutex {
+    public:
+        void lock() {
+            if (this->metrics == nullptr && !tracer::enabled()) {
+                this->mtx.lock();
+                return;
+            }
+            uint64_t start = instrumentation::now();
+            bool contended = !this->mtx.try_lock();
+            if (contended)
+                this->mtx.lock();
+            uint64_t locked_at = instrumentation::now();
+            if (this->metrics != nullptr) {
+                this->locked_at = locked_at;
+                this->metrics->lock_wait.record(locked_at - start);
+            }
+            if (contended && tracer::enabled())
+                tracer::record(trace_kind::LOCK_WAIT, this->trace_id, 0, 0, 0, 0, 0, locked_at - start);
+        }
+
+        bool try_lock() {
+            if (!this->mtx.try_lock())
+                return false;
+            if (this->metrics != nullptr) {
+                this->locked_at = instrumentation::now();
+                this->metrics->lock_wait.record(0);
+            }
+            return true;
+        }
+
+        void unlock() {
+            if (this->metrics != nullptr)
+                this->metrics->lock_hold.record(instrumentation::now() - this->locked_at);
+            this->mtx.unlock();
+        }
+
+        void set_instrumentation(instrumentation *metrics) {
+            this->metrics = metrics;
+        }
+
+        // Store whose LOCK_WAIT events these are
+        void set_trace_id(uint16_t trace_id) {
+            this->trace_id = trace_id;
+        }
+
+    private:
+        std::mutex mtx;
+        instrumentation *metrics = nullptr;
+        uint16_t trace_id = 0;
+        uint64_t locked_at = 0;     // Guarded by mtx
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_INSTRUMENTATION_H
@@ -8,16 +8,29 @@
 #ifndef MOCK_KEY_VALUE_STORE_KV_STORE_H
 #define MOCK_KEY_VALUE_STORE_KV_STORE_H
 
-//#define MOCKDB_DEBUG_LOG
 #define DEFAULT_SESSION 1
 
 #include "transaction.h"
+#include "version_chain.h"
+#include "object_pool.h"
+#include "candidate_view.h"
+#include "history_log.h"
+#include "tx_id_allocator.h"
+#include "cooperative_runner.h"
+#include "instrumentation.h"
+#include "trace_buffer.h"
 #include "key_not_found_exception.h"
 #include "consistency_exception.h"
 
-#include <list>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <vector>
 #include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <iostream>
 #include <sstream>
@@ -27,240 +40,1018 @@ namespace mockdb {
     template<typename K, typename V>
     class read_response_selector;
 
+    /*
+     * Common base of the stores of every selector type, so selectors and checkers
+     * can be handed the store they belong to whatever its selector type.
+     */
     template <typename K, typename V>
-    class kv_store {
+    class kv_store_base {
+    protected:
+        ~kv_store_base() {
+        }
+    };
+
+    /*
+     * Selector is the type of the read response selector the store calls. The
+     * default, read_response_selector, dispatches at run time to any selector. A
+     * final selector class, e.g. linearizable_read_response_selector or
+     * causal_read_response_selector, is called directly instead, so its calls can
+     * be inlined into the store's operations.
+     */
+    template <typename K, typename V, typename Selector = read_response_selector<K, V>>
+    class kv_store : public kv_store_base<K, V> {
     public:
-        kv_store(read_response_selector<K, V> *read_selector);
+        kv_store(Selector *read_selector, size_t lock_stripes = 1);
         V get(const K &key, long session_id = DEFAULT_SESSION);
         std::pair<V, size_t> get_with_version(const K &key, long session_id = DEFAULT_SESSION);
+        std::vector<std::pair<V, size_t>> multi_get(const std::vector<K> &keys, long session_id = DEFAULT_SESSION,
+                                                    std::vector<bool> *inconsistent = nullptr);
         int put(const K &key, const V &value, long session_id = DEFAULT_SESSION);
+        int multi_put(const std::vector<std::pair<K, V>> &pairs, long session_id = DEFAULT_SESSION);
         V remove(const K &key, long session_id = DEFAULT_SESSION);
+        size_t compact();
+
+        /*
+         * Multi-operation transactions. Between begin and commit all operations of the
+         * session belong to one transaction: reads are made and checked as they happen,
+         * writes are buffered and become visible together at commit.
+         */
+        void begin(long session_id = DEFAULT_SESSION);
+        void commit(long session_id = DEFAULT_SESSION);
 
         size_t get_size() const;
         ~kv_store();
 
-        const read_response_selector<K, V> *get_gen_next_tx() const;
-        void set_gen_next_tx(read_response_selector<K, V> *gen_next_tx);
+        const Selector *get_gen_next_tx() const;
+        void set_gen_next_tx(Selector *gen_next_tx);
 
-        const std::list<transaction<K, V>*> get_session_history(long session_id) const;
-        const std::list<transaction<K, V>*> get_history() const;
+        /*
+         * Read-only views of the committed history. Not synchronized with running
+         * operations, read them once the sessions are done.
+         */
+        typename history_log<K, V>::session_view get_session_history(long session_id) const;
+        const history_log<K, V> &get_history() const;
+
+        /*
+         * Starts recording latencies and counters of the store and its selector into
+         * metrics, nullptr stops. Call while no operation runs; metrics are not owned.
+         */
+        void set_instrumentation(instrumentation *metrics);
+        instrumentation *get_instrumentation() const;
+
+        // Id of the store in trace events, see tracer
+        uint16_t get_trace_id() const;
 
     private:
-        mockdb::transaction<K, V> *_get(const K &key, long session_id = DEFAULT_SESSION);
-        void commit_tx(transaction<K, V> *tx, long session_id);
-
-        std::unordered_map<K, std::list<std::pair<V, long>>> kv_map;
-        std::list<transaction<K, V>*> history;
-        std::unordered_map<long, std::list<transaction<K, V>*>> session_order;
-        std::mutex mtx;
-        read_response_selector<K, V> *read_selector;
+        /*
+         * Keys are partitioned into stripes, each guarding its own part of the map.
+         * Operations on keys of different stripes run in parallel; only commit_tx
+         * is ordered through history_mtx. Lock order is always stripe -> history.
+         */
+        struct stripe {
+            mutable instrumented_mutex mtx;
+            arena memory;               // Backs the version chains and objects of this stripe
+            object_pool objects{&memory};
+            std::unordered_map<K, version_chain<V>> kv_map;
+            size_t removed = 0;         // Keys whose latest version is a tombstone
+        };
+
+        enum class read_status {
+            FOUND, NOT_FOUND, INCONSISTENT
+        };
+
+        struct buffered_write {
+            operation<K, V> *op;
+            REMOVE_response<K, V> *removed;     // Response of a REMOVE, completed at commit
+        };
+
+        /*
+         * Transaction opened by begin. Its mutex is held by every operation on the
+         * session, as sessions may be shared between threads.
+         */
+        struct open_transaction {
+            std::mutex mtx;
+            transaction<K, V> *tx;
+            std::unordered_map<K, buffered_write> writes;   // Latest write of each key
+            std::vector<K> write_order;                     // Written keys in order of their first write
+            std::thread::id thread;                         // Thread which called begin
+            bool exclusive;                                 // Holds tx_lock exclusively
+        };
+
+        std::pair<V, size_t> _get(const K &key, long session_id = DEFAULT_SESSION);
+        read_status get_locked(stripe &s, const K &key, long session_id, std::pair<V, size_t> &result, long &tx_id);
+        read_status select_locked(stripe &s, const K &key, transaction<K, V> *tx, const operation<K, V> *op,
+                                  version_chain<V> *&chain, size_t &index);
+        size_t put_locked(stripe &s, const K &key, const V &value, long session_id);
+        read_status get_in_tx(open_transaction *open, const K &key, std::pair<V, size_t> &result, long &tx_id);
+        void put_in_tx(open_transaction *open, const K &key, const V &value);
+        V remove_in_tx(open_transaction *open, const K &key);
+        void commit_read(const transaction<K, V> *tx);
+        void commit_tx(const transaction<K, V> *tx, bool with_read);
+        void append_read(const transaction<K, V> *tx);
+        void release_tx(const transaction<K, V> *tx);
+        void release_open(open_transaction *open);
+        open_transaction *lock_open(long session_id);
+        std::shared_lock<std::shared_timed_mutex> lock_single();
+        size_t compact_removed(const K &key, version_chain<V> &chain);
+        stripe &get_stripe(const K &key);
+        void trace(trace_kind kind, const transaction<K, V> *tx, const K &key, long reads_from = 0,
+                   size_t version_number = 0);
+        size_t get_stripe_index(const K &key) const;
+        template <typename It, typename KeyOf>
+        std::vector<size_t> lock_stripes(It first, It last, KeyOf key_of);
+        void unlock_stripes(const std::vector<size_t> &locked);
+
+        std::vector<stripe> stripes;
+        history_log<K, V> history;  // Guarded by history_mtx
+        mutable std::mutex history_mtx;
+        Selector *read_selector;
+        tx_id_allocator tx_ids;
+        instrumentation *metrics = nullptr;
+        uint16_t trace_id;
+
+        /*
+         * Open transactions by session. Lock order is open_mtx -> transaction ->
+         * stripe -> history; tx_lock is taken before all of them.
+         */
+        std::mutex open_mtx;
+        std::condition_variable open_cv;    // Signalled when a transaction commits
+        std::unordered_map<long, open_transaction*> open_txs;
+        std::atomic<size_t> open_count{0};  // Lets operations skip open_mtx while no transaction is open
+        std::shared_timed_mutex tx_lock;    // Held exclusively by transactions which must be serialized
+        std::atomic<std::thread::id> tx_owner{std::thread::id()};
     };
 
 }
 
-template <typename K, typename V>
-mockdb::kv_store<K, V>::kv_store(read_response_selector<K, V> *get_next_tx) {
+/*
+ * lock_stripes = 1 keeps a single store-wide lock, larger values let operations
+ * on different keys proceed concurrently.
+ */
+template <typename K, typename V, typename Selector>
+mockdb::kv_store<K, V, Selector>::kv_store(Selector *get_next_tx, size_t lock_stripes)
+        : stripes(lock_stripes == 0 ? 1 : lock_stripes) {
     this->read_selector = get_next_tx;
+    this->trace_id = tracer::next_store_id();
+    for (auto &s : this->stripes)
+        s.mtx.set_trace_id(this->trace_id);
 }
 
-// Destructor
-template <typename K, typename V>
-mockdb::kv_store<K, V>::~kv_store() {
-    for (auto tx : this->history) {
-        delete tx;
-    }
+// Destructor, memory of all objects is released together with the stripe arenas
+template <typename K, typename V, typename Selector>
+mockdb::kv_store<K, V, Selector>::~kv_store() {
+    // Transactions never committed are dropped
+    for (auto &entry : this->open_txs)
+        this->release_open(entry.second);
+    if (tracer::enabled())
+        tracer::record(trace_kind::STORE_CLOSED, this->trace_id, 0, 0, 0);
 }
 
 /*
  * GET operation: returns value corresponding to the given key.
  * May throw key_not_found_exception.
  */
-template <typename K, typename V>
-V mockdb::kv_store<K, V>::get(const K &key, long session_id) {
-    const GET_response<K, V> *op_response = dynamic_cast<const GET_response<K, V>*>(_get(key, session_id)->get_operation()->get_response());
-    return op_response->get_value();
+template <typename K, typename V, typename Selector>
+V mockdb::kv_store<K, V, Selector>::get(const K &key, long session_id) {
+    return _get(key, session_id).first;
 }
 
 /*
  * GET operation: returns value along with the version number.
  * May throw key_not_found_exception.
  */
-template <typename K, typename V>
-std::pair<V, size_t> mockdb::kv_store<K, V>::get_with_version(const K &key, long session_id) {
-    const GET_response<K, V> *op_response = dynamic_cast<const GET_response<K, V>*>(_get(key, session_id)->get_operation()->get_response());
-    return {op_response->get_value(), op_response->get_version_number()};
+template <typename K, typename V, typename Selector>
+std::pair<V, size_t> mockdb::kv_store<K, V, Selector>::get_with_version(const K &key, long session_id) {
+    return _get(key, session_id);
 }
 
 
 /*
- * GET operation.
+ * GET operation: returns the chosen value and its version number.
  * May throw key_not_found_exception.
  */
-template <typename K, typename V>
-mockdb::transaction<K, V> *mockdb::kv_store<K, V>::_get(const K &key, long session_id) {
-    // Create GET operation and transaction
-    GET_param<K, V> *params = new GET_param<K, V>(key);
-    GET_operation<K, V> *op = new GET_operation<K, V>(params);
-    transaction<K, V> *tx = new transaction<K, V>(op);
-    tx->set_session_id(session_id);
+template <typename K, typename V, typename Selector>
+std::pair<V, size_t> mockdb::kv_store<K, V, Selector>::_get(const K &key, long session_id) {
+    scoped_latency timer(this->metrics, &instrumentation::get);
+    std::pair<V, size_t> result;
+    long tx_id;
+    read_status status;
 
-    // Acquire the lock and enter critical section.
-    this->mtx.lock();
-    tx->start_transaction();
+    open_transaction *open = this->lock_open(session_id);
+    if (open != nullptr) {
+        status = this->get_in_tx(open, key, result, tx_id);
+        open->mtx.unlock();
+    } else {
+        std::shared_lock<std::shared_timed_mutex> single = this->lock_single();
+
+        // Acquire the lock of the key's stripe and enter critical section.
+        stripe &s = this->get_stripe(key);
+        s.mtx.lock();
+
+        status = this->get_locked(s, key, session_id, result, tx_id);
 
-    // Throw exception if key doesn't exist
-    if (this->kv_map.find(key) == this->kv_map.end()) {
-#ifdef MOCKDB_DEBUG_LOG
-        std::cout << "[MOCKDB::kvstore] [ERROR::KEY_NOT_FOUND] TXN " << tx->get_tx_id()
-                  << " GET " << key << " NOTFOUND " << session_id << std::endl;
-#endif // MOCKDB_DEBUG_LOG
-        this->mtx.unlock();
-        delete tx;
+        // Done with critical section, release the lock.
+        s.mtx.unlock();
+    }
+
+    if (status == read_status::INCONSISTENT) {
+        std::stringstream ss;
+        ss << "GET(" << key << ")";
+        throw consistency_exception(ss.str(), tx_id);
+    }
+    if (status == read_status::NOT_FOUND) {
         std::stringstream ss;
         ss << key;
         throw key_not_found_exception(ss.str());
     }
+    return result;
+}
+
+/*
+ * GET of several keys under a single acquisition of their stripe locks. Each key is
+ * read and recorded in the history as its own GET. Missing and removed keys are
+ * returned with version number 0. The selector is consulted for each key as for a
+ * single GET, no checker state is shared across the batch.
+ * If inconsistent is given, keys without a consistent version are flagged in it and
+ * returned with version number 0, the other keys are still read. Otherwise throws
+ * consistency_exception, reads of the keys before the failing one stay committed.
+ */
+template <typename K, typename V, typename Selector>
+std::vector<std::pair<V, size_t>> mockdb::kv_store<K, V, Selector>::multi_get(const std::vector<K> &keys, long session_id,
+                                                                              std::vector<bool> *inconsistent) {
+    scoped_latency timer(this->metrics, &instrumentation::multi_get);
+    std::vector<std::pair<V, size_t>> results(keys.size());
+    if (inconsistent != nullptr)
+        inconsistent->assign(keys.size(), false);
+
+    open_transaction *open = this->lock_open(session_id);
+    if (open != nullptr) {
+        // Inside a transaction the keys are read one by one, each read locks its own stripe
+        std::lock_guard<std::mutex> lck(open->mtx, std::adopt_lock);
+        for (size_t i = 0; i < keys.size(); i++) {
+            long tx_id;
+            read_status status = this->get_in_tx(open, keys[i], results[i], tx_id);
+            if (status == read_status::INCONSISTENT && inconsistent != nullptr) {
+                (*inconsistent)[i] = true;
+                status = read_status::NOT_FOUND;
+            }
+            if (status == read_status::INCONSISTENT) {
+                std::stringstream ss;
+                ss << "GET(" << keys[i] << ")";
+                throw consistency_exception(ss.str(), tx_id);
+            }
+            if (status == read_status::NOT_FOUND)
+                results[i] = std::pair<V, size_t>(V(), 0);
+        }
+        return results;
+    }
+
+    std::shared_lock<std::shared_timed_mutex> single = this->lock_single();
+    std::vector<size_t> locked = this->lock_stripes(keys.begin(), keys.end(),
+                                                    [](const K &key) -> const K & { return key; });
 
-    // List down candidate responses using all possible versions present in the store
-    // corresponding to the given key
-    std::vector<GET_response<K, V>*> candidate_responses;
-    for (auto candidate_value : this->kv_map[key]) {
-        GET_response<K, V> *op_response = new GET_response<K, V>(key, candidate_value.first);
-        op_response->set_written_by_tx_id(candidate_value.second);
-        candidate_responses.push_back(op_response);
+    for (size_t i = 0; i < keys.size(); i++) {
+        long tx_id;
+        read_status status = this->get_locked(this->get_stripe(keys[i]), keys[i], session_id, results[i], tx_id);
+        if (status == read_status::INCONSISTENT && inconsistent != nullptr) {
+            (*inconsistent)[i] = true;
+            status = read_status::NOT_FOUND;
+        }
+        if (status == read_status::INCONSISTENT) {
+            this->unlock_stripes(locked);
+            std::stringstream ss;
+            ss << "GET(" << keys[i] << ")";
+            throw consistency_exception(ss.str(), tx_id);
+        }
+        if (status == read_status::NOT_FOUND)
+            results[i] = std::pair<V, size_t>(V(), 0);
     }
 
-    GET_response<K, V> *op_response;
-    try {
-        // Choose one transaction response among the candidates by some strategy
-        op_response = read_selector->select_read_response(tx, op, candidate_responses);
-    } catch (consistency_exception &e) {
-        // No consistent response possible
-#ifdef MOCKDB_DEBUG_LOG
-        std::cout << "[MOCKDB::kvstore] [ERROR::INCONSISTENT_STATE] TXN " << tx->get_tx_id()
-                  << " GET " << key << " INCONSISTENT " << session_id << std::endl;
-#endif // MOCKDB_DEBUG_LOG
-        this->mtx.unlock();
-        delete tx;
-        for (auto c : candidate_responses)
-            delete c;
-        std::stringstream ss;
-        ss << "GET(" << key << ")";
-        throw consistency_exception(ss.str(), tx->get_tx_id());
+    this->unlock_stripes(locked);
+    return results;
+}
+
+/*
+ * Reads a key in a transaction of its own, the lock of its stripe must be held. The
+ * read is committed unless the key doesn't exist or no consistent version is
+ * available; tx_id is set to the transaction in the latter case.
+ */
+template <typename K, typename V, typename Selector>
+typename mockdb::kv_store<K, V, Selector>::read_status
+mockdb::kv_store<K, V, Selector>::get_locked(stripe &s, const K &key, long session_id, std::pair<V, size_t> &result, long &tx_id) {
+    // Create GET operation and transaction
+    GET_param<K, V> *params = s.objects.template create<GET_param<K, V>>(key);
+    GET_operation<K, V> *op = s.objects.template create<GET_operation<K, V>>(params);
+    transaction<K, V> *tx = s.objects.template create<transaction<K, V>>(this->tx_ids.next(), op);
+    tx->set_session_id(session_id);
+    tx->start_transaction();
+
+    version_chain<V> *chain;
+    size_t index;
+    read_status status = this->select_locked(s, key, tx, op, chain, index);
+    if (status != read_status::FOUND) {
+        tx_id = tx->get_tx_id();
+        this->release_tx(tx);
+        return status;
     }
 
+    // Only the chosen version is materialized as a response
+    candidate_view<K, V> candidates(key, *chain);
+    result = std::pair<V, size_t>((*chain)[index].value, candidates.get_version_number(index));
+    GET_response<K, V> *op_response = s.objects.template create<GET_response<K, V>>(key, result.first);
+    op_response->set_written_by_tx_id(candidates.get_tx_id(index));
+    op_response->set_version_number(result.second);
     op->set_response(op_response);
     tx->end_transaction();
-    this->commit_tx(tx, session_id);
-
-#ifdef MOCKDB_DEBUG_LOG
-    std::cout << "[MOCKDB::kvstore] TXN " << tx->get_tx_id() << " GET " << key
-              << " session " << session_id << std::endl;
-#endif // MOCKDB_DEBUG_LOG
-
-    // Free allocated memory and find out version number
-    size_t version_number = 1;
-    for (auto candidate : candidate_responses) {
-        if (candidate != op_response) {
-            version_number++;
-            delete candidate;
-        }
-        else {
-            op_response->set_version_number(version_number);
-        }
+    this->commit_tx(tx, true);
+
+    this->trace(trace_kind::GET, tx, key, candidates.get_tx_id(index), result.second);
+
+    // The history keeps its own record, the transaction is no longer needed
+    this->release_tx(tx);
+
+    // Reading a tombstone is a committed read of a removed key
+    if (candidates.is_tombstone(index)) {
+        this->compact_removed(key, *chain);
+        return read_status::NOT_FOUND;
     }
+    return read_status::FOUND;
+}
 
-    // Done with critical section, release the lock.
-    this->mtx.unlock();
+/*
+ * Chooses the version of key read by op, the current operation of tx. The lock of
+ * the key's stripe must be held.
+ */
+template <typename K, typename V, typename Selector>
+typename mockdb::kv_store<K, V, Selector>::read_status
+mockdb::kv_store<K, V, Selector>::select_locked(stripe &s, const K &key, transaction<K, V> *tx, const operation<K, V> *op,
+                                      version_chain<V> *&chain, size_t &index) {
+    this->read_selector->before_read(tx, key);
+    auto it = s.kv_map.find(key);
+    if (it == s.kv_map.end()) {
+        this->trace(trace_kind::NOT_FOUND, tx, key);
+        return read_status::NOT_FOUND;
+    }
+
+    // All versions present in the store for the given key are candidates
+    chain = &it->second;
+    candidate_view<K, V> candidates(key, *chain);
 
-    return tx;
+    if (this->metrics != nullptr)
+        this->metrics->candidates.record(candidates.size());
+    scoped_latency timer(this->metrics, &instrumentation::select);
+
+    try {
+        // Choose one candidate by some strategy
+        index = read_selector->select_read_response(tx, op, candidates);
+    } catch (consistency_exception &e) {
+        // No consistent response possible
+        this->trace(trace_kind::INCONSISTENT, tx, key);
+        return read_status::INCONSISTENT;
+    }
+    return read_status::FOUND;
 }
 
 /*
  * PUT operation.
  */
-template <typename K, typename V>
-int mockdb::kv_store<K, V>::put(const K &key, const V &value, long session_id) {
+template <typename K, typename V, typename Selector>
+int mockdb::kv_store<K, V, Selector>::put(const K &key, const V &value, long session_id) {
+    scoped_latency timer(this->metrics, &instrumentation::put);
+    open_transaction *open = this->lock_open(session_id);
+    if (open != nullptr) {
+        this->put_in_tx(open, key, value);
+        open->mtx.unlock();
+        return 1;
+    }
+
+    std::shared_lock<std::shared_timed_mutex> single = this->lock_single();
+
+    // Acquire the lock of the key's stripe and enter critical section.
+    stripe &s = this->get_stripe(key);
+    s.mtx.lock();
+
+    this->put_locked(s, key, value, session_id);
+
+    // Done with critical section, release the lock.
+    s.mtx.unlock();
+    return 1;
+}
+
+/*
+ * PUT of several key-value pairs under a single acquisition of their stripe locks.
+ * Each pair is recorded in the history as its own PUT, in the given order.
+ */
+template <typename K, typename V, typename Selector>
+int mockdb::kv_store<K, V, Selector>::multi_put(const std::vector<std::pair<K, V>> &pairs, long session_id) {
+    scoped_latency timer(this->metrics, &instrumentation::multi_put);
+    open_transaction *open = this->lock_open(session_id);
+    if (open != nullptr) {
+        for (auto &pair : pairs)
+            this->put_in_tx(open, pair.first, pair.second);
+        open->mtx.unlock();
+        return (int) pairs.size();
+    }
+
+    std::shared_lock<std::shared_timed_mutex> single = this->lock_single();
+    std::vector<size_t> locked = this->lock_stripes(pairs.begin(), pairs.end(),
+                                                    [](const std::pair<K, V> &pair) -> const K & { return pair.first; });
+    for (auto &pair : pairs)
+        this->put_locked(this->get_stripe(pair.first), pair.first, pair.second, session_id);
+    this->unlock_stripes(locked);
+    return (int) pairs.size();
+}
+
+// Writes a key, the lock of its stripe must be held. Returns the new version number.
+template <typename K, typename V, typename Selector>
+size_t mockdb::kv_store<K, V, Selector>::put_locked(stripe &s, const K &key, const V &value, long session_id) {
     // Create PUT operation and transaction
-    PUT_param<K, V> *params = new PUT_param<K, V>(key, value);
-    PUT_operation<K, V> *op = new PUT_operation<K, V>(params);
-    transaction<K, V> *tx = new transaction<K, V>(op);
+    PUT_param<K, V> *params = s.objects.template create<PUT_param<K, V>>(key, value);
+    PUT_operation<K, V> *op = s.objects.template create<PUT_operation<K, V>>(params);
+    transaction<K, V> *tx = s.objects.template create<transaction<K, V>>(this->tx_ids.next(), op);
     tx->set_session_id(session_id);
-
-    // Acquire the lock and enter critical section.
-    this->mtx.lock();
     tx->start_transaction();
 
-    if (this->kv_map.find(key) == this->kv_map.end()) {
-        std::list<std::pair<V, long>> l({{value, tx->get_tx_id()}});
-        this->kv_map[key] = l;
-    }
-    else
-        this->kv_map[key].push_back({value, tx->get_tx_id()});
+    auto it = s.kv_map.find(key);
+    if (it == s.kv_map.end())
+        it = s.kv_map.emplace(key, version_chain<V>(&s.memory)).first;
+    else if (it->second.latest().tombstone)
+        s.removed--;
+    size_t version_number = it->second.append(value, tx->get_tx_id());
 
     tx->end_transaction();
 
     // Record response of transaction
-    PUT_response<K, V> *op_response = new PUT_response<K, V>(true);
+    PUT_response<K, V> *op_response = s.objects.template create<PUT_response<K, V>>(true);
+    op_response->set_version_number(version_number);
     op->set_response(op_response);
 
-    this->commit_tx(tx, session_id);
+    this->commit_tx(tx, false);
+
+    this->trace(trace_kind::PUT, tx, key, 0, version_number);
 
-#ifdef MOCKDB_DEBUG_LOG
-    std::cout << "[MOCKDB::kvstore] TXN " << tx->get_tx_id() << " PUT " << key
-         << " session " << session_id << std::endl;
-#endif // MOCKDB_DEBUG_LOG
+    this->release_tx(tx);
+    return version_number;
+}
+
+/*
+ * REMOVE operation: reads the key like GET and, unless the version read is a
+ * tombstone, appends a tombstone. Returns the removed value.
+ * May throw key_not_found_exception.
+ */
+template <typename K, typename V, typename Selector>
+V mockdb::kv_store<K, V, Selector>::remove(const K &key, long session_id) {
+    scoped_latency timer(this->metrics, &instrumentation::remove);
+    open_transaction *open = this->lock_open(session_id);
+    if (open != nullptr) {
+        std::lock_guard<std::mutex> lck(open->mtx, std::adopt_lock);
+        return this->remove_in_tx(open, key);
+    }
+
+    std::shared_lock<std::shared_timed_mutex> single = this->lock_single();
+
+    // Acquire the lock of the key's stripe and enter critical section.
+    stripe &s = this->get_stripe(key);
+    s.mtx.lock();
+
+    // Create REMOVE operation and transaction
+    REMOVE_param<K, V> *params = s.objects.template create<REMOVE_param<K, V>>(key);
+    REMOVE_operation<K, V> *op = s.objects.template create<REMOVE_operation<K, V>>(params);
+    transaction<K, V> *tx = s.objects.template create<transaction<K, V>>(this->tx_ids.next(), op);
+    tx->set_session_id(session_id);
+    tx->start_transaction();
+
+    // The version removed is chosen like a read
+    version_chain<V> *chain;
+    size_t index;
+    read_status status = this->select_locked(s, key, tx, op, chain, index);
+    if (status != read_status::FOUND) {
+        long tx_id = tx->get_tx_id();
+        this->release_tx(tx);
+        s.mtx.unlock();
+        std::stringstream ss;
+        if (status == read_status::NOT_FOUND) {
+            // Throw exception if key doesn't exist
+            ss << key;
+            throw key_not_found_exception(ss.str());
+        }
+        ss << "REMOVE(" << key << ")";
+        throw consistency_exception(ss.str(), tx_id);
+    }
+
+    candidate_view<K, V> candidates(key, *chain);
+    bool found = !candidates.is_tombstone(index);
+    V value = (*chain)[index].value;
+    REMOVE_response<K, V> *op_response = s.objects.template create<REMOVE_response<K, V>>(key, value, found);
+    op_response->set_written_by_tx_id(candidates.get_tx_id(index));
+    op_response->set_read_version_number(candidates.get_version_number(index));
+
+    if (found) {
+        if (!chain->latest().tombstone)
+            s.removed++;
+        op_response->set_version_number(chain->append_tombstone(tx->get_tx_id()));
+    }
+    op->set_response(op_response);
+    tx->end_transaction();
+    this->commit_tx(tx, true);
+
+    this->trace(trace_kind::REMOVE, tx, key, candidates.get_tx_id(index), op_response->get_version_number());
+
+    this->release_tx(tx);
+    this->compact_removed(key, *chain);
 
     // Done with critical section, release the lock.
-    this->mtx.unlock();
-    return 1;
+    s.mtx.unlock();
+
+    if (!found) {
+        std::stringstream ss;
+        ss << key;
+        throw key_not_found_exception(ss.str());
+    }
+    return value;
 }
 
 /*
- * REMOVE operation.
+ * Starts a transaction of the session. If another thread has one open on the same
+ * session, waits until it commits. Under a selector which serializes transactions
+ * all other operations wait until commit, so begin and commit must be called from
+ * the same thread.
+ * Throws std::logic_error if the calling thread already has a transaction open on
+ * the session, or a serialized one on any session.
+ */
+template <typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::begin(long session_id) {
+    // Scheduling point when run under a cooperative_runner, before any lock is taken
+    cooperative_runner::yield_current();
+    scoped_latency timer(this->metrics, &instrumentation::begin);
+
+    bool exclusive = this->read_selector->serializes_transactions();
+    if (exclusive) {
+        if (this->tx_owner.load() == std::this_thread::get_id())
+            throw std::logic_error("Serialized transactions of a thread can't overlap");
+        this->tx_lock.lock();
+        this->tx_owner.store(std::this_thread::get_id());
+    }
+
+    std::unique_lock<std::mutex> lck(this->open_mtx);
+    auto it = this->open_txs.find(session_id);
+    while (it != this->open_txs.end()) {
+        if (it->second->thread == std::this_thread::get_id()) {
+            lck.unlock();
+            if (exclusive) {
+                this->tx_owner.store(std::thread::id());
+                this->tx_lock.unlock();
+            }
+            throw std::logic_error("Session " + std::to_string(session_id) + " already has an open transaction");
+        }
+        this->open_cv.wait(lck);
+        it = this->open_txs.find(session_id);
+    }
+
+    // Operations of an open transaction are owned by the pools of their keys' stripes
+    open_transaction *open = new open_transaction();
+    open->tx = new transaction<K, V>(this->tx_ids.next(), nullptr);
+    open->tx->set_session_id(session_id);
+    open->tx->start_transaction();
+    open->thread = std::this_thread::get_id();
+    open->exclusive = exclusive;
+    this->open_txs[session_id] = open;
+    this->open_count++;
+
+    if (tracer::enabled())
+        tracer::record(trace_kind::BEGIN, this->trace_id, open->tx->get_tx_id(), session_id, 0);
+}
+
+/*
+ * Commits the open transaction of the session: its buffered writes are applied
+ * under a single acquisition of their stripe locks and recorded together.
+ * Throws std::logic_error if the session has no open transaction.
+ */
+template <typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::commit(long session_id) {
+    scoped_latency timer(this->metrics, &instrumentation::commit);
+    open_transaction *open;
+    {
+        std::lock_guard<std::mutex> lck(this->open_mtx);
+        auto it = this->open_txs.find(session_id);
+        if (it == this->open_txs.end())
+            throw std::logic_error("Session " + std::to_string(session_id) + " has no open transaction");
+        open = it->second;
+        // Wait for operations still running on the session
+        open->mtx.lock();
+        this->open_txs.erase(it);
+        this->open_count--;
+    }
+
+    transaction<K, V> *tx = open->tx;
+    std::vector<size_t> locked = this->lock_stripes(open->write_order.begin(), open->write_order.end(),
+                                                    [](const K &key) -> const K & { return key; });
+    for (const K &key : open->write_order) {
+        stripe &s = this->get_stripe(key);
+        buffered_write &write = open->writes.find(key)->second;
+        auto it = s.kv_map.find(key);
+        if (it == s.kv_map.end())
+            it = s.kv_map.emplace(key, version_chain<V>(&s.memory)).first;
+        version_chain<V> &chain = it->second;
+        bool was_removed = chain.size() > 0 && chain.latest().tombstone;
+
+        if (write.op->get_kind() == op_kind::PUT) {
+            if (was_removed)
+                s.removed--;
+            const V &value = static_cast<const PUT_param<K, V>*>(write.op->get_params())->get_value();
+            PUT_response<K, V> *op_response = s.objects.template create<PUT_response<K, V>>(true);
+            op_response->set_version_number(chain.append(value, tx->get_tx_id()));
+            write.op->set_response(op_response);
+        } else {
+            if (!was_removed)
+                s.removed++;
+            write.removed->set_version_number(chain.append_tombstone(tx->get_tx_id()));
+        }
+    }
+    tx->end_transaction();
+    this->commit_tx(tx, false);
+
+    if (tracer::enabled())
+        tracer::record(trace_kind::COMMIT, this->trace_id, tx->get_tx_id(), session_id, 0, 0, tx->get_operation_count());
+
+    for (const K &key : open->write_order)
+        this->compact_removed(key, this->get_stripe(key).kv_map.find(key)->second);
+    this->unlock_stripes(locked);
+
+    open->mtx.unlock();
+    bool exclusive = open->exclusive;
+    this->release_open(open);
+    if (exclusive) {
+        this->tx_owner.store(std::thread::id());
+        this->tx_lock.unlock();
+    }
+    this->open_cv.notify_all();
+}
+
+/*
+ * GET inside an open transaction. Keys written by the transaction are read from its
+ * buffer with version number 0 and are not recorded; other reads are committed as
+ * they are made.
+ */
+template <typename K, typename V, typename Selector>
+typename mockdb::kv_store<K, V, Selector>::read_status
+mockdb::kv_store<K, V, Selector>::get_in_tx(open_transaction *open, const K &key, std::pair<V, size_t> &result, long &tx_id) {
+    auto w = open->writes.find(key);
+    if (w != open->writes.end()) {
+        if (w->second.op->get_kind() == op_kind::REMOVE)
+            return read_status::NOT_FOUND;
+        result = std::pair<V, size_t>(static_cast<const PUT_param<K, V>*>(w->second.op->get_params())->get_value(), 0);
+        return read_status::FOUND;
+    }
+
+    transaction<K, V> *tx = open->tx;
+    stripe &s = this->get_stripe(key);
+    std::lock_guard<instrumented_mutex> lck(s.mtx);
+
+    GET_param<K, V> *params = s.objects.template create<GET_param<K, V>>(key);
+    GET_operation<K, V> *op = s.objects.template create<GET_operation<K, V>>(params);
+    tx->add_operation(op);
+
+    version_chain<V> *chain;
+    size_t index;
+    read_status status = this->select_locked(s, key, tx, op, chain, index);
+    if (status != read_status::FOUND) {
+        tx_id = tx->get_tx_id();
+        return status;
+    }
+
+    candidate_view<K, V> candidates(key, *chain);
+    result = std::pair<V, size_t>((*chain)[index].value, candidates.get_version_number(index));
+    GET_response<K, V> *op_response = s.objects.template create<GET_response<K, V>>(key, result.first);
+    op_response->set_written_by_tx_id(candidates.get_tx_id(index));
+    op_response->set_version_number(result.second);
+    op->set_response(op_response);
+    this->commit_read(tx);
+
+    this->trace(trace_kind::GET, tx, key, candidates.get_tx_id(index), result.second);
+
+    if (candidates.is_tombstone(index)) {
+        this->compact_removed(key, *chain);
+        return read_status::NOT_FOUND;
+    }
+    return read_status::FOUND;
+}
+
+// PUT inside an open transaction, buffered until commit
+template <typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::put_in_tx(open_transaction *open, const K &key, const V &value) {
+    stripe &s = this->get_stripe(key);
+    PUT_operation<K, V> *op;
+    {
+        std::lock_guard<instrumented_mutex> lck(s.mtx);
+        PUT_param<K, V> *params = s.objects.template create<PUT_param<K, V>>(key, value);
+        op = s.objects.template create<PUT_operation<K, V>>(params);
+    }
+    open->tx->add_operation(op);
+
+    auto w = open->writes.find(key);
+    if (w == open->writes.end())
+        open->write_order.push_back(key);
+    open->writes[key] = {op, nullptr};
+}
+
+/*
+ * REMOVE inside an open transaction: the read is committed as it is made, the
+ * tombstone is buffered until commit.
  * May throw key_not_found_exception.
  */
-template <typename K, typename V>
-V mockdb::kv_store<K, V>::remove(const K &key, long session_id) {
-    // TODO
+template <typename K, typename V, typename Selector>
+V mockdb::kv_store<K, V, Selector>::remove_in_tx(open_transaction *open, const K &key) {
+    transaction<K, V> *tx = open->tx;
+    auto w = open->writes.find(key);
+    if (w != open->writes.end() && w->second.op->get_kind() == op_kind::REMOVE) {
+        std::stringstream ss;
+        ss << key;
+        throw key_not_found_exception(ss.str());
+    }
+
+    stripe &s = this->get_stripe(key);
+    std::unique_lock<instrumented_mutex> lck(s.mtx);
+    REMOVE_param<K, V> *params = s.objects.template create<REMOVE_param<K, V>>(key);
+    REMOVE_operation<K, V> *op = s.objects.template create<REMOVE_operation<K, V>>(params);
+    tx->add_operation(op);
+
+    REMOVE_response<K, V> *op_response;
+    if (w != open->writes.end()) {
+        // Removes the transaction's own write
+        const V &value = static_cast<const PUT_param<K, V>*>(w->second.op->get_params())->get_value();
+        op_response = s.objects.template create<REMOVE_response<K, V>>(key, value, true);
+        op_response->set_written_by_tx_id(tx->get_tx_id());
+        op->set_response(op_response);
+    } else {
+        version_chain<V> *chain;
+        size_t index;
+        read_status status = this->select_locked(s, key, tx, op, chain, index);
+        if (status != read_status::FOUND) {
+            lck.unlock();
+            std::stringstream ss;
+            if (status == read_status::NOT_FOUND) {
+                ss << key;
+                throw key_not_found_exception(ss.str());
+            }
+            ss << "REMOVE(" << key << ")";
+            throw consistency_exception(ss.str(), tx->get_tx_id());
+        }
+
+        candidate_view<K, V> candidates(key, *chain);
+        bool found = !candidates.is_tombstone(index);
+        op_response = s.objects.template create<REMOVE_response<K, V>>(key, (*chain)[index].value, found);
+        op_response->set_written_by_tx_id(candidates.get_tx_id(index));
+        op_response->set_read_version_number(candidates.get_version_number(index));
+        op->set_response(op_response);
+        this->commit_read(tx);
+
+        if (!found) {
+            this->compact_removed(key, *chain);
+            lck.unlock();
+            std::stringstream ss;
+            ss << key;
+            throw key_not_found_exception(ss.str());
+        }
+        open->write_order.push_back(key);
+    }
+
+    this->trace(trace_kind::REMOVE, tx, key, op_response->get_written_by_tx_id());
+
+    open->writes[key] = {op, op_response};
+    return op_response->get_value();
+}
+
+/*
+ * Drops the versions of removed keys which can no longer be read, returns the
+ * number of versions dropped. Removed keys keep their tombstone so version numbers
+ * continue from it if the key is written again.
+ */
+template <typename K, typename V, typename Selector>
+size_t mockdb::kv_store<K, V, Selector>::compact() {
+    size_t dropped = 0;
+    for (auto &s : this->stripes) {
+        std::lock_guard<instrumented_mutex> lck(s.mtx);
+        for (auto &entry : s.kv_map)
+            dropped += this->compact_removed(entry.first, entry.second);
+    }
+    return dropped;
+}
+
+// Records the read of the current operation of a transaction which stays open
+template <typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::commit_read(const transaction<K, V> *tx) {
+    std::lock_guard<std::mutex> lck(this->history_mtx);
+    this->append_read(tx);
+}
+
+/*
+ * Records the transaction in the history, commits across stripes are ordered here.
+ * with_read also records the read of its current operation, for transactions of a
+ * single operation.
+ */
+template <typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::commit_tx(const transaction<K, V> *tx, bool with_read) {
+    std::lock_guard<std::mutex> lck(this->history_mtx);
+    if (with_read)
+        this->append_read(tx);
+
+    for (size_t i = 0; i < tx->get_operation_count(); i++) {
+        const operation<K, V> *op = tx->get_operation(i);
+        if (op->get_kind() == op_kind::PUT) {
+            // Writes superseded within the transaction have no response
+            const PUT_response<K, V> *response = static_cast<const PUT_operation<K, V>*>(op)->get_response();
+            if (response != nullptr)
+                this->history.append(tx->get_tx_id(), tx->get_session_id(), op_kind::PUT,
+                                     op->get_params()->get_key(), response->get_version_number(), 0);
+        } else if (op->get_kind() == op_kind::REMOVE) {
+            const REMOVE_response<K, V> *response = static_cast<const REMOVE_operation<K, V>*>(op)->get_response();
+            if (response != nullptr)
+                this->history.append(tx->get_tx_id(), tx->get_session_id(), op_kind::REMOVE,
+                                     op->get_params()->get_key(), response->get_version_number(),
+                                     response->get_written_by_tx_id());
+        }
+    }
+
+    // Let the selector update its view of the history
+    this->read_selector->on_commit(tx);
 }
 
-template <typename K, typename V>
-void mockdb::kv_store<K, V>::commit_tx(transaction<K, V> *tx, long session_id) {
-    // Insert transaction in history
-    this->history.push_back(tx);
-    if (this->session_order.find(session_id) == this->session_order.end())
-        this->session_order[session_id] = std::list<transaction<K, V>*>({tx});
-    else
-        this->session_order[session_id].push_back(tx);
+// Appends the GET row of the current operation and passes the read to the selector, history_mtx must be held
+template <typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::append_read(const transaction<K, V> *tx) {
+    const operation<K, V> *op = tx->get_operation();
+    if (op->get_kind() == op_kind::GET) {
+        const GET_response<K, V> *response = static_cast<const GET_operation<K, V>*>(op)->get_response();
+        this->history.append(tx->get_tx_id(), tx->get_session_id(), op_kind::GET, op->get_params()->get_key(),
+                             response->get_version_number(), response->get_written_by_tx_id());
+    }
+    this->read_selector->on_read(tx);
 }
 
-template<typename K, typename V>
-const mockdb::read_response_selector<K, V> *mockdb::kv_store<K, V>::get_gen_next_tx() const {
+template<typename K, typename V, typename Selector>
+const Selector *mockdb::kv_store<K, V, Selector>::get_gen_next_tx() const {
     return read_selector;
 }
 
-// Get number of keys in the store
-template<typename K, typename V>
-size_t mockdb::kv_store<K, V>::get_size() const {
-    return this->kv_map.size();
+// Get number of keys in the store, removed keys are not counted
+template<typename K, typename V, typename Selector>
+size_t mockdb::kv_store<K, V, Selector>::get_size() const {
+    size_t size = 0;
+    for (auto &s : this->stripes) {
+        std::lock_guard<instrumented_mutex> lck(s.mtx);
+        size += s.kv_map.size() - s.removed;
+    }
+    return size;
+}
+
+/*
+ * Compacts a chain ending in a tombstone down to the tombstone once the selector
+ * reports that older versions can no longer be read. The stripe lock must be held.
+ */
+template<typename K, typename V, typename Selector>
+size_t mockdb::kv_store<K, V, Selector>::compact_removed(const K &key, version_chain<V> &chain) {
+    if (chain.size() < 2 || !chain.latest().tombstone)
+        return 0;
+    size_t version_number = chain.get_version_number(chain.size() - 1);
+    if (!this->read_selector->is_superseded(key, version_number))
+        return 0;
+    size_t dropped = chain.size() - 1;
+    chain.compact(version_number);
+    return dropped;
+}
+
+/*
+ * Destroys a transaction together with its operation, parameters and response.
+ * They are owned by the pool of the stripe of the key, whose lock must be held.
+ */
+template<typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::release_tx(const transaction<K, V> *tx) {
+    const operation<K, V> *op = tx->get_operation();
+    object_pool &objects = this->get_stripe(op->get_params()->get_key()).objects;
+    objects.destroy(op->get_response());
+    objects.destroy(op->get_params());
+    objects.destroy(op);
+    objects.destroy(tx);
 }
 
-template<typename K, typename V>
-void mockdb::kv_store<K, V>::set_gen_next_tx(mockdb::read_response_selector<K, V> *get_next_tx) {
+// Destroys an open transaction together with all its operations
+template<typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::release_open(open_transaction *open) {
+    for (size_t i = 0; i < open->tx->get_operation_count(); i++) {
+        const operation<K, V> *op = open->tx->get_operation(i);
+        stripe &s = this->get_stripe(op->get_params()->get_key());
+        std::lock_guard<instrumented_mutex> lck(s.mtx);
+        s.objects.destroy(op->get_response());
+        s.objects.destroy(op->get_params());
+        s.objects.destroy(op);
+    }
+    delete open->tx;
+    delete open;
+}
+
+/*
+ * Returns the open transaction of the session with its mutex locked, or nullptr if
+ * the session has none.
+ */
+template<typename K, typename V, typename Selector>
+typename mockdb::kv_store<K, V, Selector>::open_transaction *mockdb::kv_store<K, V, Selector>::lock_open(long session_id) {
+    if (this->open_count.load() == 0)
+        return nullptr;
+    std::lock_guard<std::mutex> lck(this->open_mtx);
+    auto it = this->open_txs.find(session_id);
+    if (it == this->open_txs.end())
+        return nullptr;
+    it->second->mtx.lock();
+    return it->second;
+}
+
+/*
+ * Operations outside transactions wait while another thread runs a serialized
+ * transaction. The returned lock is empty if they don't have to.
+ */
+template<typename K, typename V, typename Selector>
+std::shared_lock<std::shared_timed_mutex> mockdb::kv_store<K, V, Selector>::lock_single() {
+    if (!this->read_selector->serializes_transactions() || this->tx_owner.load() == std::this_thread::get_id())
+        return std::shared_lock<std::shared_timed_mutex>(this->tx_lock, std::defer_lock);
+    return std::shared_lock<std::shared_timed_mutex>(this->tx_lock);
+}
+
+template<typename K, typename V, typename Selector>
+typename mockdb::kv_store<K, V, Selector>::stripe &mockdb::kv_store<K, V, Selector>::get_stripe(const K &key) {
+    return this->stripes[this->get_stripe_index(key)];
+}
+
+template<typename K, typename V, typename Selector>
+size_t mockdb::kv_store<K, V, Selector>::get_stripe_index(const K &key) const {
+    if (this->stripes.size() == 1)
+        return 0;
+    return std::hash<K>()(key) % this->stripes.size();
+}
+
+/*
+ * Locks the stripes of all keys in [first, last) in increasing order, so batches
+ * can't deadlock with each other. Returns the indices of the locked stripes.
+ */
+template<typename K, typename V, typename Selector>
+template <typename It, typename KeyOf>
+std::vector<size_t> mockdb::kv_store<K, V, Selector>::lock_stripes(It first, It last, KeyOf key_of) {
+    std::vector<size_t> locked;
+    for (It it = first; it != last; ++it)
+        locked.push_back(this->get_stripe_index(key_of(*it)));
+    std::sort(locked.begin(), locked.end());
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+    for (size_t i : locked)
+        this->stripes[i].mtx.lock();
+    return locked;
+}
+
+// Records an operation on key into the trace, if tracing is on
+template<typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::trace(trace_kind kind, const transaction<K, V> *tx, const K &key, long reads_from,
+                                   size_t version_number) {
+    if (tracer::enabled())
+        tracer::record(kind, this->trace_id, tx->get_tx_id(), tx->get_session_id(), std::hash<K>()(key), reads_from, version_number);
+}
+
+template<typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::unlock_stripes(const std::vector<size_t> &locked) {
+    for (auto it = locked.rbegin(); it != locked.rend(); ++it)
+        this->stripes[*it].mtx.unlock();
+}
+
+template<typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::set_gen_next_tx(Selector *get_next_tx) {
     this->read_selector = get_next_tx;
 }
 
-template<typename K, typename V>
-const std::list<mockdb::transaction<K, V>*> mockdb::kv_store<K, V>::get_history() const {
+template<typename K, typename V, typename Selector>
+void mockdb::kv_store<K, V, Selector>::set_instrumentation(instrumentation *metrics) {
+    this->metrics = metrics;
+    for (auto &s : this->stripes)
+        s.mtx.set_instrumentation(metrics);
+    this->read_selector->set_instrumentation(metrics);
+}
+
+template<typename K, typename V, typename Selector>
+mockdb::instrumentation *mockdb::kv_store<K, V, Selector>::get_instrumentation() const {
+    return this->metrics;
+}
+
+template<typename K, typename V, typename Selector>
+uint16_t mockdb::kv_store<K, V, Selector>::get_trace_id() const {
+    return this->trace_id;
+}
+
+template<typename K, typename V, typename Selector>
+const mockdb::history_log<K, V> &mockdb::kv_store<K, V, Selector>::get_history() const {
     return this->history;
 }
 
-template<typename K, typename V>
-const std::list<mockdb::transaction<K, V>*> mockdb::kv_store<K, V>::get_session_history(long session_id) const {
-    if (this->session_order.find(session_id) == this->session_order.end())
-        return std::list<transaction<K, V>*>();
-    return this->session_order.at(session_id);
+template<typename K, typename V, typename Selector>
+typename mockdb::history_log<K, V>::session_view mockdb::kv_store<K, V, Selector>::get_session_history(long session_id) const {
+    std::lock_guard<std::mutex> lck(this->history_mtx);
+    return this->history.get_session(session_id);
 }
 
 #endif //MOCK_KEY_VALUE_STORE_KV_STORE_H
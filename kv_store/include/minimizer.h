@@ -0,0 +1,120 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Shrinks failing inputs by delta debugging.
+
+#ifndef MOCK_KEY_VALUE_STORE_MINIMIZER_H
+#define MOCK_KEY_VALUE_STORE_MINIMIZER_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * ddmin (Zeller and Hildebrandt): given elements 0..count-1 of an input which
+     * makes a test fail, finds a subset which still fails and is 1-minimal, i.e.
+     * removing any single element makes the failure go away.
+     *
+     * The subset is split into n chunks; if one chunk alone, or the subset without
+     * one chunk, still fails, the search goes on from it, else with twice as many
+     * chunks. The candidates of one split are tested in parallel, each test must be
+     * independent of the others (fresh store, selector and scheduler). The first
+     * failing candidate in a fixed order is taken, so the result doesn't depend on
+     * the number of workers.
+     */
+    class minimizer {
+    public:
+        // True if the test still fails on the input made of the given elements, in order; must not throw
+        typedef std::function<bool(const std::vector<size_t> &)> predicate;
+
+        // 0 workers for one per core
+        minimizer(int workers = 0) {
+            if (workers <= 0)
+                workers = (int) std::thread::hardware_concurrency();
+            this->workers = workers < 1 ? 1 : workers;
+        }
+
+        std::vector<size_t> minimize(size_t count, const predicate &fails) {
+            std::vector<size_t> current(count);
+            std::iota(current.begin(), current.end(), 0);
+            if (count == 0 || this->test_all({std::vector<size_t>()}, fails) == 0)
+                return std::vector<size_t>();
+
+            size_t n = 2;
+            while (current.size() >= 2) {
+                n = std::min(n, current.size());
+                std::vector<std::vector<size_t>> candidates;
+                for (size_t i = 0; i < n; i++)
+                    candidates.push_back(chunk(current, n, i));
+                // With two chunks the complements are the chunks themselves
+                if (n > 2) {
+                    for (size_t i = 0; i < n; i++)
+                        candidates.push_back(complement(current, n, i));
+                }
+
+                size_t failing = this->test_all(candidates, fails);
+                if (failing < n) {
+                    current = candidates[failing];
+                    n = 2;
+                } else if (failing < candidates.size()) {
+                    current = candidates[failing];
+                    n = std::max(n - 1, (size_t) 2);
+                } else if (n == current.size()) {
+                    break;
+                } else {
+                    n *= 2;
+                }
+            }
+            return current;
+        }
+
+        // Tests run by the last calls to minimize
+        size_t get_test_count() const {
+            return this->tests;
+        }
+
+    private:
+        int workers;
+        size_t tests = 0;
+
+        // Index of the first failing candidate, candidates.size() if none fails
+        size_t test_all(const std::vector<std::vector<size_t>> &candidates, const predicate &fails) {
+            std::vector<char> failed(candidates.size(), 0);
+            std::atomic<size_t> next(0);
+            auto work = [&] {
+                for (size_t i = next++; i < candidates.size(); i = next++)
+                    failed[i] = fails(candidates[i]);
+            };
+
+            std::vector<std::thread> threads;
+            for (int w = 1; w < this->workers && (size_t) w < candidates.size(); w++)
+                threads.push_back(std::thread(work));
+            work();
+            for (auto &t : threads)
+                t.join();
+
+            this->tests += candidates.size();
+            return std::find(failed.begin(), failed.end(), 1) - failed.begin();
+        }
+
+        // Chunk i of n of elements
+        static std::vector<size_t> chunk(const std::vector<size_t> &elements, size_t n, size_t i) {
+            size_t first = elements.size() * i / n, last = elements.size() * (i + 1) / n;
+            return std::vector<size_t>(elements.begin() + first, elements.begin() + last);
+        }
+
+        static std::vector<size_t> complement(const std::vector<size_t> &elements, size_t n, size_t i) {
+            size_t first = elements.size() * i / n, last = elements.size() * (i + 1) / n;
+            std::vector<size_t> rest(elements.begin(), elements.begin() + first);
+            rest.insert(rest.end(), elements.begin() + last, elements.end());
+            return rest;
+        }
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_MINIMIZER_H
@@ -0,0 +1,66 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Pool for the transactions, operations, parameters and responses of a store.
+
+#ifndef MOCK_KEY_VALUE_STORE_OBJECT_POOL_H
+#define MOCK_KEY_VALUE_STORE_OBJECT_POOL_H
+
+#include "arena.h"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace mockdb {
+    /*
+     * Creates objects in an arena. Each object is preceded by a small header with its
+     * allocation size, so it can be destroyed through a pointer to a polymorphic base.
+     * Destroyed objects return their memory to the arena for reuse; whatever is left
+     * is released together with the arena. Not thread safe.
+     */
+    class object_pool {
+    public:
+        object_pool(arena *memory) {
+            this->memory = memory;
+            this->object_count = 0;
+        }
+
+        template <typename T, typename... Args>
+        T *create(Args &&... args) {
+            size_t size = sizeof(header) + sizeof(T);
+            header *h = static_cast<header *>(this->memory->allocate(size));
+            h->size = size;
+            T *p = new (h + 1) T(std::forward<Args>(args)...);
+            this->object_count++;
+            return p;
+        }
+
+        template <typename T>
+        void destroy(const T *p) {
+            if (p == nullptr)
+                return;
+            p->~T();
+            header *h = reinterpret_cast<header *>(const_cast<T *>(p)) - 1;
+            this->memory->deallocate(h, h->size);
+            this->object_count--;
+        }
+
+        // Number of live objects
+        size_t get_object_count() const {
+            return this->object_count;
+        }
+
+    private:
+        // 16 bytes, keeps the object max-aligned
+        struct header {
+            size_t size;
+            size_t reserved;
+        };
+
+        arena *memory;
+        size_t object_count;
+    };
+}
+#endif //MOCK_KEY_VALUE_STORE_OBJECT_POOL_H
@@ -10,28 +10,42 @@
 #include "operation_response.h"
 
 namespace mockdb {
+    // Kind of an operation as recorded in the history
+    enum class op_kind : unsigned char {
+        GET, PUT, REMOVE
+    };
+
+    /*
+     * The kind tag tells which subclass an operation is, so callers switch on it and
+     * static_cast instead of probing with dynamic_cast. The subclasses' typed getters
+     * hide the base ones and rely on the same invariant.
+     */
     template <typename K, typename V>
     class operation {
     public:
-        operation(operation_param<K, V>* params) {
+        operation(op_kind kind, operation_param<K, V>* params) {
+            this->kind = kind;
             this->params = params;
             this->response = nullptr;
         }
+        // Parameters and response are owned by the store which created the operation
         virtual ~operation() {
-            delete this->params;
-            delete this->response;
         }
 
-        virtual const operation_param<K, V>* get_params() const {
+        op_kind get_kind() const {
+            return this->kind;
+        }
+        const operation_param<K, V>* get_params() const {
             return this->params;
         }
-        virtual const operation_response<K, V>* get_response() const {
+        const operation_response<K, V>* get_response() const {
             return this->response;
         }
-        virtual void set_response(operation_response<K, V> *response) {
+        void set_response(operation_response<K, V> *response) {
             this->response = response;
         }
     protected:
+        op_kind kind;
         operation_param<K, V> *params;
         operation_response<K, V> *response;
     };
@@ -39,17 +53,17 @@ namespace mockdb {
     template <typename K, typename V>
     class GET_operation : public operation<K, V> {
     public:
-        GET_operation(GET_param<K, V>* params) : operation<K,V> (params) {
+        GET_operation(GET_param<K, V>* params) : operation<K,V> (op_kind::GET, params) {
 
         }
 
-        virtual const GET_param<K, V>* get_params() const {
-            return dynamic_cast<const GET_param<K, V>*>(this->params);
+        const GET_param<K, V>* get_params() const {
+            return static_cast<const GET_param<K, V>*>(this->params);
         }
-        virtual const GET_response<K, V>* get_response() const {
-            return dynamic_cast<const GET_response<K, V>*>(this->response);
+        const GET_response<K, V>* get_response() const {
+            return static_cast<const GET_response<K, V>*>(this->response);
         }
-        virtual void set_response(GET_response<K, V> *response) {
+        void set_response(GET_response<K, V> *response) {
             this->response = response;
         }
     };
@@ -57,17 +71,17 @@ namespace mockdb {
     template <typename K, typename V>
     class PUT_operation : public operation<K, V> {
     public:
-        PUT_operation(PUT_param<K, V>* params) : operation<K,V> (params) {
+        PUT_operation(PUT_param<K, V>* params) : operation<K,V> (op_kind::PUT, params) {
 
         }
 
-        virtual const PUT_param<K, V>* get_params() const {
-            return dynamic_cast<const PUT_param<K, V>*>(this->params);
+        const PUT_param<K, V>* get_params() const {
+            return static_cast<const PUT_param<K, V>*>(this->params);
         }
-        virtual const PUT_response<K, V>* get_response() const {
-            return dynamic_cast<const PUT_response<K, V>*>(this->response);
+        const PUT_response<K, V>* get_response() const {
+            return static_cast<const PUT_response<K, V>*>(this->response);
         }
-        virtual void set_response(PUT_response<K, V> *response) {
+        void set_response(PUT_response<K, V> *response) {
             this->response = response;
         }
     };
@@ -75,17 +89,17 @@ namespace mockdb {
     template <typename K, typename V>
     class REMOVE_operation : public operation<K, V> {
     public:
-        REMOVE_operation(REMOVE_param<K, V>* params) : operation<K,V> (params) {
+        REMOVE_operation(REMOVE_param<K, V>* params) : operation<K,V> (op_kind::REMOVE, params) {
 
         }
 
-        virtual const REMOVE_param<K, V>* get_params() const {
-            return dynamic_cast<const REMOVE_param<K, V>*>(this->params);
+        const REMOVE_param<K, V>* get_params() const {
+            return static_cast<const REMOVE_param<K, V>*>(this->params);
         }
-        virtual const REMOVE_response<K, V>* get_response() const {
-            return dynamic_cast<const REMOVE_response<K, V>*>(this->response);
+        const REMOVE_response<K, V>* get_response() const {
+            return static_cast<const REMOVE_response<K, V>*>(this->response);
         }
-        virtual void set_response(REMOVE_response<K, V> *response) {
+        void set_response(REMOVE_response<K, V> *response) {
             this->response = response;
         }
     };
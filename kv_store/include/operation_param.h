@@ -10,7 +10,7 @@ namespace mockdb {
     template <typename K, typename V>
     class operation_param {
     public:
-        virtual K get_key() const {
+        const K &get_key() const {
             return this->key;
         }
 
@@ -37,6 +37,10 @@ namespace mockdb {
             this->key = key;
             this->value = value;
         }
+
+        const V &get_value() const {
+            return this->value;
+        }
     private:
         V value;
     };
@@ -67,11 +67,73 @@ namespace mockdb {
         PUT_response(bool success) {
             this->success = success;
         }
+
+        void set_version_number(size_t v) {
+            version_number = v;
+        }
+
+        // Version created by the PUT
+        size_t get_version_number() const {
+            return version_number;
+        }
+
+    private:
+        size_t version_number;
     };
 
+    /*
+     * REMOVE reads the key like a GET and then writes a tombstone. If the version it
+     * reads is already a tombstone nothing is written and the response is unsuccessful.
+     */
     template <typename K, typename V>
     class REMOVE_response : public operation_response<K, V> {
+    public:
+        REMOVE_response(const K &k, const V &v, bool success) : key(k), value(v) {
+            this->success = success;
+            this->version_number = 0;
+        }
+
+        const K get_key() const {
+            return key;
+        }
 
+        // Value removed
+        const V get_value() const {
+            return value;
+        }
+
+        long get_written_by_tx_id() const {
+            return written_by_tx_id;
+        }
+
+        void set_written_by_tx_id(long tx_id) {
+            written_by_tx_id = tx_id;
+        }
+
+        // Version read before removing
+        size_t get_read_version_number() const {
+            return read_version_number;
+        }
+
+        void set_read_version_number(size_t v) {
+            read_version_number = v;
+        }
+
+        // Version of the tombstone, 0 if nothing was removed
+        size_t get_version_number() const {
+            return version_number;
+        }
+
+        void set_version_number(size_t v) {
+            version_number = v;
+        }
+
+    private:
+        const K key;
+        const V value;
+        long written_by_tx_id;
+        size_t read_version_number;
+        size_t version_number;
     };
 }
 
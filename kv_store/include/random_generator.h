@@ -0,0 +1,87 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Seedable pseudo random generator for read response selection.
+
+#ifndef MOCK_KEY_VALUE_STORE_RANDOM_GENERATOR_H
+#define MOCK_KEY_VALUE_STORE_RANDOM_GENERATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace mockdb {
+    // Seed for callers which don't ask for reproducible runs, different on every call
+    inline uint64_t random_seed() {
+        std::random_device device;
+        return ((uint64_t) device() << 32) ^ device();
+    }
+
+    /*
+     * SplitMix64 over an atomic counter: every call advances the counter by one step
+     * and hashes it, so concurrent callers never share a value and a single caller
+     * sees the same sequence for the same seed. Satisfies UniformRandomBitGenerator.
+     */
+    class random_generator {
+    public:
+        typedef uint64_t result_type;
+
+        random_generator(uint64_t seed = random_seed()) {
+            this->seed(seed);
+        }
+
+        void seed(uint64_t seed) {
+            this->initial_seed = seed;
+            this->state.store(seed);
+        }
+
+        uint64_t get_seed() const {
+            return this->initial_seed;
+        }
+
+        uint64_t next() {
+            uint64_t z = this->state.fetch_add(golden_gamma) + golden_gamma;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [0, n), n > 0
+        size_t uniform(size_t n) {
+            uint64_t limit = std::numeric_limits<uint64_t>::max() - std::numeric_limits<uint64_t>::max() % n;
+            uint64_t x;
+            do {
+                x = this->next();
+            } while (x >= limit);
+            return (size_t) (x % n);
+        }
+
+        // Uniform in [first, last]
+        size_t uniform(size_t first, size_t last) {
+            return first + this->uniform(last - first + 1);
+        }
+
+        result_type operator()() {
+            return this->next();
+        }
+
+        static constexpr result_type min() {
+            return 0;
+        }
+
+        static constexpr result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+    private:
+        static const uint64_t golden_gamma = 0x9E3779B97F4A7C15ULL;
+
+        std::atomic<uint64_t> state;
+        uint64_t initial_seed;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_RANDOM_GENERATOR_H
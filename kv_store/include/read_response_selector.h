@@ -10,19 +10,20 @@
 
 #include "kv_store.h"
 #include "consistency_checker.h"
+#include "random_generator.h"
 
 #include <list>
 #include <set>
 #include <unordered_map>
 #include <algorithm>
-#include <random>
 #include <numeric>
 
 namespace mockdb {
     template<typename K, typename V>
     class read_response_selector {
     public:
-        read_response_selector() {
+        // Runs with the same seed make the same choices for the same sequence of reads, by default every selector draws its own
+        read_response_selector(uint64_t seed = random_seed()) : random(seed) {
             this->store = nullptr;
         }
 
@@ -30,24 +31,94 @@ namespace mockdb {
 
         }
 
-        virtual void init_consistency_checker(const kv_store <K, V> *store) = 0;
+        virtual void init_consistency_checker(const kv_store_base<K, V> *store) = 0;
 
-        // By default it picks one transaction response at random
-        virtual GET_response<K, V> *select_read_response(transaction<K, V> *,
-                                                         GET_operation<K, V> *,
-                                                         std::vector<GET_response<K, V> *> candidates) {
-            int idx = std::rand() % candidates.size();
-            return candidates[idx];
+        // By default it picks one candidate at random, returns its index
+        virtual size_t select_read_response(transaction<K, V> *,
+                                            const operation<K, V> *,
+                                            const candidate_view<K, V> &candidates) {
+            return this->random.uniform(candidates.size());
+        }
+
+        /*
+         * Indices [first, last] of the candidates the read may return; first > last if
+         * there are none. Lets an explorer enumerate the choices instead of sampling.
+         */
+        virtual std::pair<size_t, size_t> admissible_range(transaction<K, V> *,
+                                                           const operation<K, V> *,
+                                                           const candidate_view<K, V> &candidates) {
+            return std::pair<size_t, size_t>(0, candidates.size() - 1);
+        }
+
+        /*
+         * Called by the store before it looks up the key of every read, so also for
+         * reads which find no key or no consistent version.
+         */
+        virtual void before_read(const transaction<K, V> *, const K &) {
+        }
+
+        // Called by the store for every read as it is made
+        virtual void on_read(const transaction<K, V> *) {
+        }
+
+        // Called by the store, in commit order, for every committed transaction
+        virtual void on_commit(const transaction<K, V> *) {
+        }
+
+        /*
+         * True if transactions must not interleave with any other operation; the
+         * store then runs them one at a time.
+         */
+        virtual bool serializes_transactions() const {
+            return false;
+        }
+
+        /*
+         * True if no read of key may return a version older than version_number any
+         * more. The store then drops those versions from chains ending in a tombstone.
+         */
+        virtual bool is_superseded(const K &, size_t) {
+            return false;
+        }
+
+        /*
+         * Declares every session which will read from the store. Selectors whose
+         * reads depend on what each session has seen only report versions
+         * superseded once all sessions are registered, as a session which hasn't
+         * read yet may still read them.
+         */
+        virtual void register_sessions(const std::vector<long> &) {
+        }
+
+        uint64_t get_seed() const {
+            return this->random.get_seed();
+        }
+
+        // Called by kv_store::set_instrumentation, selectors which wrap others pass it on
+        virtual void set_instrumentation(instrumentation *metrics) {
+            this->metrics = metrics;
         }
 
     protected:
-        const kv_store<K, V> *store;
+        const kv_store_base<K, V> *store;
+        random_generator random;
+        instrumentation *metrics = nullptr;
+
+        // Counts a query of the consistency checker, admitted tells if it admitted any version
+        void count_checker_query(bool admitted) {
+            if (this->metrics == nullptr)
+                return;
+            this->metrics->checker_invocations.fetch_add(1, std::memory_order_relaxed);
+            if (!admitted)
+                this->metrics->checker_rejections.fetch_add(1, std::memory_order_relaxed);
+        }
     };
 
+    // Final, so a kv_store of this selector type calls it without virtual dispatch
     template<typename K, typename V>
-    class causal_read_response_selector : public read_response_selector<K, V> {
+    class causal_read_response_selector final : public read_response_selector<K, V> {
     public:
-        causal_read_response_selector() {
+        causal_read_response_selector(uint64_t seed = random_seed()) : read_response_selector<K, V>(seed) {
             this->checker = nullptr;
         }
 
@@ -55,69 +126,93 @@ namespace mockdb {
             delete this->checker;
         }
 
-        void init_consistency_checker(const kv_store <K, V> *store) {
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
             this->store = store;
             this->checker = new causal_consistency_checker<K, V>(this->store);
         }
 
-        GET_response<K, V> *select_read_response(transaction<K, V> *tx,
-                                                 GET_operation<K, V> *op,
-                                                 std::vector<GET_response<K, V> *> candidates) {
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *op,
+                                    const candidate_view<K, V> &candidates) {
 
-            int limit = candidates.size();
+            // Sample uniformly among the admissible versions
+            std::pair<size_t, size_t> range = this->admissible_range(tx, op, candidates);
+            if (range.first > range.second) {
+                // No consistent transaction response possible
+                throw consistency_exception("GET", tx->get_tx_id());
+            }
+            return this->random.uniform(range.first, range.second);
+        }
 
-            std::random_device rd; // obtain a random number from hardware
-            std::mt19937 gen(rd()); // seed the generator
+        // Admissible versions form a suffix of the chain
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *tx,
+                                                   const operation<K, V> *,
+                                                   const candidate_view<K, V> &candidates) {
+            size_t first = candidates.get_index(this->checker->lowest_admissible_version(tx));
+            this->count_checker_query(first < candidates.size());
+            if (first >= candidates.size())
+                return std::pair<size_t, size_t>(1, 0);
+            return std::pair<size_t, size_t>(first, candidates.size() - 1);
+        }
 
-            while (limit > 0) {
-                int index = -1;
-                // Choose one candidate randomly
-                std::uniform_int_distribution<> dist(0, limit - 1);
-                index = dist(gen);
+        // The checker is exactly a causal_consistency_checker, its calls need no virtual dispatch
+        void on_read(const transaction<K, V> *tx) {
+            this->checker->causal_consistency_checker<K, V>::on_read(tx);
+        }
 
-                // Swap with the last element to not pick the same element again
-                swap(candidates[index], candidates[limit - 1]);
-                GET_response<K, V> *candidate = candidates[limit - 1];
-                limit--;
+        void on_commit(const transaction<K, V> *tx) {
+            this->checker->causal_consistency_checker<K, V>::on_commit(tx);
+        }
 
-                op->set_response(candidate);
-                if (checker->is_consistent(tx)) {
-                    return candidate;
-                }
-            }
+        bool is_superseded(const K &key, size_t version_number) {
+            return this->checker->causal_consistency_checker<K, V>::is_superseded(key, version_number);
+        }
 
-            // No consistent transaction response possible
-            op->set_response(nullptr);
-            throw consistency_exception("GET", tx->get_tx_id());
+        void register_sessions(const std::vector<long> &session_ids) {
+            this->checker->register_sessions(session_ids);
         }
 
     private:
-        consistency_checker<K, V> *checker;
+        causal_consistency_checker<K, V> *checker;
     };
 
+    // Final, so a kv_store of this selector type calls it without virtual dispatch
     template<typename K, typename V>
-    class linearizable_read_response_selector : public read_response_selector<K, V> {
+    class linearizable_read_response_selector final : public read_response_selector<K, V> {
     public:
-        linearizable_read_response_selector() {
+        linearizable_read_response_selector(uint64_t seed = random_seed()) : read_response_selector<K, V>(seed) {
         }
 
         ~linearizable_read_response_selector() {
         }
 
-        void init_consistency_checker(const kv_store<K, V> *store) {
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
             this->store = store;
         }
 
-        GET_response<K, V> *select_read_response(transaction<K, V> *tx,
-                                                 GET_operation<K, V> *op,
-                                                 std::vector<GET_response<K, V> *> candidates) {
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *,
+                                    const candidate_view<K, V> &candidates) {
             if (candidates.empty()) {
                 // No consistent transaction response possible
-                op->set_response(nullptr);
                 throw consistency_exception("GET", tx->get_tx_id());
             }
-            op->set_response(candidates.back());
-            return candidates.back();
+            return candidates.size() - 1;
+        }
+
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *,
+                                                   const operation<K, V> *,
+                                                   const candidate_view<K, V> &candidates) {
+            return std::pair<size_t, size_t>(candidates.size() - 1, candidates.size() - 1);
+        }
+
+        // Only the latest version is ever read
+        bool is_superseded(const K &, size_t) {
+            return true;
+        }
+
+        bool serializes_transactions() const {
+            return true;
         }
     };
 
@@ -125,10 +220,12 @@ namespace mockdb {
     template<typename K, typename V>
     class k_causal_read_response_selector : public read_response_selector<K, V> {
     public:
-        k_causal_read_response_selector(int k, int total_read_count) {
+        k_causal_read_response_selector(int k, int total_read_count, uint64_t seed = random_seed())
+                : read_response_selector<K, V>(seed) {
             this->k = k;
             this->total_read_count = total_read_count;
-            this->causal_selector = new causal_read_response_selector<K, V>();
+            // The causal reads draw from their own sequence
+            this->causal_selector = new causal_read_response_selector<K, V>(this->random.next());
             this->linearizable_selector = new linearizable_read_response_selector<K, V>();
         }
 
@@ -137,27 +234,60 @@ namespace mockdb {
             delete this->linearizable_selector;
         }
 
-        void init_consistency_checker(const kv_store<K, V> *store) {
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
             this->causal_selector->init_consistency_checker(store);
             this->linearizable_selector->init_consistency_checker(store);
             // Pick k causal reads
             pick_k_read_ids();
         }
 
-        GET_response<K, V> *select_read_response(transaction<K, V> *tx,
-                                                 GET_operation<K, V> *op,
-                                                 std::vector<GET_response<K, V> *> candidates) {
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *op,
+                                    const candidate_view<K, V> &candidates) {
 
-            this->read_count++;
-            if (this->k_read_ids.find(this->read_count) != this->k_read_ids.end()) {
+            int read_id = ++(this->read_count);
+            if (this->k_read_ids.find(read_id) != this->k_read_ids.end()) {
                 return this->causal_selector->select_read_response(tx, op, candidates);
             }
             return this->linearizable_selector->select_read_response(tx, op, candidates);
         }
 
+        // Counts as a read like select_read_response
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *tx,
+                                                   const operation<K, V> *op,
+                                                   const candidate_view<K, V> &candidates) {
+            int read_id = ++(this->read_count);
+            if (this->k_read_ids.find(read_id) != this->k_read_ids.end()) {
+                return this->causal_selector->admissible_range(tx, op, candidates);
+            }
+            return this->linearizable_selector->admissible_range(tx, op, candidates);
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            this->causal_selector->on_read(tx);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            this->causal_selector->on_commit(tx);
+        }
+
+        void set_instrumentation(instrumentation *metrics) {
+            this->metrics = metrics;
+            this->causal_selector->set_instrumentation(metrics);
+            this->linearizable_selector->set_instrumentation(metrics);
+        }
+
+        bool is_superseded(const K &key, size_t version_number) {
+            return this->causal_selector->is_superseded(key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            this->causal_selector->register_sessions(session_ids);
+        }
+
     private:
         int k, total_read_count;
-        int read_count = 0;
+        std::atomic<int> read_count{0};
         std::unordered_set<int> k_read_ids;
         causal_read_response_selector<K, V> *causal_selector;
         linearizable_read_response_selector<K, V> *linearizable_selector;
@@ -165,9 +295,177 @@ namespace mockdb {
         void pick_k_read_ids() {
             std::vector<int> read_ids(this->total_read_count);
             std::iota(read_ids.begin(), read_ids.end(), 1);
-            std::shuffle(read_ids.begin(), read_ids.end(), std::mt19937{std::random_device{}()});
+            std::shuffle(read_ids.begin(), read_ids.end(), this->random);
             k_read_ids.insert(read_ids.begin(), read_ids.begin() + this->k);
         }
     };
+
+    /*
+     * Samples uniformly among the versions a consistency checker admits. Base of the
+     * isolation levels below, each of which only creates its checker.
+     */
+    template<typename K, typename V>
+    class checked_read_response_selector : public read_response_selector<K, V> {
+    public:
+        checked_read_response_selector(uint64_t seed = random_seed()) : read_response_selector<K, V>(seed) {
+            this->checker = nullptr;
+        }
+
+        ~checked_read_response_selector() {
+            delete this->checker;
+        }
+
+        void init_consistency_checker(const kv_store_base<K, V> *store) {
+            this->store = store;
+            this->checker = this->create_checker(store);
+        }
+
+        size_t select_read_response(transaction<K, V> *tx,
+                                    const operation<K, V> *op,
+                                    const candidate_view<K, V> &candidates) {
+            std::pair<size_t, size_t> range = this->admissible_range(tx, op, candidates);
+            if (range.first > range.second) {
+                // No consistent transaction response possible
+                throw consistency_exception("GET", tx->get_tx_id());
+            }
+            return this->random.uniform(range.first, range.second);
+        }
+
+        std::pair<size_t, size_t> admissible_range(transaction<K, V> *tx,
+                                                   const operation<K, V> *,
+                                                   const candidate_view<K, V> &candidates) {
+            if (candidates.empty())
+                return std::pair<size_t, size_t>(1, 0);
+            std::pair<size_t, size_t> versions = this->checker->admissible_versions(tx, candidates);
+            // Versions dropped by compaction can't be returned
+            bool admitted = versions.first <= versions.second && versions.second >= candidates.get_version_number(0);
+            this->count_checker_query(admitted);
+            if (!admitted)
+                return std::pair<size_t, size_t>(1, 0);
+            return std::pair<size_t, size_t>(candidates.get_index(versions.first),
+                                             candidates.get_index(versions.second));
+        }
+
+        void on_read(const transaction<K, V> *tx) {
+            this->checker->on_read(tx);
+        }
+
+        void on_commit(const transaction<K, V> *tx) {
+            this->checker->on_commit(tx);
+        }
+
+        bool is_superseded(const K &key, size_t version_number) {
+            return this->checker->is_superseded(key, version_number);
+        }
+
+        void register_sessions(const std::vector<long> &session_ids) {
+            this->checker->register_sessions(session_ids);
+        }
+
+    protected:
+        consistency_checker<K, V> *checker;
+
+        virtual consistency_checker<K, V> *create_checker(const kv_store_base<K, V> *store) = 0;
+    };
+
+    template<typename K, typename V>
+    class read_committed_read_response_selector : public checked_read_response_selector<K, V> {
+    public:
+        read_committed_read_response_selector(uint64_t seed = random_seed()) : checked_read_response_selector<K, V>(seed) {
+        }
+
+    protected:
+        consistency_checker<K, V> *create_checker(const kv_store_base<K, V> *store) {
+            return new read_committed_checker<K, V>(store);
+        }
+    };
+
+    template<typename K, typename V>
+    class read_atomic_read_response_selector : public checked_read_response_selector<K, V> {
+    public:
+        read_atomic_read_response_selector(uint64_t seed = random_seed()) : checked_read_response_selector<K, V>(seed) {
+        }
+
+    protected:
+        consistency_checker<K, V> *create_checker(const kv_store_base<K, V> *store) {
+            return new read_atomic_checker<K, V>(store);
+        }
+    };
+
+    // Any combination of session guarantees, see session_guarantee
+    template<typename K, typename V>
+    class session_guarantee_read_response_selector : public checked_read_response_selector<K, V> {
+    public:
+        session_guarantee_read_response_selector(unsigned guarantees, uint64_t seed = random_seed())
+                : checked_read_response_selector<K, V>(seed) {
+            this->guarantees = guarantees;
+        }
+
+    protected:
+        consistency_checker<K, V> *create_checker(const kv_store_base<K, V> *store) {
+            return new session_guarantee_checker<K, V>(store, this->guarantees);
+        }
+
+    private:
+        unsigned guarantees;
+    };
+
+    template<typename K, typename V>
+    class read_your_writes_read_response_selector : public session_guarantee_read_response_selector<K, V> {
+    public:
+        read_your_writes_read_response_selector(uint64_t seed = random_seed())
+                : session_guarantee_read_response_selector<K, V>(READ_YOUR_WRITES, seed) {
+        }
+    };
+
+    template<typename K, typename V>
+    class monotonic_reads_read_response_selector : public session_guarantee_read_response_selector<K, V> {
+    public:
+        monotonic_reads_read_response_selector(uint64_t seed = random_seed())
+                : session_guarantee_read_response_selector<K, V>(MONOTONIC_READS, seed) {
+        }
+    };
+
+    template<typename K, typename V>
+    class monotonic_writes_read_response_selector : public session_guarantee_read_response_selector<K, V> {
+    public:
+        monotonic_writes_read_response_selector(uint64_t seed = random_seed())
+                : session_guarantee_read_response_selector<K, V>(MONOTONIC_WRITES, seed) {
+        }
+    };
+
+    template<typename K, typename V>
+    class writes_follow_reads_read_response_selector : public session_guarantee_read_response_selector<K, V> {
+    public:
+        writes_follow_reads_read_response_selector(uint64_t seed = random_seed())
+                : session_guarantee_read_response_selector<K, V>(WRITES_FOLLOW_READS, seed) {
+        }
+    };
+
+    template<typename K, typename V>
+    class snapshot_isolation_read_response_selector : public checked_read_response_selector<K, V> {
+    public:
+        snapshot_isolation_read_response_selector(uint64_t seed = random_seed()) : checked_read_response_selector<K, V>(seed) {
+        }
+
+    protected:
+        consistency_checker<K, V> *create_checker(const kv_store_base<K, V> *store) {
+            return new snapshot_isolation_checker<K, V>(store);
+        }
+    };
+
+    // The snapshots are drawn from their own sequence
+    template<typename K, typename V>
+    class parallel_snapshot_isolation_read_response_selector : public checked_read_response_selector<K, V> {
+    public:
+        parallel_snapshot_isolation_read_response_selector(uint64_t seed = random_seed())
+                : checked_read_response_selector<K, V>(seed) {
+        }
+
+    protected:
+        consistency_checker<K, V> *create_checker(const kv_store_base<K, V> *store) {
+            return new parallel_snapshot_isolation_checker<K, V>(store, this->random.next());
+        }
+    };
 }
 #endif //MOCK_KEY_VALUE_STORE_READ_RESPONSE_SELECTOR_H
@@ -0,0 +1,147 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Seedable randomized scheduling of sessions.
+
+#ifndef MOCK_KEY_VALUE_STORE_SESSION_SCHEDULER_H
+#define MOCK_KEY_VALUE_STORE_SESSION_SCHEDULER_H
+
+#include "cooperative_runner.h"
+#include "random_generator.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace mockdb {
+    /*
+     * Runs sessions under a cooperative_runner, picking the session of each step with
+     * a seeded generator, so the same seed and program always give the same schedule.
+     *
+     * Policies:
+     *  - RANDOM: the next session is uniform among the enabled ones.
+     *  - PCT: probabilistic concurrency testing. Sessions get distinct random
+     *    priorities and the enabled one with the highest always runs. At depth - 1
+     *    random steps, the session which ran the step drops below every initial
+     *    priority. A bug needing depth ordering constraints among n sessions and k
+     *    steps is hit with probability at least 1 / (n * k^(depth - 1)). Change points
+     *    are drawn over the longest run of this scheduler so far, at least
+     *    expected_steps; a scheduler created per run needs a bound on the steps of
+     *    the run passed in as expected_steps.
+     *  - REPLAY: follows a recorded schedule, see decision_log. Once the recorded
+     *    session isn't enabled, or the schedule runs out, the run has diverged and
+     *    continues with the enabled session of lowest index.
+     */
+    class session_scheduler : public cooperative_runner {
+    public:
+        enum class policy {
+            RANDOM,
+            PCT,
+            REPLAY
+        };
+
+        session_scheduler(uint64_t seed = random_seed(), policy p = policy::RANDOM, size_t depth = 3,
+                          size_t expected_steps = 16) : random(seed) {
+            this->p = p;
+            this->depth = depth < 1 ? 1 : depth;
+            this->expected_steps = expected_steps < 1 ? 1 : expected_steps;
+        }
+
+        // Replays schedule
+        session_scheduler(const std::vector<size_t> &schedule) : random(0) {
+            this->p = policy::REPLAY;
+            this->depth = 1;
+            this->expected_steps = 1;
+            this->replayed = schedule;
+        }
+
+        // Runs the sessions to completion, each in its own thread
+        void run(const std::vector<std::function<void()>> &sessions) {
+            this->schedule.clear();
+            this->diverged = false;
+            if (this->p == policy::PCT) {
+                this->priorities.resize(sessions.size());
+                for (size_t i = 0; i < sessions.size(); i++)
+                    this->priorities[i] = this->depth + i;
+                // Fisher-Yates on our generator, std::shuffle differs between libraries
+                for (size_t i = sessions.size(); i > 1; i--)
+                    std::swap(this->priorities[i - 1], this->priorities[this->random.uniform(i)]);
+
+                this->change_points.clear();
+                for (size_t i = 1; i < this->depth; i++)
+                    this->change_points.push_back(this->random.uniform(1, this->expected_steps));
+            }
+
+            this->run_sessions(sessions);
+            this->expected_steps = std::max(this->expected_steps, this->schedule.size());
+            this->runs++;
+        }
+
+        // Sessions of the steps of the last run, in order
+        const std::vector<size_t> &get_schedule() const {
+            return this->schedule;
+        }
+
+        size_t get_run_count() const {
+            return this->runs;
+        }
+
+        uint64_t get_seed() const {
+            return this->random.get_seed();
+        }
+
+        // True if the last run didn't follow the replayed schedule, or didn't use all of it
+        bool has_diverged() const {
+            return this->diverged || (this->p == policy::REPLAY && this->schedule.size() < this->replayed.size());
+        }
+
+    protected:
+        size_t pick(const std::vector<size_t> &enabled) {
+            size_t session = enabled.front();
+            if (this->p == policy::RANDOM) {
+                session = enabled[this->random.uniform(enabled.size())];
+            } else if (this->p == policy::REPLAY) {
+                size_t step = this->schedule.size();
+                if (!this->diverged && step < this->replayed.size() &&
+                    std::find(enabled.begin(), enabled.end(), this->replayed[step]) != enabled.end())
+                    session = this->replayed[step];
+                else
+                    this->diverged = true;
+            } else {
+                for (size_t s : enabled) {
+                    if (this->priorities[s] > this->priorities[session])
+                        session = s;
+                }
+            }
+            this->schedule.push_back(session);
+            return session;
+        }
+
+        void after_step(size_t session) {
+            if (this->p != policy::PCT)
+                return;
+            // Change point i lowers the priority to depth - 1 - i, below all initial ones
+            for (size_t i = 0; i < this->change_points.size(); i++) {
+                if (this->change_points[i] == this->schedule.size())
+                    this->priorities[session] = this->depth - 1 - i;
+            }
+        }
+
+    private:
+        random_generator random;
+        policy p;
+        size_t depth;
+        size_t expected_steps;
+        size_t runs = 0;
+
+        std::vector<size_t> schedule;
+        std::vector<size_t> priorities;         // PCT priority of each session
+        std::vector<size_t> change_points;      // Steps after which the running session is lowered
+        std::vector<size_t> replayed;           // Schedule followed by REPLAY
+        bool diverged = false;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_SESSION_SCHEDULER_H
@@ -0,0 +1,333 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Binary trace of store events, recorded into per-thread ring buffers.
+
+#ifndef MOCK_KEY_VALUE_STORE_TRACE_BUFFER_H
+#define MOCK_KEY_VALUE_STORE_TRACE_BUFFER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mockdb {
+    enum class trace_kind : uint16_t {
+        TX_CREATED, BEGIN, COMMIT, GET, PUT, REMOVE, NOT_FOUND, INCONSISTENT,
+        HTTP_GET, HTTP_POST, HTTP_DELETE, ETAG_MISMATCH, LOCK_WAIT, STORE_CLOSED
+    };
+
+    inline const char *trace_kind_name(trace_kind kind) {
+        static const char *names[] = {
+                "TX_CREATED", "BEGIN", "COMMIT", "GET", "PUT", "REMOVE", "NOT_FOUND", "INCONSISTENT",
+                "HTTP_GET", "HTTP_POST", "HTTP_DELETE", "ETAG_MISMATCH", "LOCK_WAIT", "STORE_CLOSED"};
+        size_t i = (size_t) kind;
+        return i < sizeof(names) / sizeof(names[0]) ? names[i] : "UNKNOWN";
+    }
+
+    // One event, written to trace files as is
+    struct trace_event {
+        uint64_t timestamp;         // Nanoseconds of the steady clock
+        int64_t tx_id;
+        int64_t session_id;
+        int64_t reads_from;         // Transaction which wrote the version read, 0 if none
+        uint64_t key_hash;          // std::hash of the key, 0 if none
+        uint64_t version_number;    // Version read or written, operation count for COMMIT
+        uint64_t duration;          // Nanoseconds, for events which span time ending at timestamp
+        uint32_t thread;            // Index of the recording thread, in order of first event
+        trace_kind kind;
+        uint16_t store;             // Trace id of the store, 0 if none; ids wrap around
+    };
+
+    static_assert(sizeof(trace_event) == 64, "Trace events are one cache line");
+
+    /*
+     * Single-producer single-consumer ring of events: the owning thread pushes, the
+     * flusher drains. Full rings drop events rather than wait.
+     */
+    class trace_ring {
+    public:
+        // capacity is rounded up to a power of two
+        trace_ring(size_t capacity, uint32_t thread) : thread(thread) {
+            size_t size = 1;
+            while (size < capacity)
+                size *= 2;
+            this->events.resize(size);
+            this->mask = size - 1;
+        }
+
+        bool push(const trace_event &event) {
+            uint64_t head = this->head.load(std::memory_order_relaxed);
+            if (head - this->tail.load(std::memory_order_acquire) == this->events.size()) {
+                this->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            this->events[head & this->mask] = event;
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Appends the events pushed so far to out, returns their number
+        size_t drain(std::vector<trace_event> &out) {
+            uint64_t tail = this->tail.load(std::memory_order_relaxed);
+            uint64_t head = this->head.load(std::memory_order_acquire);
+            for (uint64_t i = tail; i < head; i++)
+                out.push_back(this->events[i & this->mask]);
+            this->tail.store(head, std::memory_order_release);
+            return (size_t) (head - tail);
+        }
+
+        uint64_t get_dropped() const {
+            return this->dropped.load(std::memory_order_relaxed);
+        }
+
+        const uint32_t thread;
+        std::atomic<bool> retired{false};  // The owning thread has exited
+
+    private:
+        std::vector<trace_event> events;
+        size_t mask;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    template <typename T = void>
+    struct trace_globals {
+        static std::atomic<bool> active;
+        static std::atomic<uint16_t> last_store;
+    };
+
+    template <typename T>
+    std::atomic<bool> trace_globals<T>::active{false};
+
+    template <typename T>
+    std::atomic<uint16_t> trace_globals<T>::last_store{0};
+
+    /*
+     * Process-wide trace. While started, record pushes events to a ring of the
+     * calling thread, created on its first event, and a flusher thread appends them
+     * to the trace file every few milliseconds. Events are in order per thread,
+     * not across threads; the decoder sorts them by timestamp if asked to.
+     *
+     * File format: the 8 bytes "MOCKTRC1", the size of an event as uint32, 4 zero
+     * bytes, then trace_event structs in native byte order.
+     */
+    class tracer {
+    public:
+        static tracer &instance() {
+            static tracer t;
+            return t;
+        }
+
+        // One relaxed load, the only cost of a trace point while tracing is off
+        static bool enabled() {
+            return trace_globals<>::active.load(std::memory_order_relaxed);
+        }
+
+        static void record(trace_kind kind, uint16_t store, long tx_id, long session_id, uint64_t key_hash,
+                           long reads_from = 0, uint64_t version_number = 0, uint64_t duration = 0) {
+            trace_event event;
+            event.timestamp = now();
+            event.tx_id = tx_id;
+            event.session_id = session_id;
+            event.reads_from = reads_from;
+            event.key_hash = key_hash;
+            event.version_number = version_number;
+            event.duration = duration;
+            event.kind = kind;
+            event.store = store;
+            trace_ring *ring = instance().local_ring();
+            event.thread = ring->thread;
+            ring->push(event);
+        }
+
+        // Distinguishes the events of stores which exist at the same time, never 0
+        static uint16_t next_store_id() {
+            uint16_t id = ++trace_globals<>::last_store;
+            return id == 0 ? ++trace_globals<>::last_store : id;
+        }
+
+        static uint64_t now() {
+            return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /*
+         * Opens path and starts tracing, rings created from now on hold
+         * events_per_thread events. Throws std::runtime_error if the file can't be
+         * opened or tracing is already started.
+         */
+        void start(const std::string &path, size_t events_per_thread = 1 << 14) {
+            std::lock_guard<std::mutex> lck(this->control_mtx);
+            if (this->flusher.joinable())
+                throw std::runtime_error("Trace already started");
+            this->out.open(path, std::ios::binary | std::ios::trunc);
+            if (!this->out)
+                throw std::runtime_error("Can't open trace file " + path);
+            uint32_t header[2] = {(uint32_t) sizeof(trace_event), 0};
+            this->out.write("MOCKTRC1", 8);
+            this->out.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+            {
+                // Events left over from an earlier trace are discarded
+                std::lock_guard<std::mutex> rings_lck(this->rings_mtx);
+                std::vector<trace_event> discarded;
+                for (auto &ring : this->rings)
+                    ring->drain(discarded);
+                this->capacity = events_per_thread;
+                this->stopping = false;
+            }
+            this->written = 0;
+            this->flusher = std::thread(&tracer::flush_loop, this);
+            trace_globals<>::active.store(true);
+        }
+
+        // Stops tracing, writes the remaining events and closes the file
+        void stop() {
+            std::lock_guard<std::mutex> lck(this->control_mtx);
+            if (!this->flusher.joinable())
+                return;
+            trace_globals<>::active.store(false);
+            {
+                std::lock_guard<std::mutex> rings_lck(this->rings_mtx);
+                this->stopping = true;
+            }
+            this->wake.notify_all();
+            this->flusher.join();
+            this->out.close();
+        }
+
+        // Events dropped because a ring was full, over all threads
+        uint64_t get_dropped() const {
+            std::lock_guard<std::mutex> lck(this->rings_mtx);
+            return this->dropped_retired + sum_dropped();
+        }
+
+        // Events written to the file by the current or last trace
+        uint64_t get_written() const {
+            return this->written.load();
+        }
+
+        ~tracer() {
+            this->stop();
+        }
+
+    private:
+        // Marks the ring of its thread retired when the thread exits
+        struct ring_owner {
+            std::shared_ptr<trace_ring> ring;
+
+            ~ring_owner() {
+                if (ring)
+                    ring->retired.store(true);
+            }
+        };
+
+        std::mutex control_mtx;                 // Serializes start and stop
+        mutable std::mutex rings_mtx;
+        std::condition_variable wake;
+        std::vector<std::shared_ptr<trace_ring>> rings;     // Guarded by rings_mtx
+        size_t capacity = 1 << 14;
+        uint32_t next_thread = 0;
+        uint64_t dropped_retired = 0;           // Drops of rings already freed
+        bool stopping = false;
+        std::thread flusher;
+        std::ofstream out;
+        std::atomic<uint64_t> written{0};
+
+        tracer() {
+        }
+
+        trace_ring *local_ring() {
+            static thread_local ring_owner owner;
+            if (!owner.ring) {
+                std::lock_guard<std::mutex> lck(this->rings_mtx);
+                owner.ring = std::make_shared<trace_ring>(this->capacity, this->next_thread++);
+                this->rings.push_back(owner.ring);
+            }
+            return owner.ring.get();
+        }
+
+        uint64_t sum_dropped() const {
+            uint64_t dropped = 0;
+            for (auto &ring : this->rings)
+                dropped += ring->get_dropped();
+            return dropped;
+        }
+
+        void flush_loop() {
+            std::vector<trace_event> batch;
+            std::unique_lock<std::mutex> lck(this->rings_mtx);
+            while (true) {
+                bool last = this->stopping;
+                batch.clear();
+                for (size_t i = 0; i < this->rings.size();) {
+                    this->rings[i]->drain(batch);
+                    // Nothing is pushed to a retired ring any more once it is drained
+                    if (this->rings[i]->retired.load()) {
+                        this->rings[i]->drain(batch);
+                        this->dropped_retired += this->rings[i]->get_dropped();
+                        this->rings[i] = this->rings.back();
+                        this->rings.pop_back();
+                    } else {
+                        i++;
+                    }
+                }
+
+                // Threads register their rings while the file is written
+                lck.unlock();
+                if (!batch.empty()) {
+                    this->out.write(reinterpret_cast<const char *>(batch.data()),
+                                    (std::streamsize) (batch.size() * sizeof(trace_event)));
+                    this->written += batch.size();
+                }
+                lck.lock();
+                if (last)
+                    break;
+                this->wake.wait_for(lck, std::chrono::milliseconds(10));
+            }
+            this->out.flush();
+        }
+    };
+
+    // Reads the events of a trace file in file order
+    class trace_reader {
+    public:
+        // Throws std::runtime_error if in doesn't hold a trace
+        trace_reader(std::istream &in) : in(in) {
+            char magic[8];
+            uint32_t header[2];
+            if (!in.read(magic, 8) || std::memcmp(magic, "MOCKTRC1", 8) != 0 ||
+                !in.read(reinterpret_cast<char *>(header), sizeof(header)))
+                throw std::runtime_error("Not a trace");
+            if (header[0] != sizeof(trace_event))
+                throw std::runtime_error("Trace: events of " + std::to_string(header[0]) + " bytes");
+        }
+
+        // False at the end of the trace, throws std::runtime_error if the last event is cut off
+        bool next(trace_event &event) {
+            if (!this->in.read(reinterpret_cast<char *>(&event), sizeof(event))) {
+                if (this->in.gcount() != 0)
+                    throw std::runtime_error("Trace: truncated event");
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        std::istream &in;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_TRACE_BUFFER_H
@@ -7,25 +7,26 @@
 #define MOCK_KEY_VALUE_STORE_TRANSACTION_H
 
 #include "operation.h"
+#include "trace_buffer.h"
 
-#include <atomic>
 #include <iostream>
+#include <vector>
 
 namespace mockdb {
     template <typename K, typename V>
     class transaction {
     public:
-        transaction(operation<K, V> *op) {
-            this->tx_id = this->generate_tx_id();
+        // Ids are allocated by the store, see tx_id_allocator
+        transaction(long tx_id, operation<K, V> *op) {
+            this->tx_id = tx_id;
             this->op = op;
-#ifdef MOCKDB_DEBUG_LOG
-            std::cout << "[MOCKDB::kvstore] New transaction created ID: "
-                        << this->tx_id << std::endl;
-#endif // MOCKDB_DEBUG_LOG
+            // The session and store are unknown here
+            if (tracer::enabled())
+                tracer::record(trace_kind::TX_CREATED, 0, tx_id, 0, 0);
         }
 
+        // The operation is owned by the store which created the transaction
         virtual ~transaction() {
-            delete this->op;
         }
 
         virtual void start_transaction() {}
@@ -35,25 +36,24 @@ namespace mockdb {
         long get_tx_id() const;
         const operation<K, V> *get_operation() const;
         void set_operation(operation<K, V> *op);
+
+        /*
+         * Operations of a multi-operation transaction, in program order. The last one
+         * added becomes the current operation returned by get_operation.
+         */
+        void add_operation(operation<K, V> *op);
+        size_t get_operation_count() const;
+        const operation<K, V> *get_operation(size_t index) const;
         long get_session_id() const;
         void set_session_id(long session_id);
 
     protected:
-        static std::atomic_long tx_count;
         long tx_id, session_id;
         operation<K, V> *op;
-
-    private:
-        long generate_tx_id() {
-            return ++(this->tx_count);
-        }
+        std::vector<operation<K, V>*> ops;  // Empty while the transaction has a single operation
     };
 }
 
-// Initialize static variable
-template <typename K, typename V>
-std::atomic_long mockdb::transaction<K, V>::tx_count(0);
-
 template <typename K, typename V>
 long mockdb::transaction<K, V>::get_tx_id() const {
     return tx_id;
@@ -75,8 +75,30 @@ const mockdb::operation<K, V> *mockdb::transaction<K, V>::get_operation() const
 }
 
 template <typename K, typename V>
-void mockdb::transaction<K, V>::set_operation(mockdb::operation<K, V> *operation) {
+void mockdb::transaction<K, V>::set_operation(mockdb::operation<K, V> *op) {
     this->op = op;
 }
 
+template <typename K, typename V>
+void mockdb::transaction<K, V>::add_operation(mockdb::operation<K, V> *op) {
+    if (this->ops.empty() && this->op != nullptr)
+        this->ops.push_back(this->op);
+    this->ops.push_back(op);
+    this->op = op;
+}
+
+template <typename K, typename V>
+size_t mockdb::transaction<K, V>::get_operation_count() const {
+    if (this->ops.empty())
+        return this->op == nullptr ? 0 : 1;
+    return this->ops.size();
+}
+
+template <typename K, typename V>
+const mockdb::operation<K, V> *mockdb::transaction<K, V>::get_operation(size_t index) const {
+    if (this->ops.empty())
+        return this->op;
+    return this->ops[index];
+}
+
 #endif //MOCK_KEY_VALUE_STORE_TRANSACTION_H
@@ -0,0 +1,77 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Allocates the transaction ids of a store.
+
+#ifndef MOCK_KEY_VALUE_STORE_TX_ID_ALLOCATOR_H
+#define MOCK_KEY_VALUE_STORE_TX_ID_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace mockdb {
+    /*
+     * Hands out unique, positive transaction ids. Each thread takes a block of
+     * consecutive ids from the shared counter and allocates from it without
+     * synchronization, so threads only meet on the counter once per block. A thread
+     * caches blocks of its last cached_blocks allocators; a block evicted from the
+     * cache leaves the rest of its ids unused.
+     *
+     * Ids are unique but only ordered within a thread. They don't depend on other
+     * allocators, so a store driven by one thread always gets 1, 2, 3, ...
+     */
+    class tx_id_allocator {
+    public:
+        tx_id_allocator(long block_size = 64) {
+            this->block_size = block_size < 1 ? 1 : block_size;
+            this->id = ++allocator_count();
+        }
+
+        static const size_t cached_blocks = 8;
+
+        long next() {
+            static thread_local block cache[cached_blocks];
+            static thread_local size_t evict = 0;
+
+            block *cached = nullptr;
+            for (size_t i = 0; i < cached_blocks && cached == nullptr; i++) {
+                if (cache[i].allocator_id == this->id)
+                    cached = &cache[i];
+            }
+            if (cached == nullptr) {
+                cached = &cache[evict];
+                evict = (evict + 1) % cached_blocks;
+                cached->allocator_id = this->id;
+                cached->next = cached->end = 0;
+            }
+            if (cached->next == cached->end) {
+                cached->next = this->next_block.fetch_add(this->block_size);
+                cached->end = cached->next + this->block_size;
+            }
+            return cached->next++;
+        }
+
+        long get_block_size() const {
+            return this->block_size;
+        }
+
+    private:
+        struct block {
+            unsigned long allocator_id = 0;
+            long next = 0, end = 0;
+        };
+
+        // Allocators are told apart by id, an address may be reused by a later allocator
+        static std::atomic<unsigned long> &allocator_count() {
+            static std::atomic<unsigned long> count(0);
+            return count;
+        }
+
+        std::atomic_long next_block{1};
+        long block_size;
+        unsigned long id;
+    };
+}
+
+#endif //MOCK_KEY_VALUE_STORE_TX_ID_ALLOCATOR_H
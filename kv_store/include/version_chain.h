@@ -0,0 +1,114 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Versions of a single key, oldest first.
+
+#ifndef MOCK_KEY_VALUE_STORE_VERSION_CHAIN_H
+#define MOCK_KEY_VALUE_STORE_VERSION_CHAIN_H
+
+#include "arena.h"
+
+#include <vector>
+
+namespace mockdb {
+    template <typename V>
+    struct version {
+        V value;
+        long tx_id;     // Transaction which wrote this version
+        bool tombstone; // Written by REMOVE, value is empty
+    };
+
+    /*
+     * Versions are stored contiguously in an arena-backed vector, so a version can be
+     * looked up directly by its number. Version numbers start from 1 and keep growing
+     * when compaction drops old versions; index 0 is the oldest version kept.
+     */
+    template <typename V>
+    class version_chain {
+    public:
+        typedef typename std::vector<version<V>, arena_allocator<version<V>>>::const_iterator const_iterator;
+
+        version_chain(arena *memory) : versions(arena_allocator<version<V>>(memory)) {
+            this->base = 0;
+        }
+
+        // Appends a new version and returns its version number
+        size_t append(const V &value, long tx_id) {
+            this->versions.push_back({value, tx_id, false});
+            return this->base + this->versions.size();
+        }
+
+        // Appends a tombstone and returns its version number
+        size_t append_tombstone(long tx_id) {
+            this->versions.push_back({V(), tx_id, true});
+            return this->base + this->versions.size();
+        }
+
+        /*
+         * Drops all versions older than version_number and releases their memory.
+         * Numbers of the remaining versions don't change.
+         */
+        void compact(size_t version_number) {
+            if (version_number <= this->base + 1)
+                return;
+            size_t dropped = version_number - this->base - 1;
+            if (dropped > this->versions.size())
+                dropped = this->versions.size();
+            std::vector<version<V>, arena_allocator<version<V>>> kept(this->versions.begin() + dropped,
+                                                                       this->versions.end(),
+                                                                       this->versions.get_allocator());
+            this->versions.swap(kept);
+            this->base += dropped;
+        }
+
+        // Number of versions kept
+        size_t size() const {
+            return this->versions.size();
+        }
+
+        bool empty() const {
+            return this->versions.empty();
+        }
+
+        // Index starts from 0
+        const version<V> &operator[](size_t index) const {
+            return this->versions[index];
+        }
+
+        const version<V> &get_version(size_t version_number) const {
+            return this->versions[version_number - this->base - 1];
+        }
+
+        size_t get_version_number(size_t index) const {
+            return this->base + index + 1;
+        }
+
+        // Index of a version, versions dropped by compaction map to the oldest one kept
+        size_t get_index(size_t version_number) const {
+            return version_number <= this->base ? 0 : version_number - this->base - 1;
+        }
+
+        // Number of versions dropped by compaction
+        size_t get_base() const {
+            return this->base;
+        }
+
+        const version<V> &latest() const {
+            return this->versions.back();
+        }
+
+        const_iterator begin() const {
+            return this->versions.begin();
+        }
+
+        const_iterator end() const {
+            return this->versions.end();
+        }
+
+    private:
+        std::vector<version<V>, arena_allocator<version<V>>> versions;
+        size_t base;
+    };
+}
+#endif //MOCK_KEY_VALUE_STORE_VERSION_CHAIN_H
@@ -0,0 +1,58 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Checks a history written by the store, or by the HTTP server on exit.
+
+#include "../include/history_checker.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+/*
+ * Arguments:
+ * History file path
+ * Number of worker threads, optional, one per core by default
+ * Exits with 1 if the history violates any of the levels, with 2 if it can't be
+ * read or checked, e.g. for lack of memory.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: check_history <history file> [workers]\n";
+        return 2;
+    }
+
+    mockdb::history_log<std::string, std::string> history;
+    std::ifstream in(argv[1]);
+    try {
+        history.read(in);
+    } catch (std::runtime_error &e) {
+        std::cout << argv[1] << ": " << e.what() << "\n";
+        return 2;
+    } catch (std::bad_alloc &e) {
+        std::cout << argv[1] << ": out of memory reading the history\n";
+        return 2;
+    }
+
+    try {
+        mockdb::history_checker<std::string, std::string> checker(history, argc > 2 ? atoi(argv[2]) : 0);
+        std::cout << history.size() << " operations, " << checker.get_tx_count() << " transactions, "
+                  << checker.get_edge_count() << " dependencies\n";
+
+        bool passed = true;
+        auto report = [&checker, &passed](const char *level, bool ok) {
+            std::cout << level << ": " << (ok ? "ok" : checker.get_violation()) << "\n";
+            passed = passed && ok;
+        };
+        report("causal", checker.check_causal());
+        report("snapshot isolation", checker.check_snapshot_isolation());
+        report("serializability", checker.check_serializability());
+        return passed ? 0 : 1;
+    } catch (std::bad_alloc &e) {
+        std::cout << argv[1] << ": out of memory checking the history\n";
+        return 2;
+    }
+}
@@ -0,0 +1,98 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// Prints a binary trace written by mockdb::tracer as text, or converts it into a
+// Chrome trace for Perfetto.
+
+#include "../include/trace_buffer.h"
+#include "../include/chrome_trace_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+/*
+ * Arguments:
+ * Trace file path
+ * Optional, one of
+ *   --sort:                events in timestamp order rather than in file order,
+ *                          which is only ordered per thread
+ *   --chrome=<json file>:  writes the trace in Chrome Trace Event format instead,
+ *                          streaming, for ui.perfetto.dev or chrome://tracing
+ * As text: one line per event, times in ns since the first event, then the count of each kind.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: decode_trace <trace file> [--sort | --chrome=<json file>]\n";
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    std::vector<mockdb::trace_event> events;
+    try {
+        mockdb::trace_reader reader(in);
+        mockdb::trace_event event;
+        if (argc > 2 && std::strncmp(argv[2], "--chrome=", 9) == 0) {
+            std::ofstream out(argv[2] + 9);
+            mockdb::chrome_trace_writer writer(out);
+            size_t count = 0;
+            while (reader.next(event)) {
+                writer.add(event);
+                count++;
+            }
+            writer.finish();
+            if (!out) {
+                std::cout << "Can't write " << argv[2] + 9 << "\n";
+                return 2;
+            }
+            std::cout << count << " events, " << writer.get_flow_count() << " reads-from arrows, "
+                      << writer.get_unresolved_count() << " reads of writes not in the trace or older than 10 s\n";
+            return 0;
+        }
+        while (reader.next(event))
+            events.push_back(event);
+    } catch (std::runtime_error &e) {
+        std::cout << argv[1] << ": " << e.what() << "\n";
+        return 2;
+    }
+
+    if (argc > 2 && std::strcmp(argv[2], "--sort") == 0) {
+        std::stable_sort(events.begin(), events.end(),
+                         [](const mockdb::trace_event &a, const mockdb::trace_event &b) {
+                             return a.timestamp < b.timestamp;
+                         });
+    }
+
+    uint64_t first = UINT64_MAX;
+    for (const auto &event : events)
+        first = std::min(first, event.timestamp);
+
+    std::map<std::string, size_t> counts;
+    for (const auto &event : events) {
+        const char *kind = mockdb::trace_kind_name(event.kind);
+        counts[kind]++;
+        std::cout << event.timestamp - first << " thread " << event.thread << " " << kind;
+        if (event.store != 0)
+            std::cout << " store " << event.store;
+        std::cout << " tx " << event.tx_id << " session " << event.session_id;
+        if (event.key_hash != 0)
+            std::cout << " key " << std::hex << event.key_hash << std::dec;
+        if (event.reads_from != 0)
+            std::cout << " reads_from " << event.reads_from;
+        if (event.version_number != 0)
+            std::cout << " version " << event.version_number;
+        if (event.duration != 0)
+            std::cout << " duration " << event.duration;
+        std::cout << "\n";
+    }
+
+    std::cout << events.size() << " events";
+    for (const auto &count : counts)
+        std::cout << ", " << count.second << " " << count.first;
+    std::cout << "\n";
+    return 0;
+}
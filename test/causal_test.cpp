@@ -32,6 +32,7 @@ public:
 
     void test_simple_read_write();
     void test_causal_read_write();
+    void test_transitive_causality();
 
 private:
     mockdb::kv_store<std::string, int> *store;
@@ -78,6 +79,25 @@ void causal_tests::test_causal_read_write() {
         assert(c4_rx2 != a);
 }
 
+/*
+ * C1: W(x)a
+ * C2:         W(x)b   W(y)c
+ * C3:                          R(y)c   R(x)a   NOT OK, W(x)b is in the causal past of R(y)c
+ */
+void causal_tests::test_transitive_causality() {
+    int c1 = 1, c2 = 2, c3 = 3;
+    int a = 5, b = 10, c = 15;
+
+    store->put("x", a, c1);
+    store->put("x", b, c2);
+    store->put("y", c, c2);
+    int c3_ry = store->get("y", c3);
+    int c3_rx = store->get("x", c3);
+
+    assert(c3_ry == c);
+    assert(c3_rx == b);
+}
+
 /*
  * Args:
  * num-test : number of times to run test
@@ -96,6 +116,9 @@ int main(int argc, char* argv[]) {
         ct.test_simple_read_write();
         ct.test_causal_read_write();
         ct.TearDown();
+        ct.SetUp();
+        ct.test_transitive_causality();
+        ct.TearDown();
     }
 
     std::cout << "All causal test passed!\n";
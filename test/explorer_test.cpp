@@ -0,0 +1,193 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "explorer.h"
+#include "key_not_found_exception.h"
+
+#include <cassert>
+#include <functional>
+#include <set>
+
+class explorer_tests {
+
+public:
+    // Default ctor
+    explorer_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(bool causal)
+    {
+        this->causal = causal;
+        outcomes.clear();
+        distinct = 0;
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+    }
+
+    void test_linearizable_increments();
+    void test_causal_lost_update();
+    void test_independent_sessions();
+    void test_read_of_missing_key();
+
+private:
+    bool causal;
+    std::set<std::vector<int>> outcomes;    // Values read by the sessions in each run
+    int distinct;
+
+    /*
+     * Explores two sessions each running two transactions of read x, write x + 1,
+     * on the key given for the session.
+     */
+    size_t explore(const std::string &key1, const std::string &key2) {
+        mockdb::explorer ex;
+        do {
+            mockdb::read_response_selector<std::string, int> *inner;
+            if (causal)
+                inner = new mockdb::causal_read_response_selector<std::string, int>();
+            else
+                inner = new mockdb::linearizable_read_response_selector<std::string, int>();
+            mockdb::read_response_selector<std::string, int> *selector =
+                    new mockdb::exploring_read_response_selector<std::string, int>(&ex, inner);
+            mockdb::kv_store<std::string, int> *store = new mockdb::kv_store<std::string, int>(selector);
+            selector->init_consistency_checker(store);
+            store->put(key1, 0);
+            store->put(key2, 0);
+
+            std::vector<int> reads(4, -1);
+            auto session = [store, &reads](long session_id, const std::string &key) {
+                for (int i = 0; i < 2; i++) {
+                    store->begin(session_id);
+                    int value = store->get(key, session_id);
+                    reads[(session_id - 1) * 2 + i] = value;
+                    store->put(key, value + 1, session_id);
+                    store->commit(session_id);
+                }
+            };
+            if (ex.run({[&] { session(1, key1); }, [&] { session(2, key2); }})) {
+                outcomes.insert(reads);
+                distinct++;
+            }
+
+            delete store;
+            delete selector;
+        } while (ex.next());
+        return ex.get_execution_count();
+    }
+};
+
+/*
+ * Serialized transactions: the 6 orders of the four transactions give 6 different
+ * sets of reads, and no increment is lost.
+ */
+void explorer_tests::test_linearizable_increments() {
+    explore("x", "x");
+    assert(outcomes.size() == 6);
+    for (auto &reads : outcomes) {
+        std::set<int> values(reads.begin(), reads.end());
+        assert(values.size() == 4);
+    }
+}
+
+/*
+ * C1: BEGIN R(x)0 W(x)1 COMMIT
+ * C2: BEGIN R(x)0 W(x)1 COMMIT
+ * Causal consistency allows both sessions to read the initial value.
+ */
+void explorer_tests::test_causal_lost_update() {
+    explore("x", "x");
+    bool lost_update = false;
+    for (auto &reads : outcomes) {
+        if (reads[0] == 0 && reads[2] == 0)
+            lost_update = true;
+        // Each session reads its own writes
+        assert(reads[1] > reads[0] && reads[3] > reads[2]);
+    }
+    assert(lost_update);
+}
+
+// Sessions on different keys don't interfere, all their interleavings are equivalent
+void explorer_tests::test_independent_sessions() {
+    size_t runs = explore("x", "y");
+    assert(distinct == 1);
+    assert(outcomes.size() == 1);
+    assert(runs < 20);
+}
+
+/*
+ * C1: R(x)
+ * C2: W(x)7
+ * A read of a key which doesn't exist yet still conflicts with a write of it, both
+ * the "not found" and the 7 outcome must come from non-redundant runs.
+ */
+void explorer_tests::test_read_of_missing_key() {
+    mockdb::explorer ex;
+    do {
+        mockdb::read_response_selector<std::string, int> *selector =
+                new mockdb::exploring_read_response_selector<std::string, int>(
+                        &ex, new mockdb::linearizable_read_response_selector<std::string, int>());
+        mockdb::kv_store<std::string, int> *store = new mockdb::kv_store<std::string, int>(selector);
+        selector->init_consistency_checker(store);
+
+        std::vector<int> reads(1, -1);
+        auto reader = [store, &reads]() {
+            try {
+                reads[0] = store->get("x", 1);
+            } catch (mockdb::key_not_found_exception &e) {
+                reads[0] = -1;
+            }
+        };
+        if (ex.run({reader, [store] { store->put("x", 7, 2); }})) {
+            outcomes.insert(reads);
+            distinct++;
+        }
+
+        delete store;
+        delete selector;
+    } while (ex.next());
+
+    assert(outcomes.size() == 2);
+    assert(outcomes.count({-1}) == 1 && outcomes.count({7}) == 1);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    explorer_tests et;
+
+    // Every run explores the whole state space, a few are enough
+    for (int i = 0; i < std::min(test_count, 5); i++) {
+        et.SetUp(false);
+        et.test_linearizable_increments();
+        et.TearDown();
+
+        et.SetUp(true);
+        et.test_causal_lost_update();
+        et.TearDown();
+
+        et.SetUp(true);
+        et.test_independent_sessions();
+        et.TearDown();
+
+        et.SetUp(false);
+        et.test_read_of_missing_key();
+        et.TearDown();
+    }
+
+    std::cout << "All explorer tests passed!\n";
+}
@@ -0,0 +1,240 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "history_checker.h"
+#include "random_generator.h"
+
+#include <cassert>
+#include <sstream>
+#include <string>
+
+typedef mockdb::history_log<std::string, int> history;
+typedef mockdb::history_checker<std::string, int> checker;
+
+class history_checker_tests {
+
+public:
+    // Default ctor
+    history_checker_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(uint64_t seed)
+    {
+        this->seed = seed;
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, int>(seed);
+        store = new mockdb::kv_store<std::string, int>(get_next_tx);
+        get_next_tx->init_consistency_checker(store);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete store;
+        delete get_next_tx;
+    }
+
+    void test_round_trip();
+    void test_lost_update();
+    void test_write_skew();
+    void test_causal_violation();
+    void test_unknown_writer();
+    void test_causal_store();
+    void test_many_sessions();
+
+private:
+    uint64_t seed;
+    mockdb::read_response_selector<std::string, int> *get_next_tx;
+    mockdb::kv_store<std::string, int> *store;
+
+    // Transaction 1 of session 1 writes the first version of x and y
+    static void initial_writes(history &h) {
+        h.append(1, 1, mockdb::op_kind::PUT, "x", 1, 0);
+        h.append(1, 1, mockdb::op_kind::PUT, "y", 1, 0);
+    }
+};
+
+void history_checker_tests::test_round_trip() {
+    history h;
+    initial_writes(h);
+    h.append(2, 2, mockdb::op_kind::GET, "a key", 0, 0);
+    h.append(2, 2, mockdb::op_kind::REMOVE, "x", 2, 1);
+    std::stringstream ss;
+    h.write(ss);
+
+    history loaded;
+    loaded.read(ss);
+    assert(loaded.size() == h.size() && loaded.get_key_count() == 3);
+    assert(loaded[2].get_key() == "a key" && loaded[3].get_kind() == mockdb::op_kind::REMOVE);
+    assert(loaded[3].get_version_number() == 2 && loaded[3].get_reads_from() == 1);
+    assert(loaded.get_session(2).size() == 2);
+
+    // A REMOVE reads the version its writer wrote, a GET of a missing key the initial state
+    checker c(loaded, 1);
+    assert(c.check_causal() && c.check_snapshot_isolation() && c.check_serializability());
+    assert(c.get_violation().empty());
+}
+
+// Two transactions increment x from the same version
+void history_checker_tests::test_lost_update() {
+    history h;
+    initial_writes(h);
+    h.append(2, 2, mockdb::op_kind::GET, "x", 1, 1);
+    h.append(3, 3, mockdb::op_kind::GET, "x", 1, 1);
+    h.append(2, 2, mockdb::op_kind::PUT, "x", 2, 0);
+    h.append(3, 3, mockdb::op_kind::PUT, "x", 3, 0);
+
+    checker c(h, 2);
+    assert(c.check_causal());
+    assert(!c.check_snapshot_isolation());
+    assert(c.get_violating_txs().size() == 2);
+    assert(!c.check_serializability());
+    assert(c.get_violation().find("rw") != std::string::npos);
+}
+
+// Each transaction writes the key the other one read, snapshot isolation allows it
+void history_checker_tests::test_write_skew() {
+    history h;
+    initial_writes(h);
+    h.append(2, 2, mockdb::op_kind::GET, "x", 1, 1);
+    h.append(2, 2, mockdb::op_kind::GET, "y", 1, 1);
+    h.append(3, 3, mockdb::op_kind::GET, "x", 1, 1);
+    h.append(3, 3, mockdb::op_kind::GET, "y", 1, 1);
+    h.append(2, 2, mockdb::op_kind::PUT, "x", 2, 0);
+    h.append(3, 3, mockdb::op_kind::PUT, "y", 2, 0);
+
+    checker c(h, 2);
+    assert(c.check_causal() && c.check_snapshot_isolation());
+    assert(!c.check_serializability());
+    assert(c.get_violation() == "cycle 2 -rw-> 3 -rw-> 2");
+}
+
+// Session 2 sees y written after x by session 1, then the initial x
+void history_checker_tests::test_causal_violation() {
+    history h;
+    h.append(1, 1, mockdb::op_kind::PUT, "x", 1, 0);
+    h.append(2, 1, mockdb::op_kind::PUT, "y", 1, 0);
+    h.append(3, 2, mockdb::op_kind::GET, "y", 1, 2);
+    h.append(3, 2, mockdb::op_kind::GET, "x", 0, 0);
+
+    checker c(h, 2);
+    assert(!c.check_causal());
+    assert(c.get_violating_txs() == std::vector<long>({1, 3}));
+    assert(!c.check_snapshot_isolation() && !c.check_serializability());
+}
+
+void history_checker_tests::test_unknown_writer() {
+    history h;
+    initial_writes(h);
+    h.append(2, 2, mockdb::op_kind::GET, "x", 1, 7);
+
+    checker c(h, 1);
+    assert(!c.check_causal() && !c.check_serializability());
+    assert(c.get_violating_txs() == std::vector<long>({2}));
+}
+
+// Histories of the causal selector pass the causal check, whatever the number of workers
+void history_checker_tests::test_causal_store() {
+    mockdb::random_generator random(seed);
+    const char *keys[] = {"x", "y", "z"};
+    store->begin(1);
+    for (const char *key : keys)
+        store->put(key, 0, 1);
+    store->commit(1);
+
+    for (int i = 0; i < 30; i++) {
+        long session_id = 1 + (long) random.uniform(3);
+        store->begin(session_id);
+        int value = store->get(keys[random.uniform(3)], session_id);
+        store->put(keys[random.uniform(3)], value + 1, session_id);
+        store->commit(session_id);
+        store->get(keys[random.uniform(3)], 1 + (long) random.uniform(3));
+    }
+
+    checker one(store->get_history(), 1), four(store->get_history(), 4);
+    assert(one.check_causal());
+    assert(four.check_causal());
+    assert(one.check_serializability() == four.check_serializability());
+    assert(one.get_violation() == four.get_violation());
+    assert(one.get_edge_count() == four.get_edge_count());
+}
+
+/*
+ * 20000 sessions each reading the initial y, then one reading z written after x
+ * and the initial x: the causal past of a transaction only holds the sessions it
+ * depends on, not an entry for every session of the history.
+ */
+void history_checker_tests::test_many_sessions() {
+    const long sessions = 20000;
+    history h;
+    initial_writes(h);
+    h.append(2, 1, mockdb::op_kind::PUT, "x", 2, 0);
+    h.append(2, 1, mockdb::op_kind::PUT, "z", 1, 0);
+    long tx_id = 2;
+    for (long session_id = 2; session_id <= sessions; session_id++) {
+        tx_id++;
+        h.append(tx_id, session_id, mockdb::op_kind::GET, "y", 1, 1);
+        h.append(tx_id, session_id, mockdb::op_kind::PUT, "w", tx_id - 2, 0);
+    }
+
+    checker c(h, 2);
+    assert(c.get_tx_count() == (size_t) (sessions + 1));
+    assert(c.check_causal());
+
+    tx_id++;
+    h.append(tx_id, sessions + 1, mockdb::op_kind::GET, "z", 1, 2);
+    h.append(tx_id, sessions + 1, mockdb::op_kind::GET, "x", 1, 1);
+    checker stale(h, 2);
+    assert(!stale.check_causal());
+    assert(stale.get_violating_txs() == std::vector<long>({2, tx_id}));
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    history_checker_tests ht;
+
+    for (int i = 0; i < test_count; i++) {
+        ht.SetUp(i);
+        ht.test_round_trip();
+        ht.TearDown();
+
+        ht.SetUp(i);
+        ht.test_lost_update();
+        ht.TearDown();
+
+        ht.SetUp(i);
+        ht.test_write_skew();
+        ht.TearDown();
+
+        ht.SetUp(i);
+        ht.test_causal_violation();
+        ht.TearDown();
+
+        ht.SetUp(i);
+        ht.test_unknown_writer();
+        ht.TearDown();
+
+        ht.SetUp(i);
+        ht.test_causal_store();
+        ht.TearDown();
+
+        ht.SetUp(i);
+        ht.test_many_sessions();
+        ht.TearDown();
+    }
+
+    std::cout << "All history checker tests passed!\n";
+}
@@ -0,0 +1,131 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "instrumentation.h"
+
+#include <cassert>
+#include <sstream>
+#include <string>
+
+class instrumentation_tests {
+
+public:
+    // Default ctor
+    instrumentation_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(uint64_t seed)
+    {
+        this->seed = seed;
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, int>(seed);
+        store = new mockdb::kv_store<std::string, int>(get_next_tx, 4);
+        get_next_tx->init_consistency_checker(store);
+        metrics = new mockdb::instrumentation();
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete store;
+        delete get_next_tx;
+        delete metrics;
+    }
+
+    void test_histogram();
+    void test_store_operations();
+    void test_disabled();
+
+private:
+    uint64_t seed;
+    mockdb::read_response_selector<std::string, int> *get_next_tx;
+    mockdb::kv_store<std::string, int> *store;
+    mockdb::instrumentation *metrics;
+};
+
+// Percentiles are within 1/16 of the recorded values
+void instrumentation_tests::test_histogram() {
+    mockdb::latency_histogram h;
+    uint64_t n = 1000 + seed;
+    for (uint64_t v = 1; v <= n; v++)
+        h.record(v * 1000);
+    mockdb::histogram_snapshot s = h.get_snapshot();
+    assert(s.count == n && s.min == 1000 && s.max == n * 1000);
+    uint64_t median = s.value_at_percentile(50);
+    assert(median >= n * 500 - 1000 && median <= n * 500 + n * 500 / 16 + 1000);
+    assert(s.value_at_percentile(100) == s.max);
+    for (uint64_t v = 0; v < 32; v++)
+        assert(mockdb::latency_histogram::highest_in_bucket(mockdb::latency_histogram::bucket_of(v)) == v);
+    assert(mockdb::latency_histogram::bucket_of(UINT64_MAX) == mockdb::latency_histogram::bucket_count - 1);
+}
+
+void instrumentation_tests::test_store_operations() {
+    store->set_instrumentation(metrics);
+    store->put("x", 1, 1);
+    store->put("x", 2, 1);
+    store->put("y", 1, 2);
+    store->get("x", 1);
+    store->get("x", 2);
+    store->begin(3);
+    store->get("y", 3);
+    store->put("y", 2, 3);
+    store->commit(3);
+
+    mockdb::instrumentation_snapshot s = metrics->get_snapshot();
+    // The PUT inside the transaction is counted too
+    assert(s.put.count == 4 && s.get.count == 3 && s.begin.count == 1 && s.commit.count == 1);
+    assert(s.remove.count == 0);
+    assert(s.select.count == 3 && s.candidates.count == 3);
+    assert(s.candidates.max == 2 && s.candidates.min == 1);
+    assert(s.checker_invocations == 3 && s.checker_rejections == 0);
+    assert(s.lock_wait.count > 0 && s.lock_wait.count == s.lock_hold.count);
+
+    std::stringstream ss;
+    s.write(ss);
+    assert(ss.str().find("candidates") != std::string::npos);
+}
+
+void instrumentation_tests::test_disabled() {
+    store->set_instrumentation(metrics);
+    store->put("x", 1, 1);
+    store->set_instrumentation(nullptr);
+    store->put("x", 2, 1);
+    store->get("x", 2);
+    mockdb::instrumentation_snapshot s = metrics->get_snapshot();
+    assert(s.put.count == 1 && s.get.count == 0 && s.checker_invocations == 0);
+    assert(store->get_instrumentation() == nullptr);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    instrumentation_tests it;
+
+    for (int i = 0; i < test_count; i++) {
+        it.SetUp(i);
+        it.test_histogram();
+        it.TearDown();
+
+        it.SetUp(i);
+        it.test_store_operations();
+        it.TearDown();
+
+        it.SetUp(i);
+        it.test_disabled();
+        it.TearDown();
+    }
+
+    std::cout << "All instrumentation tests passed!\n";
+}
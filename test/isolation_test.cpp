@@ -0,0 +1,226 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <cassert>
+#include <set>
+#include <string>
+
+class isolation_tests {
+
+public:
+    // Default ctor
+    isolation_tests() {
+
+    }
+
+    // Called once before each test, x and y start at 0, written together by session 1
+    virtual void SetUp(mockdb::read_response_selector<std::string, int> *selector)
+    {
+        read_selector = selector;
+        store = new mockdb::kv_store<std::string, int>(read_selector);
+        read_selector->init_consistency_checker(store);
+        store->begin(1);
+        store->put("x", 0, 1);
+        store->put("y", 0, 1);
+        store->commit(1);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete store;
+        delete read_selector;
+    }
+
+    void test_read_committed();
+    void test_read_atomic();
+    void test_read_your_writes();
+    void test_monotonic_reads();
+    void test_monotonic_writes();
+    void test_writes_follow_reads();
+    void test_snapshot_isolation();
+    void test_parallel_snapshot_isolation();
+
+    // Outcomes the levels allow but stronger ones don't, seen over all runs
+    std::set<std::string> anomalies;
+
+private:
+    mockdb::kv_store<std::string, int> *store;
+    mockdb::read_response_selector<std::string, int> *read_selector;
+
+    // Session 2 writes x and y in one transaction
+    void write_both(int value) {
+        store->begin(2);
+        store->put("x", value, 2);
+        store->put("y", value, 2);
+        store->commit(2);
+    }
+};
+
+// Only committed versions are read, but a transaction may see the writes of another one in part
+void isolation_tests::test_read_committed() {
+    store->begin(4);
+    store->put("x", 2, 4);
+    store->put("y", 2, 4);
+    write_both(1);
+    store->begin(3);
+    int y = store->get("y", 3);
+    int x = store->get("x", 3);
+    store->commit(3);
+    // Session 4's transaction is still open
+    assert((y == 0 || y == 1) && (x == 0 || x == 1));
+    store->commit(4);
+
+    if (y == 1 && x == 0)
+        anomalies.insert("read committed: fractured read");
+}
+
+// A transaction which read y from session 2 reads x from it too, the next one may not
+void isolation_tests::test_read_atomic() {
+    write_both(1);
+    store->begin(3);
+    int y = store->get("y", 3);
+    int x = store->get("x", 3);
+    store->commit(3);
+    assert(y == 0 || x == 1);
+
+    int later = store->get("x", 3);
+    if (x == 1 && later == 0)
+        anomalies.insert("read atomic: older read in a later transaction");
+}
+
+void isolation_tests::test_read_your_writes() {
+    store->put("x", 1, 2);
+    assert(store->get("x", 2) == 1);
+    if (store->get("x", 3) == 0)
+        anomalies.insert("read your writes: other session reads stale");
+}
+
+void isolation_tests::test_monotonic_reads() {
+    store->put("x", 1, 2);
+    store->put("x", 2, 2);
+    int first = store->get("x", 3);
+    int second = store->get("x", 3);
+    assert(second >= first);
+    if (first < 2)
+        anomalies.insert("monotonic reads: stale read");
+}
+
+// Session 2 writes x then y, whoever reads y from it reads x from it too
+void isolation_tests::test_monotonic_writes() {
+    store->put("x", 1, 2);
+    store->put("y", 1, 2);
+    int y = store->get("y", 3);
+    int x = store->get("x", 3);
+    assert(y == 0 || x == 1);
+    if (y == 0)
+        anomalies.insert("monotonic writes: stale read");
+}
+
+// Session 3 copies x to y, whoever reads the copy reads at least the x it copied
+void isolation_tests::test_writes_follow_reads() {
+    store->put("x", 1, 2);
+    int x = store->get("x", 3);
+    store->put("y", x + 10, 3);
+    int y = store->get("y", 4);
+    int x_after = store->get("x", 4);
+    if (y == 11)
+        assert(x_after == 1);
+    if (y == 0)
+        anomalies.insert("writes follow reads: stale read");
+}
+
+/*
+ * Transactions read x and y from one snapshot. Once session 3 has committed, its
+ * snapshots contain everything committed before, session 2's write included.
+ */
+void isolation_tests::test_snapshot_isolation() {
+    write_both(1);
+    store->begin(3);
+    int x = store->get("x", 3);
+    int y = store->get("y", 3);
+    store->commit(3);
+    assert(x == y);
+    if (x == 0)
+        anomalies.insert("snapshot isolation: older snapshot");
+
+    assert(store->get("x", 2) == 1);
+    store->begin(3);
+    assert(store->get("y", 3) == 1);
+    store->commit(3);
+}
+
+void isolation_tests::test_parallel_snapshot_isolation() {
+    write_both(1);
+    store->begin(3);
+    int x = store->get("x", 3);
+    int y = store->get("y", 3);
+    store->commit(3);
+    assert(x == y);
+    if (x == 0)
+        anomalies.insert("parallel snapshot isolation: older snapshot");
+
+    // The snapshot of the next transaction contains the previous one
+    store->begin(3);
+    assert(store->get("y", 3) >= y);
+    store->commit(3);
+    assert(store->get("x", 2) == 1);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    isolation_tests it;
+
+    for (int i = 0; i < test_count; i++) {
+        it.SetUp(new mockdb::read_committed_read_response_selector<std::string, int>(i));
+        it.test_read_committed();
+        it.TearDown();
+
+        it.SetUp(new mockdb::read_atomic_read_response_selector<std::string, int>(i));
+        it.test_read_atomic();
+        it.TearDown();
+
+        it.SetUp(new mockdb::read_your_writes_read_response_selector<std::string, int>(i));
+        it.test_read_your_writes();
+        it.TearDown();
+
+        it.SetUp(new mockdb::monotonic_reads_read_response_selector<std::string, int>(i));
+        it.test_monotonic_reads();
+        it.TearDown();
+
+        it.SetUp(new mockdb::monotonic_writes_read_response_selector<std::string, int>(i));
+        it.test_monotonic_writes();
+        it.TearDown();
+
+        it.SetUp(new mockdb::writes_follow_reads_read_response_selector<std::string, int>(i));
+        it.test_writes_follow_reads();
+        it.TearDown();
+
+        it.SetUp(new mockdb::snapshot_isolation_read_response_selector<std::string, int>(i));
+        it.test_snapshot_isolation();
+        it.TearDown();
+
+        it.SetUp(new mockdb::parallel_snapshot_isolation_read_response_selector<std::string, int>(i));
+        it.test_parallel_snapshot_isolation();
+        it.TearDown();
+    }
+
+    // The levels are weaker than linearizability
+    if (test_count >= 50)
+        assert(it.anomalies.size() == 8);
+
+    std::cout << "All isolation tests passed!\n";
+}
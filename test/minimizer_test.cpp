@@ -0,0 +1,106 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "minimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+class minimizer_tests {
+
+public:
+    // Default ctor
+    minimizer_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(size_t count)
+    {
+        this->count = count;
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+    }
+
+    void test_pair();
+    void test_fails_without_elements();
+    void test_same_result_for_any_workers();
+
+private:
+    size_t count;
+
+    static bool contains(const std::vector<size_t> &elements, size_t element) {
+        return std::find(elements.begin(), elements.end(), element) != elements.end();
+    }
+};
+
+// Fails when two given elements are both present, neither can be removed
+void minimizer_tests::test_pair() {
+    mockdb::minimizer shrink(1);
+    size_t first = count / 3, second = count - 1;
+    std::vector<size_t> result = shrink.minimize(count, [first, second](const std::vector<size_t> &elements) {
+        return contains(elements, first) && contains(elements, second);
+    });
+    assert(result == std::vector<size_t>({first, second}));
+    assert(shrink.get_test_count() > 0);
+}
+
+void minimizer_tests::test_fails_without_elements() {
+    mockdb::minimizer shrink(1);
+    std::vector<size_t> result = shrink.minimize(count, [](const std::vector<size_t> &) {
+        return true;
+    });
+    assert(result.empty());
+    assert(shrink.get_test_count() == 1);
+}
+
+// Among several failing candidates the first one is taken, whichever finishes first
+void minimizer_tests::test_same_result_for_any_workers() {
+    auto fails = [](const std::vector<size_t> &elements) {
+        size_t odd = 0;
+        for (size_t e : elements)
+            odd += e % 2;
+        return odd >= 2;
+    };
+    mockdb::minimizer one(1), four(4);
+    std::vector<size_t> result = one.minimize(count, fails);
+    assert(result.size() == 2 && result[0] % 2 == 1 && result[1] % 2 == 1);
+    assert(four.minimize(count, fails) == result);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    minimizer_tests mt;
+
+    for (int i = 0; i < test_count; i++) {
+        size_t count = 4 + i % 60;
+        mt.SetUp(count);
+        mt.test_pair();
+        mt.TearDown();
+
+        mt.SetUp(count);
+        mt.test_fails_without_elements();
+        mt.TearDown();
+
+        mt.SetUp(count);
+        mt.test_same_result_for_any_workers();
+        mt.TearDown();
+    }
+
+    std::cout << "All minimizer tests passed!\n";
+}
@@ -0,0 +1,268 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "consistency_exception.h"
+#include "random_generator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads the latest version of every key except one, for which no version is consistent
+class rejecting_read_response_selector : public mockdb::read_response_selector<std::string, int> {
+public:
+    rejecting_read_response_selector(const std::string &rejected) : rejected(rejected) {
+    }
+
+    void init_consistency_checker(const mockdb::kv_store_base<std::string, int> *store) {
+        this->store = store;
+    }
+
+    size_t select_read_response(mockdb::transaction<std::string, int> *tx,
+                                const mockdb::operation<std::string, int> *op,
+                                const mockdb::candidate_view<std::string, int> &candidates) {
+        if (op->get_params()->get_key() == this->rejected)
+            throw mockdb::consistency_exception("GET", tx->get_tx_id());
+        return candidates.size() - 1;
+    }
+
+private:
+    std::string rejected;
+};
+
+class multi_op_tests {
+
+public:
+    // Default ctor
+    multi_op_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(mockdb::read_response_selector<std::string, int> *selector, uint64_t seed)
+    {
+        this->seed = seed;
+        read_selector = selector;
+        store = new mockdb::kv_store<std::string, int>(read_selector, 4);
+        read_selector->init_consistency_checker(store);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete store;
+        delete read_selector;
+    }
+
+    void test_key_order();
+    void test_missing_and_removed();
+    void test_inconsistent_key();
+    void test_inconsistent_key_flagged();
+    void test_history_rows();
+    void test_concurrent_batches();
+
+private:
+    uint64_t seed;
+    mockdb::kv_store<std::string, int> *store;
+    mockdb::read_response_selector<std::string, int> *read_selector;
+};
+
+// Results are in the order of the keys, whatever the stripes they fall into
+void multi_op_tests::test_key_order() {
+    std::vector<std::pair<std::string, int>> pairs;
+    for (int i = 0; i < 16; i++)
+        pairs.push_back({"k" + std::to_string(i), i});
+    assert(store->multi_put(pairs, 1) == 16);
+    store->put("k3", 100, 1);
+
+    std::vector<std::string> keys;
+    for (auto &pair : pairs)
+        keys.push_back(pair.first);
+    mockdb::random_generator random(seed);
+    std::shuffle(keys.begin(), keys.end(), random);
+    keys.push_back(keys.front());
+
+    std::vector<std::pair<int, size_t>> results = store->multi_get(keys, 2);
+    assert(results.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        int value = std::stoi(keys[i].substr(1));
+        if (keys[i] == "k3")
+            assert(results[i].first == 100 && results[i].second == 2);
+        else
+            assert(results[i].first == value && results[i].second == 1);
+    }
+}
+
+// Keys which don't exist or are removed come back with version 0 instead of failing the batch
+void multi_op_tests::test_missing_and_removed() {
+    store->multi_put({{"x", 1}, {"y", 2}}, 1);
+    store->remove("y", 1);
+
+    std::vector<std::pair<int, size_t>> results = store->multi_get({"x", "y", "z"}, 1);
+    assert(results.size() == 3);
+    assert(results[0].first == 1 && results[0].second == 1);
+    assert(results[1].second == 0);
+    assert(results[2].second == 0);
+
+    // The same inside a transaction
+    store->begin(1);
+    results = store->multi_get({"z", "x", "y"}, 1);
+    store->commit(1);
+    assert(results[0].second == 0 && results[1].second == 1 && results[2].second == 0);
+}
+
+// A key without a consistent version fails the batch, the reads before it stay committed
+void multi_op_tests::test_inconsistent_key() {
+    store->multi_put({{"a", 1}, {"bad", 2}, {"c", 3}}, 1);
+    size_t before = store->get_history().size();
+
+    bool thrown = false;
+    try {
+        store->multi_get({"a", "bad", "c"}, 2);
+    } catch (mockdb::consistency_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    const mockdb::history_log<std::string, int> &history = store->get_history();
+    assert(history.size() == before + 1);
+    assert(history[before].get_kind() == mockdb::op_kind::GET && history[before].get_key() == "a");
+    assert(history[before].get_session_id() == 2 && history[before].get_version_number() == 1);
+
+    // The store is still usable
+    assert(store->multi_get({"c"}, 2)[0].first == 3);
+}
+
+// Asked to flag inconsistent keys, the batch reads every other key, each once
+void multi_op_tests::test_inconsistent_key_flagged() {
+    store->multi_put({{"a", 1}, {"bad", 2}, {"c", 3}}, 1);
+    size_t before = store->get_history().size();
+
+    std::vector<bool> inconsistent;
+    std::vector<std::pair<int, size_t>> results = store->multi_get({"a", "bad", "c"}, 2, &inconsistent);
+    assert(inconsistent == std::vector<bool>({false, true, false}));
+    assert(results[0].first == 1 && results[0].second == 1);
+    assert(results[1].second == 0);
+    assert(results[2].first == 3 && results[2].second == 1);
+
+    const mockdb::history_log<std::string, int> &history = store->get_history();
+    assert(history.size() == before + 2);
+    assert(history[before].get_key() == "a" && history[before + 1].get_key() == "c");
+
+    // The same inside a transaction
+    store->begin(3);
+    results = store->multi_get({"bad", "c"}, 3, &inconsistent);
+    store->commit(3);
+    assert(inconsistent == std::vector<bool>({true, false}));
+    assert(results[0].second == 0 && results[1].first == 3);
+    assert(store->get_history().get_session(3).size() == 1);
+}
+
+// Every key of a batch is its own GET or PUT in the history, in the order of the keys
+void multi_op_tests::test_history_rows() {
+    std::vector<std::pair<std::string, int>> pairs = {{"x", 1}, {"y", 2}, {"z", 3}, {"x", 4}};
+    store->multi_put(pairs, 1);
+    store->multi_get({"z", "x", "w"}, 2);
+
+    const mockdb::history_log<std::string, int> &history = store->get_history();
+    assert(history.size() == 6);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        assert(history[i].get_kind() == mockdb::op_kind::PUT && history[i].get_key() == pairs[i].first);
+        assert(history[i].get_session_id() == 1);
+    }
+    assert(history[1].get_tx_id() != history[0].get_tx_id());
+    assert(history[3].get_version_number() == 2);
+
+    // The missing key w has no row
+    assert(history[4].get_kind() == mockdb::op_kind::GET && history[4].get_key() == "z");
+    assert(history[5].get_kind() == mockdb::op_kind::GET && history[5].get_key() == "x");
+    assert(history[5].get_version_number() == 2 && history[5].get_reads_from() == history[3].get_tx_id());
+    assert(store->get_history().get_session(2).size() == 2);
+}
+
+// Batches over overlapping keys in opposite orders don't deadlock
+void multi_op_tests::test_concurrent_batches() {
+    const int threads_count = 4, rounds = 200;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 8; i++)
+        keys.push_back("k" + std::to_string(i));
+    store->multi_put({{"k0", 0}, {"k1", 0}, {"k2", 0}, {"k3", 0}, {"k4", 0}, {"k5", 0}, {"k6", 0}, {"k7", 0}}, 1);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++) {
+        threads.push_back(std::thread([this, t, keys]() {
+            std::vector<std::string> own = keys;
+            if (t % 2 == 1)
+                std::reverse(own.begin(), own.end());
+            std::vector<std::pair<std::string, int>> pairs;
+            for (auto &key : own)
+                pairs.push_back({key, t});
+            for (int i = 0; i < rounds; i++) {
+                store->multi_put(pairs, t + 2);
+                std::vector<std::pair<int, size_t>> results = store->multi_get(own, t + 2);
+                assert(results.size() == own.size());
+            }
+        }));
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    // Every read finds its key, and every write of a key got a version of its own
+    const mockdb::history_log<std::string, int> &history = store->get_history();
+    assert(history.size() == keys.size() * (1 + 2 * threads_count * rounds));
+    std::map<std::string, size_t> latest;
+    for (size_t i = 0; i < history.size(); i++) {
+        if (history[i].get_kind() == mockdb::op_kind::PUT)
+            latest[history[i].get_key()] = std::max(latest[history[i].get_key()], history[i].get_version_number());
+    }
+    for (auto &key : keys)
+        assert(latest[key] == 1 + threads_count * rounds);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    multi_op_tests mt;
+
+    for (int i = 0; i < test_count; i++) {
+        mt.SetUp(new mockdb::linearizable_read_response_selector<std::string, int>(), i);
+        mt.test_key_order();
+        mt.TearDown();
+
+        mt.SetUp(new mockdb::causal_read_response_selector<std::string, int>(i), i);
+        mt.test_missing_and_removed();
+        mt.TearDown();
+
+        mt.SetUp(new rejecting_read_response_selector("bad"), i);
+        mt.test_inconsistent_key();
+        mt.TearDown();
+
+        mt.SetUp(new rejecting_read_response_selector("bad"), i);
+        mt.test_inconsistent_key_flagged();
+        mt.TearDown();
+
+        mt.SetUp(new mockdb::linearizable_read_response_selector<std::string, int>(), i);
+        mt.test_history_rows();
+        mt.TearDown();
+
+        mt.SetUp(new mockdb::causal_read_response_selector<std::string, int>(i), i);
+        mt.test_concurrent_batches();
+        mt.TearDown();
+    }
+
+    std::cout << "All multi-operation tests passed!\n";
+}
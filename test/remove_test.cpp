@@ -0,0 +1,206 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <cassert>
+
+class remove_tests {
+
+public:
+    // Default ctor
+    remove_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(mockdb::read_response_selector<std::string, int> *selector)
+    {
+        read_selector = selector;
+        store = new mockdb::kv_store<std::string, int>(read_selector);
+        read_selector->init_consistency_checker(store);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete read_selector;
+        delete store;
+    }
+
+    void test_causal_remove();
+    void test_linearizable_compaction();
+    void test_causal_compaction();
+    void test_registered_compaction();
+
+private:
+    mockdb::kv_store<std::string, int> *store;
+    mockdb::read_response_selector<std::string, int> *read_selector;
+
+    bool is_removed(const std::string &key, long session_id) {
+        try {
+            store->get(key, session_id);
+        } catch (mockdb::key_not_found_exception &e) {
+            return true;
+        }
+        return false;
+    }
+};
+
+/*
+ * C1: W(x)a   D(x)a   R(x)NOTFOUND   D(x)NOTFOUND   W(x)b   R(x)b
+ * C2:                 R(x)a or NOTFOUND
+ */
+void remove_tests::test_causal_remove() {
+    int c1 = 1, c2 = 2;
+    int a = 5, b = 10;
+
+    store->put("x", a, c1);
+    assert(store->remove("x", c1) == a);
+    assert(store->get_size() == 0);
+
+    // The session's own remove is in its causal past
+    assert(is_removed("x", c1));
+    bool thrown = false;
+    try {
+        store->remove("x", c1);
+    } catch (mockdb::key_not_found_exception &e) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Other sessions may still read the value from before the remove
+    try {
+        assert(store->get("x", c2) == a);
+    } catch (mockdb::key_not_found_exception &e) {
+        // Pass
+    }
+
+    // Versions continue after the tombstone
+    store->put("x", b, c1);
+    std::pair<int, size_t> read = store->get_with_version("x", c1);
+    assert(read.first == b);
+    assert(read.second == 3);
+    assert(store->get_size() == 1);
+}
+
+/*
+ * Under linearizability only the latest version can be read, so the chain is
+ * compacted as soon as the key is removed.
+ */
+void remove_tests::test_linearizable_compaction() {
+    store->put("x", 1);
+    store->put("x", 2);
+    store->put("x", 3);
+    assert(store->remove("x") == 3);
+    assert(is_removed("x", 1));
+    assert(store->compact() == 0);
+
+    store->put("x", 4);
+    std::pair<int, size_t> read = store->get_with_version("x");
+    assert(read.first == 4);
+    assert(read.second == 5);
+}
+
+/*
+ * C1: W(x)a   D(x)a
+ * C2:                   R(x)a      R(x)NOTFOUND
+ * C3:                                              R(x)a
+ * Without the sessions registered, one which hasn't read yet may read any version,
+ * so nothing is dropped even once every session seen has read the tombstone.
+ */
+void remove_tests::test_causal_compaction() {
+    int c1 = 1, c2 = 2, c3 = 3;
+    int a = 5;
+
+    store->put("x", a, c1);
+    assert(store->get("x", c2) == a);
+    store->remove("x", c1);
+    assert(store->compact() == 0);
+
+    while (!is_removed("x", c2)) {
+    }
+    assert(store->compact() == 0);
+
+    // C3 may still read a, or else a session after it which hasn't read yet
+    long c = c3;
+    while (is_removed("x", c))
+        c++;
+    assert(store->compact() == 0);
+}
+
+/*
+ * The same with C1, C2 and C3 registered: the versions of x are dropped once all
+ * three have seen the remove.
+ */
+void remove_tests::test_registered_compaction() {
+    int c1 = 1, c2 = 2, c3 = 3;
+    int a = 5;
+
+    read_selector->register_sessions({c1, c2, c3});
+    store->put("x", a, c1);
+    assert(store->get("x", c2) == a);
+    store->remove("x", c1);
+
+    // C2 may still read a
+    assert(store->compact() == 0);
+    while (!is_removed("x", c2)) {
+    }
+    // C3 hasn't seen the remove
+    assert(store->compact() == 0);
+
+    // Once C3 has read the tombstone nothing older can be read anymore
+    while (!is_removed("x", c3)) {
+    }
+    assert(store->compact() == 0);          // Already compacted by the read
+    for (int i = 0; i < 20; i++)
+        assert(is_removed("x", c3 + 1));
+    assert(store->get_history().get_session(c2).size() >= 2);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    remove_tests rt;
+
+    for (int i = 0; i < test_count; i++) {
+        rt.SetUp(new mockdb::causal_read_response_selector<std::string, int>());
+        rt.test_causal_remove();
+        rt.TearDown();
+
+        rt.SetUp(new mockdb::linearizable_read_response_selector<std::string, int>());
+        rt.test_linearizable_compaction();
+        rt.TearDown();
+
+        rt.SetUp(new mockdb::causal_read_response_selector<std::string, int>());
+        rt.test_causal_compaction();
+        rt.TearDown();
+
+        rt.SetUp(new mockdb::causal_read_response_selector<std::string, int>());
+        rt.test_registered_compaction();
+        rt.TearDown();
+
+        // Session guarantees under which the remove is in C1's frontier
+        rt.SetUp(new mockdb::session_guarantee_read_response_selector<std::string, int>(
+                mockdb::READ_YOUR_WRITES | mockdb::MONOTONIC_READS));
+        rt.test_causal_compaction();
+        rt.TearDown();
+
+        rt.SetUp(new mockdb::session_guarantee_read_response_selector<std::string, int>(
+                mockdb::READ_YOUR_WRITES | mockdb::MONOTONIC_READS));
+        rt.test_registered_compaction();
+        rt.TearDown();
+    }
+
+    std::cout << "All remove tests passed!\n";
+}
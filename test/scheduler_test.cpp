@@ -0,0 +1,268 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "session_scheduler.h"
+#include "decision_log.h"
+
+#include <cassert>
+#include <functional>
+#include <set>
+#include <sstream>
+
+class scheduler_tests {
+
+public:
+    // Default ctor
+    scheduler_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(uint64_t seed)
+    {
+        this->seed = seed;
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, int>(seed);
+        store = new mockdb::kv_store<std::string, int>(get_next_tx);
+        get_next_tx->init_consistency_checker(store);
+        store->put("x", 0);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete store;
+        delete get_next_tx;
+    }
+
+    void test_same_seed_same_run();
+    void test_pct_without_change_points();
+    void test_pct_expected_steps();
+    void test_pct_same_seed_same_run();
+    void test_virtual_time();
+    void test_record_replay();
+
+private:
+    uint64_t seed;
+    mockdb::read_response_selector<std::string, int> *get_next_tx;
+    mockdb::kv_store<std::string, int> *store;
+
+    // Three sessions each running three transactions of read x, write x + 1
+    std::vector<std::function<void()>> increments(std::vector<int> &reads) {
+        std::vector<std::function<void()>> sessions;
+        for (long session_id = 1; session_id <= 3; session_id++) {
+            sessions.push_back([this, &reads, session_id] {
+                for (int i = 0; i < 3; i++) {
+                    store->begin(session_id);
+                    int value = store->get("x", session_id);
+                    reads.push_back(value);
+                    store->put("x", value + 1, session_id);
+                    store->commit(session_id);
+                }
+            });
+        }
+        return sessions;
+    }
+};
+
+// Schedule and reads depend on the seed only
+void scheduler_tests::test_same_seed_same_run() {
+    std::vector<int> reads;
+    mockdb::session_scheduler scheduler(seed);
+    scheduler.run(increments(reads));
+    std::vector<size_t> schedule = scheduler.get_schedule();
+    assert(schedule.size() == 3 * 4);
+
+    TearDown();
+    SetUp(seed);
+    std::vector<int> replayed;
+    mockdb::session_scheduler again(seed);
+    again.run(increments(replayed));
+    assert(again.get_schedule() == schedule);
+    assert(replayed == reads);
+}
+
+// Depth 1 has no change points, each session runs to the end before the next starts
+void scheduler_tests::test_pct_without_change_points() {
+    std::vector<int> reads;
+    mockdb::session_scheduler scheduler(seed, mockdb::session_scheduler::policy::PCT, 1);
+    scheduler.run(increments(reads));
+    std::vector<size_t> schedule = scheduler.get_schedule();
+    std::set<size_t> done;
+    for (size_t i = 1; i < schedule.size(); i++) {
+        if (schedule[i] != schedule[i - 1]) {
+            done.insert(schedule[i - 1]);
+            assert(done.find(schedule[i]) == done.end());
+        }
+    }
+}
+
+// Index of the first step not taken by the session of the first one
+static size_t first_switch(const std::vector<size_t> &schedule) {
+    size_t i = 1;
+    while (i < schedule.size() && schedule[i] == schedule[0])
+        i++;
+    return i;
+}
+
+/*
+ * Two sessions of 30 transactions: with the default 16 expected steps the change
+ * point always preempts the first session within 16 steps, given a bound of the
+ * length of the run it may come later.
+ */
+void scheduler_tests::test_pct_expected_steps() {
+    std::vector<std::function<void()>> sessions;
+    for (long session_id = 1; session_id <= 2; session_id++) {
+        sessions.push_back([this, session_id] {
+            for (int i = 0; i < 30; i++) {
+                store->begin(session_id);
+                store->put("x", i, session_id);
+                store->commit(session_id);
+            }
+        });
+    }
+
+    mockdb::session_scheduler first(seed, mockdb::session_scheduler::policy::PCT, 2);
+    first.run(sessions);
+    size_t steps = first.get_schedule().size();
+    assert(first_switch(first.get_schedule()) <= 16 && steps > 60);
+
+    bool later = false;
+    for (uint64_t i = 0; i < 64 && !later; i++) {
+        mockdb::session_scheduler sized(seed * 64 + i, mockdb::session_scheduler::policy::PCT, 2, steps);
+        sized.run(sessions);
+        later = first_switch(sized.get_schedule()) > 16;
+    }
+    assert(later);
+}
+
+/*
+ * A PCT schedule depends on the seed and the step bound only, not on the runs of
+ * other schedulers before it.
+ */
+void scheduler_tests::test_pct_same_seed_same_run() {
+    const uint64_t own_seed = seed;
+    std::vector<int> reads;
+    mockdb::session_scheduler scheduler(own_seed, mockdb::session_scheduler::policy::PCT, 3, 12);
+    scheduler.run(increments(reads));
+    std::vector<size_t> schedule = scheduler.get_schedule();
+
+    // Other iterations, with other seeds
+    for (uint64_t i = 1; i <= 4; i++) {
+        TearDown();
+        SetUp(own_seed + i);
+        std::vector<int> other;
+        mockdb::session_scheduler longer(own_seed + i, mockdb::session_scheduler::policy::PCT, 3, 12);
+        for (int run = 0; run < 3; run++)
+            longer.run(increments(other));
+    }
+
+    TearDown();
+    SetUp(own_seed);
+    std::vector<int> replayed;
+    mockdb::session_scheduler again(own_seed, mockdb::session_scheduler::policy::PCT, 3, 12);
+    again.run(increments(replayed));
+    assert(again.get_schedule() == schedule);
+    assert(replayed == reads);
+}
+
+// A delayed session lets the others run, time jumps when every session is delayed
+void scheduler_tests::test_virtual_time() {
+    std::vector<size_t> order;
+    mockdb::session_scheduler scheduler(seed);
+    scheduler.run({
+        [&order] {
+            mockdb::cooperative_runner::delay_current(100);
+            order.push_back(0);
+        },
+        [&order] {
+            mockdb::cooperative_runner::delay_current(10);
+            order.push_back(1);
+        }
+    });
+    assert(order == std::vector<size_t>({1, 0}));
+    assert(scheduler.get_time() > 100);
+    assert(scheduler.get_schedule().size() == 4);
+}
+
+// A recorded execution replays with the same reads under another seed
+void scheduler_tests::test_record_replay() {
+    TearDown();
+    mockdb::decision_log log;
+    get_next_tx = new mockdb::recording_read_response_selector<std::string, int>(
+            new mockdb::causal_read_response_selector<std::string, int>(seed), &log);
+    store = new mockdb::kv_store<std::string, int>(get_next_tx);
+    get_next_tx->init_consistency_checker(store);
+    store->put("x", 0);
+
+    std::vector<int> reads;
+    mockdb::session_scheduler scheduler(seed);
+    scheduler.run(increments(reads));
+    log.schedule = scheduler.get_schedule();
+    // The initial put doesn't read
+    assert(log.reads.size() == 9);
+
+    std::stringstream ss;
+    log.write(ss);
+    mockdb::decision_log loaded = mockdb::decision_log::read(ss);
+    assert(loaded == log);
+
+    TearDown();
+    auto *replaying = new mockdb::replaying_read_response_selector<std::string, int>(
+            new mockdb::causal_read_response_selector<std::string, int>(seed + 1), loaded);
+    get_next_tx = replaying;
+    store = new mockdb::kv_store<std::string, int>(get_next_tx);
+    get_next_tx->init_consistency_checker(store);
+    store->put("x", 0);
+
+    std::vector<int> replayed;
+    mockdb::session_scheduler replay(loaded.schedule);
+    replay.run(increments(replayed));
+    assert(!replay.has_diverged() && !replaying->has_diverged());
+    assert(replay.get_schedule() == log.schedule);
+    assert(replayed == reads);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    scheduler_tests st;
+
+    for (int i = 0; i < test_count; i++) {
+        st.SetUp(i);
+        st.test_same_seed_same_run();
+        st.TearDown();
+
+        st.SetUp(i);
+        st.test_pct_without_change_points();
+        st.TearDown();
+
+        st.SetUp(i);
+        st.test_pct_expected_steps();
+        st.TearDown();
+
+        st.SetUp(i);
+        st.test_pct_same_seed_same_run();
+        st.TearDown();
+
+        st.SetUp(i);
+        st.test_virtual_time();
+        st.TearDown();
+
+        st.SetUp(i);
+        st.test_record_replay();
+        st.TearDown();
+    }
+
+    std::cout << "All scheduler tests passed!\n";
+}
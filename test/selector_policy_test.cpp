@@ -0,0 +1,139 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "consistency_exception.h"
+#include "key_not_found_exception.h"
+#include "random_generator.h"
+
+#include <cassert>
+#include <string>
+
+class selector_policy_tests {
+
+public:
+    // Default ctor
+    selector_policy_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(uint64_t seed)
+    {
+        this->seed = seed;
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+    }
+
+    void test_linearizable();
+    void test_causal();
+
+private:
+    uint64_t seed;
+
+    // Runs the same seeded workload on a store of selector type Selector
+    template <typename Selector, typename Concrete>
+    void run(mockdb::kv_store<std::string, int, Selector> &store, Concrete &selector);
+
+    // Histories of a store calling the selector virtually and of one calling it directly
+    template <typename Concrete>
+    void compare();
+};
+
+template <typename Selector, typename Concrete>
+void selector_policy_tests::run(mockdb::kv_store<std::string, int, Selector> &store, Concrete &selector) {
+    selector.init_consistency_checker(&store);
+    mockdb::random_generator random(seed);
+    const char *keys[] = {"x", "y", "z"};
+    for (int i = 0; i < 200; i++) {
+        const std::string key = keys[random.uniform(3)];
+        long session_id = 1 + (long) random.uniform(4);
+        try {
+            switch (random.uniform(8)) {
+                case 0:
+                    store.remove(key, session_id);
+                    break;
+                case 1:
+                    // The transaction commits even if its read fails
+                    store.begin(session_id);
+                    try {
+                        store.get(key, session_id);
+                    } catch (std::exception &e) {
+                    }
+                    store.put(key, i, session_id);
+                    store.commit(session_id);
+                    break;
+                case 2:
+                case 3:
+                case 4:
+                    store.put(key, i, session_id);
+                    break;
+                default:
+                    store.get(key, session_id);
+                    break;
+            }
+        } catch (mockdb::key_not_found_exception &e) {
+            // Part of the workload
+        } catch (mockdb::consistency_exception &e) {
+            // Part of the workload
+        }
+    }
+}
+
+template <typename Concrete>
+void selector_policy_tests::compare() {
+    Concrete dynamic_selector(seed), static_selector(seed);
+    mockdb::kv_store<std::string, int> dynamic_store(&dynamic_selector);
+    mockdb::kv_store<std::string, int, Concrete> static_store(&static_selector, 4);
+    run(dynamic_store, dynamic_selector);
+    run(static_store, static_selector);
+
+    const mockdb::history_log<std::string, int> &a = dynamic_store.get_history();
+    const mockdb::history_log<std::string, int> &b = static_store.get_history();
+    assert(a.size() == b.size() && a.size() > 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        assert(a[i].get_kind() == b[i].get_kind() && a[i].get_session_id() == b[i].get_session_id());
+        assert(a[i].get_key() == b[i].get_key() && a[i].get_version_number() == b[i].get_version_number());
+        assert(a[i].get_tx_id() == b[i].get_tx_id() && a[i].get_reads_from() == b[i].get_reads_from());
+    }
+    assert(static_store.get_gen_next_tx() == &static_selector);
+}
+
+void selector_policy_tests::test_linearizable() {
+    compare<mockdb::linearizable_read_response_selector<std::string, int>>();
+}
+
+void selector_policy_tests::test_causal() {
+    compare<mockdb::causal_read_response_selector<std::string, int>>();
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    selector_policy_tests st;
+
+    for (int i = 0; i < test_count; i++) {
+        st.SetUp(i);
+        st.test_linearizable();
+        st.TearDown();
+
+        st.SetUp(i);
+        st.test_causal();
+        st.TearDown();
+    }
+
+    std::cout << "All selector policy tests passed!\n";
+}
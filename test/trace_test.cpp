@@ -0,0 +1,232 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "trace_buffer.h"
+#include "chrome_trace_writer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class trace_tests {
+
+public:
+    // Default ctor
+    trace_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(uint64_t seed)
+    {
+        this->seed = seed;
+        get_next_tx = new mockdb::causal_read_response_selector<std::string, int>(seed);
+        store = new mockdb::kv_store<std::string, int>(get_next_tx, 4);
+        get_next_tx->init_consistency_checker(store);
+        path = "trace_test_" + std::to_string(seed) + ".trace";
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete store;
+        delete get_next_tx;
+        std::remove(path.c_str());
+    }
+
+    void test_store_events();
+    void test_ring_full();
+    void test_chrome_export();
+    void test_chrome_window();
+
+private:
+    uint64_t seed;
+    mockdb::read_response_selector<std::string, int> *get_next_tx;
+    mockdb::kv_store<std::string, int> *store;
+    std::string path;
+
+    std::vector<mockdb::trace_event> read_trace() {
+        std::vector<mockdb::trace_event> events;
+        std::ifstream in(path, std::ios::binary);
+        mockdb::trace_reader reader(in);
+        mockdb::trace_event event;
+        while (reader.next(event))
+            events.push_back(event);
+        return events;
+    }
+};
+
+// Operations of two threads are traced with their sessions, keys and reads-from
+void trace_tests::test_store_events() {
+    mockdb::tracer &tracer = mockdb::tracer::instance();
+    store->put("x", 1, 1);      // Not traced
+    tracer.start(path);
+    std::thread writer([this]() {
+        store->put("y", 1, 2);
+        store->put("y", 2, 2);
+    });
+    writer.join();
+    store->get("y", 1);
+    store->begin(3);
+    store->put("x", 2, 3);
+    store->commit(3);
+    tracer.stop();
+    store->get("x", 1);         // Not traced
+
+    std::vector<mockdb::trace_event> events = read_trace();
+    size_t puts = 0, gets = 0, created = 0, commits = 0;
+    for (const auto &event : events) {
+        if (event.kind == mockdb::trace_kind::TX_CREATED) {
+            created++;
+            continue;
+        }
+        assert(event.kind != mockdb::trace_kind::NOT_FOUND && event.kind != mockdb::trace_kind::INCONSISTENT);
+        if (event.kind == mockdb::trace_kind::PUT && event.session_id == 2) {
+            assert(event.key_hash == std::hash<std::string>()("y"));
+            assert(event.version_number == ++puts);
+        } else if (event.kind == mockdb::trace_kind::GET) {
+            // Either version of y is causally consistent for session 1
+            assert(event.session_id == 1 && event.version_number >= 1 && event.reads_from != 0);
+            gets++;
+        } else if (event.kind == mockdb::trace_kind::COMMIT) {
+            assert(event.session_id == 3 && event.version_number == 1);
+            commits++;
+        }
+    }
+    assert(puts == 2 && gets == 1 && commits == 1);
+    // Two PUTs, one GET and the transaction of session 3, whose PUT is part of it
+    assert(created == 4);
+    assert(tracer.get_written() == events.size());
+
+    // Events of a thread are in order
+    for (size_t i = 1; i < events.size(); i++) {
+        if (events[i].thread == events[i - 1].thread)
+            assert(events[i].timestamp >= events[i - 1].timestamp);
+    }
+}
+
+// A thread whose ring is full drops events instead of blocking
+void trace_tests::test_ring_full() {
+    mockdb::tracer &tracer = mockdb::tracer::instance();
+    uint64_t dropped = tracer.get_dropped();
+    tracer.start(path, 4);
+    std::thread writer([this]() {
+        for (int i = 0; i < 1000; i++)
+            store->put("x", i, 2);
+    });
+    writer.join();
+    tracer.stop();
+
+    std::vector<mockdb::trace_event> events = read_trace();
+    assert(!events.empty());
+    assert(events.size() + (tracer.get_dropped() - dropped) == 2000);
+}
+
+// Reads get an arrow from their write even if they come first, and none from writes before the trace
+void trace_tests::test_chrome_export() {
+    mockdb::tracer &tracer = mockdb::tracer::instance();
+    tracer.start(path);
+    store->put("x", 1, 1);
+    store->begin(2);
+    store->put("y", 1, 2);
+    store->commit(2);
+    store->get("x", 3);
+    store->get("y", 3);
+    tracer.stop();
+
+    std::vector<mockdb::trace_event> events = read_trace();
+    // A read of a write before the trace, and one read before its write
+    mockdb::trace_event early = events.back();
+    early.reads_from = 1 << 30;
+    events.push_back(early);
+    std::rotate(events.begin(), events.end() - 2, events.end());
+    uint16_t id = store->get_trace_id();
+    assert(events[0].kind == mockdb::trace_kind::GET && events[0].store == id);
+
+    std::stringstream out;
+    mockdb::chrome_trace_writer writer(out);
+    for (const auto &event : events)
+        writer.add(event);
+    writer.finish();
+    assert(writer.get_flow_count() == 2 && writer.get_unresolved_count() == 1);
+    std::string json = out.str();
+    assert(json.compare(0, 15, "{\"traceEvents\":") == 0 && json.find("\"name\":\"session 3\"") != std::string::npos);
+    assert(json.find("\"name\":\"transaction\"") != std::string::npos);
+}
+
+// Writes older than the window are dropped while their store stays open, reads of them get no arrow
+void trace_tests::test_chrome_window() {
+    const uint64_t ms = 1000000;
+    const long writes = 100000;
+    std::ostream discard(nullptr);
+    mockdb::chrome_trace_writer writer(discard);
+
+    mockdb::trace_event event = {};
+    event.store = 1;
+    event.session_id = 1;
+    event.kind = mockdb::trace_kind::PUT;
+    size_t held = 0;
+    for (long i = 1; i <= writes; i++) {
+        event.timestamp = (uint64_t) i * ms;
+        event.tx_id = i;
+        event.version_number = (uint64_t) i;
+        writer.add(event);
+        held = std::max(held, writer.get_held_count());
+    }
+    // A write per ms over the default window of 10 s
+    assert(held <= 10001 && writer.get_held_count() < (size_t) writes);
+
+    event.kind = mockdb::trace_kind::GET;
+    event.session_id = 2;
+    event.tx_id = writes + 1;
+    event.reads_from = 1;
+    writer.add(event);
+    event.tx_id = writes + 2;
+    event.reads_from = writes;
+    writer.add(event);
+    writer.finish();
+    assert(writer.get_flow_count() == 1 && writer.get_unresolved_count() == 1);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    trace_tests tt;
+
+    for (int i = 0; i < test_count; i++) {
+        tt.SetUp(i);
+        tt.test_store_events();
+        tt.TearDown();
+
+        tt.SetUp(i);
+        tt.test_ring_full();
+        tt.TearDown();
+
+        tt.SetUp(i);
+        tt.test_chrome_export();
+        tt.TearDown();
+
+        tt.SetUp(i);
+        tt.test_chrome_window();
+        tt.TearDown();
+    }
+
+    std::cout << "All trace tests passed!\n";
+}
@@ -0,0 +1,176 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+
+#include <cassert>
+#include <thread>
+
+class transaction_tests {
+
+public:
+    // Default ctor
+    transaction_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(mockdb::read_response_selector<std::string, int> *selector)
+    {
+        read_selector = selector;
+        store = new mockdb::kv_store<std::string, int>(read_selector, 4);
+        read_selector->init_consistency_checker(store);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete read_selector;
+        delete store;
+    }
+
+    void test_atomic_visibility();
+    void test_remove_in_transaction();
+    void test_serialized_increments();
+    void test_invalid_use();
+
+private:
+    mockdb::kv_store<std::string, int> *store;
+    mockdb::read_response_selector<std::string, int> *read_selector;
+
+    bool is_removed(const std::string &key, long session_id) {
+        try {
+            store->get(key, session_id);
+        } catch (mockdb::key_not_found_exception &e) {
+            return true;
+        }
+        return false;
+    }
+};
+
+/*
+ * C1: W(x)a W(y)a
+ * C2:               BEGIN W(x)b W(y)b COMMIT
+ * C3:                                          R(y)b   R(x)a   NOT OK
+ */
+void transaction_tests::test_atomic_visibility() {
+    int c1 = 1, c2 = 2, c3 = 3;
+    int a = 5, b = 10;
+
+    store->put("x", a, c1);
+    store->put("y", a, c1);
+
+    store->begin(c2);
+    store->put("x", b, c2);
+    store->put("y", b, c2);
+
+    // Buffered writes are read back by the transaction only
+    assert(store->get_with_version("x", c2) == std::make_pair(b, (size_t) 0));
+    assert(store->get("x", c3) == a);
+    store->commit(c2);
+
+    assert(store->get_with_version("x", c2) == std::make_pair(b, (size_t) 2));
+    while (store->get("y", c3) != b) {
+    }
+    assert(store->get("x", c3) == b);
+}
+
+/*
+ * C1: W(x)a   BEGIN D(x)a R(x)NOTFOUND W(y)a COMMIT
+ * C2:                                              R(y)a   R(x)NOTFOUND
+ */
+void transaction_tests::test_remove_in_transaction() {
+    int c1 = 1, c2 = 2;
+    int a = 5;
+
+    store->put("x", a, c1);
+    store->begin(c1);
+    assert(store->remove("x", c1) == a);
+    assert(is_removed("x", c1));
+    store->put("y", a, c1);
+    store->commit(c1);
+
+    assert(store->get_size() == 1);
+    assert(store->get("y", c2) == a);
+    assert(is_removed("x", c2));
+}
+
+/*
+ * Read-modify-write transactions of two sessions run concurrently; with serialized
+ * transactions no increment is lost.
+ */
+void transaction_tests::test_serialized_increments() {
+    const int increments = 50;
+    store->put("counter", 0);
+
+    auto increment = [this](long session_id) {
+        for (int i = 0; i < increments; i++) {
+            store->begin(session_id);
+            int value = store->get("counter", session_id);
+            store->put("counter", value + 1, session_id);
+            store->commit(session_id);
+        }
+    };
+    std::thread t1(increment, 1), t2(increment, 2);
+    t1.join();
+    t2.join();
+
+    assert(store->get("counter") == 2 * increments);
+    assert(store->get_history().size() == 1 + 4 * increments + 1);
+}
+
+void transaction_tests::test_invalid_use() {
+    bool thrown = false;
+    try {
+        store->commit(1);
+    } catch (std::logic_error &e) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    store->begin(1);
+    thrown = false;
+    try {
+        store->begin(1);
+    } catch (std::logic_error &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    store->commit(1);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    transaction_tests tt;
+
+    for (int i = 0; i < test_count; i++) {
+        tt.SetUp(new mockdb::causal_read_response_selector<std::string, int>());
+        tt.test_atomic_visibility();
+        tt.TearDown();
+
+        tt.SetUp(new mockdb::causal_read_response_selector<std::string, int>());
+        tt.test_remove_in_transaction();
+        tt.TearDown();
+
+        tt.SetUp(new mockdb::linearizable_read_response_selector<std::string, int>());
+        tt.test_serialized_increments();
+        tt.TearDown();
+
+        tt.SetUp(new mockdb::causal_read_response_selector<std::string, int>());
+        tt.test_invalid_use();
+        tt.TearDown();
+    }
+
+    std::cout << "All transaction tests passed!\n";
+}
@@ -0,0 +1,163 @@
+// ------------------------------------------------------------
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "kv_store.h"
+#include "read_response_selector.h"
+#include "tx_id_allocator.h"
+
+#include <cassert>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+class tx_id_tests {
+
+public:
+    // Default ctor
+    tx_id_tests() {
+
+    }
+
+    // Called once before each test
+    virtual void SetUp(long block_size)
+    {
+        this->block_size = block_size;
+        allocator = new mockdb::tx_id_allocator(block_size);
+    }
+
+    // Called once after each test
+    virtual void TearDown() {
+        delete allocator;
+    }
+
+    void test_concurrent_unique();
+    void test_independent_stores();
+    void test_single_thread_sequence();
+    void test_interleaved_allocators();
+    void test_evicted_blocks();
+
+private:
+    long block_size;
+    mockdb::tx_id_allocator *allocator;
+};
+
+// Ids taken by several threads at once are unique and positive
+void tx_id_tests::test_concurrent_unique() {
+    const int threads_count = 4, ids_per_thread = 1000;
+    std::vector<std::vector<long>> ids(threads_count);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++) {
+        threads.push_back(std::thread([this, t, &ids]() {
+            for (int i = 0; i < ids_per_thread; i++)
+                ids[t].push_back(allocator->next());
+        }));
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    std::set<long> all;
+    for (auto &thread_ids : ids) {
+        // Ordered within a thread
+        for (size_t i = 1; i < thread_ids.size(); i++)
+            assert(thread_ids[i] > thread_ids[i - 1]);
+        all.insert(thread_ids.begin(), thread_ids.end());
+    }
+    assert(all.size() == (size_t) (threads_count * ids_per_thread));
+    assert(*all.begin() >= 1);
+}
+
+// Stores don't share ids: each one driven by a single thread numbers its transactions from 1
+void tx_id_tests::test_independent_stores() {
+    mockdb::linearizable_read_response_selector<std::string, int> selector_a, selector_b;
+    mockdb::kv_store<std::string, int> a(&selector_a), b(&selector_b);
+    selector_a.init_consistency_checker(&a);
+    selector_b.init_consistency_checker(&b);
+    for (int i = 0; i < 3; i++) {
+        a.put("x", i, 1);
+        b.put("x", i, 1);
+    }
+    for (long i = 0; i < 3; i++) {
+        assert(a.get_history()[i].get_tx_id() == i + 1);
+        assert(b.get_history()[i].get_tx_id() == i + 1);
+    }
+}
+
+// One thread on a fresh allocator gets 1, 2, 3, ... across blocks
+void tx_id_tests::test_single_thread_sequence() {
+    for (long i = 1; i <= 3 * block_size + 1; i++)
+        assert(allocator->next() == i);
+}
+
+// Allocators used in turn by one thread each keep their own sequence
+void tx_id_tests::test_interleaved_allocators() {
+    mockdb::tx_id_allocator other(block_size);
+    for (long i = 1; i <= 2 * block_size + 1; i++) {
+        assert(allocator->next() == i);
+        assert(other.next() == i);
+    }
+}
+
+// A block evicted from the thread's cache leaves a gap, ids stay unique and increasing
+void tx_id_tests::test_evicted_blocks() {
+    const size_t count = mockdb::tx_id_allocator::cached_blocks + 2;
+    std::vector<std::unique_ptr<mockdb::tx_id_allocator>> allocators;
+    for (size_t i = 0; i < count; i++)
+        allocators.push_back(std::unique_ptr<mockdb::tx_id_allocator>(new mockdb::tx_id_allocator(block_size)));
+
+    std::vector<std::set<long>> ids(count);
+    std::vector<long> last(count, 0);
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < count; i++) {
+            long id = allocators[i]->next();
+            assert(id > last[i] && ids[i].insert(id).second);
+            last[i] = id;
+        }
+    }
+    // Every allocator was evicted before its next id, so each round started a new block
+    for (size_t i = 0; i < count; i++)
+        assert(last[i] == 2 * block_size + 1);
+}
+
+/*
+ * Args:
+ * num-test : number of times to run test
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cout << "Invalid arguments, specify number of times to run test\n";
+        return -1;
+    }
+
+    int test_count = atoi(argv[1]);
+    tx_id_tests tt;
+    long block_sizes[] = {1, 3, 64};
+
+    for (int i = 0; i < test_count; i++) {
+        for (long block_size : block_sizes) {
+            tt.SetUp(block_size);
+            tt.test_concurrent_unique();
+            tt.TearDown();
+
+            tt.SetUp(block_size);
+            tt.test_independent_stores();
+            tt.TearDown();
+
+            tt.SetUp(block_size);
+            tt.test_single_thread_sequence();
+            tt.TearDown();
+
+            tt.SetUp(block_size);
+            tt.test_interleaved_allocators();
+            tt.TearDown();
+
+            tt.SetUp(block_size);
+            tt.test_evicted_blocks();
+            tt.TearDown();
+        }
+    }
+
+    std::cout << "All transaction id tests passed!\n";
+}